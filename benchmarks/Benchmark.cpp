@@ -0,0 +1,40 @@
+#include <cstdio>
+
+#include "benchmarks/Benchmark.h"
+
+namespace BeamMeUp {
+    Benchmark::Benchmark(const char *name, Function function) : name(name), function(function) {
+        getBenchmarks().push_back(this);
+    }
+
+    int Benchmark::run(const std::string &filter) {
+        int count = 0;
+
+        for (auto benchmark : getBenchmarks()) {
+            if (std::string(benchmark->name).find(filter) == std::string::npos) {
+                continue;
+            }
+
+            printf("%s\n", benchmark->name);
+            benchmark->function();
+            count++;
+        }
+
+        return count;
+    }
+
+    void Benchmark::report(const std::string &label, size_t operations, std::chrono::nanoseconds elapsed) {
+        double nanoseconds = static_cast<double>(elapsed.count());
+        printf("  %-48s %12zu ops %12.1f ns/op %14.0f ops/s\n", label.c_str(), operations,
+               nanoseconds / operations, operations / (nanoseconds / 1e9));
+    }
+
+    std::vector<Benchmark *> &Benchmark::getBenchmarks() {
+        static std::vector<Benchmark *> benchmarks;
+        return benchmarks;
+    }
+}
+
+int main(int argc, char **argv) {
+    return BeamMeUp::Benchmark::run(argc > 1 ? argv[1] : "") > 0 ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+#ifndef BEAMMEUP_BENCHMARK_H
+#define BEAMMEUP_BENCHMARK_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace BeamMeUp {
+    /**
+     * Benchmark is a minimal harness for timing library operations. Each benchmark registers itself through a static
+     * instance and reports one or more results. Run the benchmarks binary with a substring of a benchmark name to
+     * only run matching benchmarks.
+     */
+    class Benchmark {
+    public:
+        typedef void (*Function)();
+
+        /**
+         * Registers a benchmark
+         * @param name The name of the benchmark
+         * @param function The function that runs it
+         */
+        Benchmark(const char *name, Function function);
+
+        /**
+         * Runs every benchmark whose name contains filter
+         * @param filter The filter. Empty runs everything.
+         * @return The number of benchmarks run
+         */
+        static int run(const std::string &filter);
+
+        /**
+         * Prints a result
+         * @param label What was measured
+         * @param operations The number of operations timed
+         * @param elapsed How long they took
+         */
+        static void report(const std::string &label, size_t operations, std::chrono::nanoseconds elapsed);
+
+    private:
+        /**
+         * @return All registered benchmarks. A function so it is initialized before first use.
+         */
+        static std::vector<Benchmark *> &getBenchmarks();
+
+        const char *name;
+        Function function;
+    };
+}
+
+#endif //BEAMMEUP_BENCHMARK_H
@@ -0,0 +1,152 @@
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmarks/Benchmark.h"
+#include "include/beammeup/Affinity.h"
+#include "include/beammeup/Dispatcher.h"
+#include "include/beammeup/Receiver.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Transporter.h"
+
+namespace BeamMeUp {
+    /**
+     * Reads a buffer placed on one NUMA node from a thread on another, for every pair of nodes. The buffer is
+     * allocated on its node when the library is built with NUMA support, and is first written by a thread pinned to
+     * that node either way, so the OS places it there too.
+     */
+    static void benchmarkMemoryTraffic() {
+        const size_t bytes = 64 * 1024 * 1024;
+        const size_t passes = 4;
+
+        // The first CPU of each node
+        std::map<int, int> nodeCpus;
+        for (int cpu = 0; cpu < Affinity::getCpuCount(); ++cpu) {
+            int node = Affinity::getNode(cpu);
+            if (node >= 0 && nodeCpus.find(node) == nodeCpus.end()) {
+                nodeCpus[node] = cpu;
+            }
+        }
+        if (nodeCpus.empty()) {
+            nodeCpus[-1] = -1;
+        }
+
+        for (auto &memory : nodeCpus) {
+            auto buffer = static_cast<uint64_t *>(Affinity::allocate(bytes, memory.first));
+            size_t words = bytes / sizeof(uint64_t);
+            std::thread toucher([buffer, words, &memory]() {
+                Affinity::pinCurrentThread(memory.second);
+                for (size_t i = 0; i < words; ++i) {
+                    buffer[i] = i;
+                }
+            });
+            toucher.join();
+
+            for (auto &reader : nodeCpus) {
+                volatile uint64_t sink = 0;
+                std::chrono::steady_clock::duration elapsed;
+                std::thread thread([buffer, words, &reader, &sink, &elapsed]() {
+                    Affinity::pinCurrentThread(reader.second);
+                    auto start = std::chrono::steady_clock::now();
+                    uint64_t sum = 0;
+                    for (size_t pass = 0; pass < passes; ++pass) {
+                        // One word per cache line, so this measures memory rather than arithmetic
+                        for (size_t i = 0; i < words; i += 8) {
+                            sum += buffer[i];
+                        }
+                    }
+                    elapsed = std::chrono::steady_clock::now() - start;
+                    sink = sum;
+                });
+                thread.join();
+
+                std::string label = "read, CPU node " + std::to_string(reader.first) + ", memory node " +
+                                    std::to_string(memory.first);
+                Benchmark::report(label + (reader.first == memory.first ? " (local)" : " (remote)"),
+                                  passes * words / 8, elapsed);
+            }
+
+            Affinity::deallocate(buffer, bytes, memory.first);
+        }
+    }
+
+    /**
+     * Receiver that updates a table shared with its partner, so the pair benefits from sharing a core's cache
+     */
+    class SharingReceiver : public Receiver {
+    public:
+        SharingReceiver(Transporter *transporter, std::vector<uint64_t> *table, std::atomic<size_t> *done) :
+                Receiver(transporter), table(table), done(done) {
+        }
+
+        void processMessage(const Signal, const Variant &message) override {
+            size_t index = static_cast<size_t>(message.toInt());
+            for (size_t i = 0; i < 64; ++i) {
+                (*table)[(index * 64 + i) % table->size()] += i;
+            }
+            done->fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::vector<uint64_t> *table;
+        std::atomic<size_t> *done;
+    };
+
+    /**
+     * Drains messages for pairs of receivers that share a table, with each pair pinned to a worker or left to float
+     * @param pinned Whether to pin the pairs
+     */
+    static void benchmarkPairs(bool pinned) {
+        const size_t pairs = 8;
+        const size_t messages = 20000;
+        unsigned int threads = static_cast<unsigned int>(Affinity::getCpuCount());
+        Transporter transporter;
+        std::atomic<size_t> done(0);
+        std::vector<std::vector<uint64_t>> tables(pairs, std::vector<uint64_t>(16384));
+        std::vector<std::unique_ptr<Signaler>> signalers;
+        std::vector<std::unique_ptr<SharingReceiver>> receivers;
+
+        std::vector<int> cpus;
+        for (unsigned int i = 0; i < threads; ++i) {
+            cpus.push_back(static_cast<int>(i));
+        }
+        Dispatcher dispatcher(&transporter, cpus);
+        for (size_t pair = 0; pair < pairs; ++pair) {
+            signalers.emplace_back(new Signaler(&transporter));
+            for (int side = 0; side < 2; ++side) {
+                receivers.emplace_back(new SharingReceiver(&transporter, &tables[pair], &done));
+                signalers.back()->connect(1, receivers.back().get());
+                if (pinned) {
+                    dispatcher.pin(receivers.back().get(), static_cast<unsigned int>(pair % threads));
+                }
+            }
+        }
+        for (size_t i = 0; i < messages; ++i) {
+            for (auto &signaler : signalers) {
+                signaler->notify(1, static_cast<int>(i));
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        dispatcher.start();
+        while (done.load(std::memory_order_relaxed) < pairs * 2 * messages) {
+            std::this_thread::yield();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        dispatcher.stop();
+
+        Benchmark::report(std::string("shared table pairs, ") + (pinned ? "pinned" : "floating"),
+                          pairs * 2 * messages, elapsed);
+    }
+
+    static void benchmarkAffinity() {
+        benchmarkMemoryTraffic();
+        benchmarkPairs(false);
+        benchmarkPairs(true);
+    }
+
+    static Benchmark affinity("Affinity", &benchmarkAffinity);
+}
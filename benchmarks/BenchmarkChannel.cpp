@@ -0,0 +1,85 @@
+#include <thread>
+
+#include "benchmarks/Benchmark.h"
+#include "include/beammeup/Channel.h"
+#include "include/beammeup/Receiver.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Transporter.h"
+
+namespace BeamMeUp {
+    /**
+     * Receiver that counts the messages it processes
+     */
+    class CountingReceiver : public Receiver {
+    public:
+        CountingReceiver(Transporter *transporter) : Receiver(transporter), count(0) {
+        }
+
+        void processMessage(const Signal, const Variant &) override {
+            count++;
+        }
+
+        size_t count;
+    };
+
+    /**
+     * Sends messages from one thread to a receiver drained by another and times the whole transfer
+     * @param label The result label
+     * @param options How the receiver is connected
+     */
+    static void benchmarkProducerConsumer(const std::string &label, const ConnectionOptions &options) {
+        const size_t messages = 2000000;
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        CountingReceiver receiver(&transporter);
+        signaler.connect(1, &receiver, options);
+        Variant message(42);
+
+        auto start = std::chrono::steady_clock::now();
+        std::thread producer([&signaler, &message, messages]() {
+            for (size_t i = 0; i < messages; ++i) {
+                signaler.notify(1, message);
+            }
+        });
+        while (receiver.count < messages) {
+            receiver.processMessages();
+        }
+        producer.join();
+
+        Benchmark::report(label, messages, std::chrono::steady_clock::now() - start);
+    }
+
+    /**
+     * Times the channel on its own, without the Signaler and Receiver around it
+     */
+    static void benchmarkRawChannel() {
+        const size_t messages = 5000000;
+        Channel channel(nullptr, 4096);
+        Variant message(42);
+
+        auto start = std::chrono::steady_clock::now();
+        std::thread producer([&channel, &message, messages]() {
+            for (size_t i = 0; i < messages; ++i) {
+                channel.push(1, message);
+            }
+        });
+        Signal signal;
+        Variant received;
+        for (size_t i = 0; i < messages;) {
+            if (channel.pop(signal, received)) {
+                i++;
+            }
+        }
+        producer.join();
+
+        Benchmark::report("Channel push/pop only, 2 threads", messages, std::chrono::steady_clock::now() - start);
+    }
+
+    static void benchmarkChannel() {
+        benchmarkRawChannel();
+        benchmarkProducerConsumer("mailbox (C_QUEUED), 2 threads", ConnectionOptions(C_QUEUED));
+        benchmarkProducerConsumer("ring (C_SPSC), 2 threads", ConnectionOptions(C_SPSC, 4096));
+    }
+
+    static Benchmark channel("SpscChannel", &benchmarkChannel);
+}
@@ -0,0 +1,69 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "benchmarks/Benchmark.h"
+#include "include/beammeup/Checkpoint.h"
+#include "include/beammeup/Receiver.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Transporter.h"
+
+namespace BeamMeUp {
+    /**
+     * Receiver whose messages are only ever checkpointed
+     */
+    class IdleReceiver : public Receiver {
+    public:
+        IdleReceiver(Transporter *transporter) : Receiver(transporter) {
+        }
+    };
+
+    /**
+     * Saves and restores a million queued messages spread over a thousand receivers
+     */
+    static void benchmarkCheckpoint() {
+        const size_t receiverCount = 1000;
+        const size_t messages = 1000000;
+        std::string path = "/tmp/beammeup-benchmark-checkpoint-" + std::to_string(getpid());
+        Variant message(std::string(32, 'x'));
+
+        {
+            Transporter transporter;
+            Signaler signaler(&transporter);
+            Checkpoint checkpoint(&transporter);
+            checkpoint.add("signaler", &signaler);
+            std::vector<std::unique_ptr<IdleReceiver>> receivers;
+            for (size_t i = 0; i < receiverCount; i++) {
+                receivers.emplace_back(new IdleReceiver(&transporter));
+                signaler.connect(static_cast<Signal>(i), receivers.back().get());
+                checkpoint.add(std::to_string(i), receivers.back().get());
+            }
+            for (size_t i = 0; i < messages; i++) {
+                signaler.notify(static_cast<Signal>(i % receiverCount), message);
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            size_t saved = checkpoint.save(path);
+            Benchmark::report("save, 32 byte strings", saved, std::chrono::steady_clock::now() - start);
+        }
+
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        Checkpoint checkpoint(&transporter);
+        checkpoint.add("signaler", &signaler);
+        std::vector<std::unique_ptr<IdleReceiver>> receivers;
+        for (size_t i = 0; i < receiverCount; i++) {
+            receivers.emplace_back(new IdleReceiver(&transporter));
+            checkpoint.add(std::to_string(i), receivers.back().get());
+        }
+        auto start = std::chrono::steady_clock::now();
+        size_t restored = checkpoint.restore(path);
+        Benchmark::report("restore, 32 byte strings", restored, std::chrono::steady_clock::now() - start);
+        remove(path.c_str());
+    }
+
+    static Benchmark checkpoint("Checkpoint", &benchmarkCheckpoint);
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmarks/Benchmark.h"
+#include "include/beammeup/Dispatcher.h"
+#include "include/beammeup/Receiver.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Transporter.h"
+
+namespace BeamMeUp {
+    /**
+     * Receiver that does a little arithmetic for each message, so there is work worth spreading across threads
+     */
+    class WorkingReceiver : public Receiver {
+    public:
+        WorkingReceiver(Transporter *transporter, std::atomic<size_t> *done) :
+                Receiver(transporter), done(done), total(0) {
+        }
+
+        void processMessage(const Signal, const Variant &message) override {
+            uint64_t value = static_cast<uint64_t>(message.toInt());
+            for (int i = 0; i < 2000; ++i) {
+                value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+            }
+            total += value;
+            done->fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::atomic<size_t> *done;
+        uint64_t total;
+    };
+
+    /**
+     * Queues messages for many receivers, then times a dispatcher draining them
+     * @param threads The number of workers
+     */
+    static void benchmarkDrain(unsigned int threads) {
+        const size_t receiverCount = 64;
+        const size_t messages = 2000;
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        std::atomic<size_t> done(0);
+        std::vector<std::unique_ptr<WorkingReceiver>> receivers;
+        for (size_t i = 0; i < receiverCount; ++i) {
+            receivers.emplace_back(new WorkingReceiver(&transporter, &done));
+            signaler.connect(1, receivers.back().get());
+        }
+        for (size_t i = 0; i < messages; ++i) {
+            signaler.notify(1, static_cast<int>(i));
+        }
+
+        Dispatcher dispatcher(&transporter, threads);
+        auto start = std::chrono::steady_clock::now();
+        dispatcher.start();
+        while (done.load(std::memory_order_relaxed) < receiverCount * messages) {
+            std::this_thread::yield();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        dispatcher.stop();
+
+        Benchmark::report("Drain " + std::to_string(threads) + " threads", receiverCount * messages, elapsed);
+    }
+
+    /**
+     * Times a dispatcher draining messages for receivers that are all pinned to its first worker, leaving the rest
+     * idle unless the rebalancer spreads them out
+     * @param rebalance Whether to rebalance automatically
+     */
+    static void benchmarkImbalanced(bool rebalance) {
+        const size_t receiverCount = 16;
+        const size_t messages = 2000;
+        unsigned int threads = std::max(2u, std::thread::hardware_concurrency());
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        std::atomic<size_t> done(0);
+        Dispatcher dispatcher(&transporter, threads);
+        std::vector<std::unique_ptr<WorkingReceiver>> receivers;
+        for (size_t i = 0; i < receiverCount; ++i) {
+            receivers.emplace_back(new WorkingReceiver(&transporter, &done));
+            signaler.connect(1, receivers.back().get());
+            dispatcher.pin(receivers.back().get(), 0);
+        }
+        for (size_t i = 0; i < messages; ++i) {
+            signaler.notify(1, static_cast<int>(i));
+        }
+        if (rebalance) {
+            dispatcher.setRebalanceInterval(std::chrono::milliseconds(10));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        dispatcher.start();
+        while (done.load(std::memory_order_relaxed) < receiverCount * messages) {
+            std::this_thread::yield();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        dispatcher.stop();
+
+        Benchmark::report(std::string("Pinned to one of ") + std::to_string(threads) + " workers, " +
+                          (rebalance ? "rebalanced" : "static"), receiverCount * messages, elapsed);
+    }
+
+    static void benchmarkDispatcher() {
+        unsigned int cores = std::thread::hardware_concurrency();
+        for (unsigned int threads = 1; threads < cores; threads *= 2) {
+            benchmarkDrain(threads);
+        }
+        benchmarkDrain(cores == 0 ? 1 : cores);
+        benchmarkImbalanced(false);
+        benchmarkImbalanced(true);
+    }
+
+    static Benchmark dispatcher("Dispatcher", &benchmarkDispatcher);
+}
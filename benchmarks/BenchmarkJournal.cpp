@@ -0,0 +1,64 @@
+#include <chrono>
+#include <string>
+#include <unistd.h>
+
+#include "benchmarks/Benchmark.h"
+#include "include/beammeup/Journal.h"
+#include "include/beammeup/JournalReplayer.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Transporter.h"
+
+namespace BeamMeUp {
+    /**
+     * Removes a journal's segments and directory
+     * @param directory The directory
+     */
+    static void removeJournal(const std::string &directory) {
+        for (auto &segment : Journal::listSegments(directory)) {
+            unlink(segment.c_str());
+        }
+        rmdir(directory.c_str());
+    }
+
+    /**
+     * Records messages through a C_DIRECT connection, so the cost is that of notify plus the append
+     * @param label What to report
+     * @param sync The sync policy
+     * @param messages The number of messages
+     */
+    static void record(const std::string &label, JournalSync sync, size_t messages) {
+        std::string directory = "/tmp/beammeup-benchmark-journal-" + std::to_string(getpid());
+        removeJournal(directory);
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        Variant message(std::string(64, 'x'));
+        {
+            Journal journal(&transporter, directory, sync, std::chrono::milliseconds(10));
+            signaler.connect(1, &journal, ConnectionOptions(C_DIRECT));
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < messages; i++) {
+                signaler.notify(1, message);
+            }
+            Benchmark::report(label, messages, std::chrono::steady_clock::now() - start);
+        }
+
+        if (sync == JS_NONE) {
+            JournalReplayer replayer(&transporter, directory);
+            auto start = std::chrono::steady_clock::now();
+            size_t replayed = replayer.replay();
+            Benchmark::report("replay as fast as possible, no receivers", replayed, std::chrono::steady_clock::now() - start);
+        }
+        removeJournal(directory);
+    }
+
+    /**
+     * Compares the sync policies
+     */
+    static void benchmarkJournal() {
+        record("record 64 byte strings, no sync", JS_NONE, 2000000);
+        record("record 64 byte strings, group commit every 10ms", JS_INTERVAL, 2000000);
+        record("record 64 byte strings, sync each", JS_EVERY, 2000);
+    }
+
+    static Benchmark journal("Journal", &benchmarkJournal);
+}
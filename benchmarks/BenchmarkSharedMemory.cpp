@@ -0,0 +1,100 @@
+#include <chrono>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#include "benchmarks/Benchmark.h"
+#include "include/beammeup/SharedMemoryRing.h"
+#include "include/beammeup/Variant.h"
+
+namespace BeamMeUp {
+    /**
+     * Bounces a message between this process and a child over a pair of rings, reporting the one way latency. The
+     * waiting side yields rather than sleeping, so with a CPU each this measures the rings, and with one CPU the
+     * cost of switching between the processes.
+     */
+    static void benchmarkPingPong() {
+        const int roundTrips = 100000;
+        std::string ping = "/beammeup-benchmark-ping-" + std::to_string(getpid());
+        std::string pong = "/beammeup-benchmark-pong-" + std::to_string(getpid());
+
+        SharedMemoryRing requests(ping, SM_PRODUCER, 4096);
+        SharedMemoryRing replies(pong, SM_CONSUMER, 4096);
+
+        pid_t child = fork();
+        if (child == 0) {
+            SharedMemoryRing in(ping, SM_CONSUMER);
+            SharedMemoryRing out(pong, SM_PRODUCER);
+            Signal signal;
+            Variant message;
+            for (int i = 0; i < roundTrips; i++) {
+                while (!in.read(signal, message)) {
+                    std::this_thread::yield();
+                }
+                out.write(signal, message);
+            }
+            _exit(0);
+        }
+
+        while (!replies.isPeerAlive()) {
+            std::this_thread::yield();
+        }
+        Signal signal;
+        Variant message;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < roundTrips; i++) {
+            requests.write(1, Variant(i));
+            while (!replies.read(signal, message)) {
+                std::this_thread::yield();
+            }
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        waitpid(child, nullptr, 0);
+        Benchmark::report("one way latency, ping-pong between processes", 2 * roundTrips, elapsed);
+
+        SharedMemoryRing::unlink(ping);
+        SharedMemoryRing::unlink(pong);
+    }
+
+    /**
+     * Streams messages to a child process, reporting the throughput. The producer yields when the ring is full.
+     */
+    static void benchmarkStream() {
+        const int messages = 1000000;
+        std::string name = "/beammeup-benchmark-stream-" + std::to_string(getpid());
+        SharedMemoryRing producer(name, SM_PRODUCER, 1 << 20);
+
+        pid_t child = fork();
+        if (child == 0) {
+            SharedMemoryRing consumer(name, SM_CONSUMER);
+            Signal signal;
+            Variant message;
+            int received = 0;
+            while (received < messages) {
+                if (consumer.read(signal, message)) {
+                    received++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            _exit(0);
+        }
+
+        Variant message(std::string(64, 'x'));
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < messages; i++) {
+            while (!producer.write(1, message)) {
+                std::this_thread::yield();
+            }
+        }
+        waitpid(child, nullptr, 0);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        Benchmark::report("stream to another process, 64 byte strings", messages, elapsed);
+
+        SharedMemoryRing::unlink(name);
+    }
+
+    static Benchmark pingPong("SharedMemoryPingPong", &benchmarkPingPong);
+    static Benchmark stream("SharedMemoryStream", &benchmarkStream);
+}
@@ -0,0 +1,166 @@
+#include <memory>
+#include <vector>
+
+#include "benchmarks/Benchmark.h"
+#include "include/beammeup/Receiver.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Transporter.h"
+#include "include/beammeup/VariantMap.h"
+
+namespace BeamMeUp {
+    /**
+     * Receiver that discards what it is sent
+     */
+    class SinkReceiver : public Receiver {
+    public:
+        SinkReceiver(Transporter *transporter) : Receiver(transporter) {
+        }
+    };
+
+    /**
+     * Times notify on a signaler with one subscription per signal, cycling through the signals, so the cost is
+     * dominated by finding the subscribers
+     * @param subscriptions The number of signals subscribed to
+     */
+    static void benchmarkLookup(size_t subscriptions) {
+        const size_t messages = 2000000;
+        const size_t drainEvery = 4096;
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        std::vector<std::unique_ptr<SinkReceiver>> receivers;
+        for (int i = 0; i < 16; ++i) {
+            receivers.emplace_back(new SinkReceiver(&transporter));
+        }
+        for (size_t i = 0; i < subscriptions; ++i) {
+            signaler.connect(static_cast<Signal>(i * 7919), receivers[i % receivers.size()].get());
+        }
+        Variant message(42);
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < messages; ++i) {
+            signaler.notify(static_cast<Signal>((i % subscriptions) * 7919), message);
+            if (i % drainEvery == drainEvery - 1) {
+                transporter.processMessages();
+            }
+        }
+        transporter.processMessages();
+
+        Benchmark::report("notify lookup, " + std::to_string(subscriptions) + " signals", messages,
+                          std::chrono::steady_clock::now() - start);
+    }
+
+    /**
+     * Times notify on a single signal with many subscribers
+     * @param subscriptions The number of receivers connected to the signal
+     */
+    static void benchmarkFanOut(size_t subscriptions) {
+        const size_t deliveries = 4000000;
+        const size_t messages = std::max<size_t>(deliveries / subscriptions, 1);
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        std::vector<std::unique_ptr<SinkReceiver>> receivers;
+        for (size_t i = 0; i < subscriptions; ++i) {
+            receivers.emplace_back(new SinkReceiver(&transporter));
+            signaler.connect(1, receivers.back().get());
+        }
+        Variant message(42);
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < messages; ++i) {
+            signaler.notify(1, message);
+            if (i % 16 == 15) {
+                transporter.processMessages();
+            }
+        }
+        transporter.processMessages();
+
+        Benchmark::report("notify fan-out, " + std::to_string(subscriptions) + " receivers",
+                          messages * subscriptions, std::chrono::steady_clock::now() - start);
+    }
+
+    /**
+     * Times notify against broadcast on a single signal with many subscribers and a map payload, reporting both the
+     * time the publisher is blocked and the time until every receiver has the message
+     * @param subscriptions The number of receivers connected to the signal
+     */
+    static void benchmarkBroadcast(size_t subscriptions) {
+        const size_t messages = 20;
+        FanOutPool pool(4);
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        std::vector<std::unique_ptr<SinkReceiver>> receivers;
+        for (size_t i = 0; i < subscriptions; ++i) {
+            receivers.emplace_back(new SinkReceiver(&transporter));
+            signaler.connect(1, receivers.back().get());
+        }
+        VariantMap map;
+        for (int i = 0; i < 16; ++i) {
+            map["field" + std::to_string(i)] = std::string(32, 'x');
+        }
+        Variant message(map);
+
+        std::chrono::steady_clock::duration notifying(0);
+        for (size_t i = 0; i < messages; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            signaler.notify(1, message);
+            notifying += std::chrono::steady_clock::now() - start;
+            transporter.processMessages();
+        }
+
+        std::chrono::steady_clock::duration handingOff(0);
+        std::chrono::steady_clock::duration broadcasting(0);
+        for (size_t i = 0; i < messages; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            std::future<void> done = signaler.broadcast(1, message, pool);
+            handingOff += std::chrono::steady_clock::now() - start;
+            done.wait();
+            broadcasting += std::chrono::steady_clock::now() - start;
+            transporter.processMessages();
+        }
+
+        std::string suffix = ", " + std::to_string(subscriptions) + " receivers";
+        Benchmark::report("notify map" + suffix, messages, notifying);
+        Benchmark::report("broadcast hand-off" + suffix, messages, handingOff);
+        Benchmark::report("broadcast complete" + suffix, messages, broadcasting);
+    }
+
+    /**
+     * Times a processMessages tick when only one of many registered receivers has a message waiting
+     * @param receiverCount The number of registered receivers
+     */
+    static void benchmarkIdleReceivers(size_t receiverCount) {
+        const size_t ticks = 10000;
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        std::vector<std::unique_ptr<SinkReceiver>> receivers;
+        for (size_t i = 0; i < receiverCount; ++i) {
+            receivers.emplace_back(new SinkReceiver(&transporter));
+        }
+        signaler.connect(1, receivers.back().get());
+        Variant message(42);
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < ticks; ++i) {
+            signaler.notify(1, message);
+            transporter.processMessages();
+        }
+
+        Benchmark::report("tick, 1 of " + std::to_string(receiverCount) + " receivers busy", ticks,
+                          std::chrono::steady_clock::now() - start);
+    }
+
+    static void benchmarkSignaler() {
+        for (size_t subscriptions : {10, 1000, 100000}) {
+            benchmarkLookup(subscriptions);
+        }
+        for (size_t subscriptions : {10, 1000, 100000}) {
+            benchmarkFanOut(subscriptions);
+        }
+        benchmarkBroadcast(20000);
+        for (size_t receiverCount : {100, 50000}) {
+            benchmarkIdleReceivers(receiverCount);
+        }
+    }
+
+    static Benchmark signaler("Signaler", &benchmarkSignaler);
+}
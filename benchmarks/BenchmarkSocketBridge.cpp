@@ -0,0 +1,90 @@
+#include <chrono>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "benchmarks/Benchmark.h"
+#include "include/beammeup/SocketBridge.h"
+#include "include/beammeup/Transporter.h"
+
+namespace BeamMeUp {
+    /**
+     * Counts the messages that arrive in the child process
+     */
+    class CountingBridgeReceiver : public Receiver {
+    public:
+        CountingBridgeReceiver(Transporter *transporter) : Receiver(transporter), count(0) {
+        }
+
+        void processMessage(const Signal, const Variant &) override {
+            count++;
+        }
+
+        int count;
+    };
+
+    /**
+     * Streams small messages to a child process over a socket pair and reports the throughput
+     * @param label What to report
+     * @param flushEach Whether to flush after every message, rather than letting them batch up
+     */
+    static void stream(const std::string &label, bool flushEach) {
+        const int messages = 200000;
+        int sockets[2];
+        socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+
+        pid_t child = fork();
+        if (child == 0) {
+            close(sockets[0]);
+            Transporter transporter;
+            SocketBridge bridge(&transporter, sockets[1]);
+            CountingBridgeReceiver receiver(&transporter);
+            bridge.connect(1, &receiver, ConnectionOptions(C_DIRECT));
+            while (receiver.count < messages && bridge.isOpen()) {
+                bridge.waitForSocket(std::chrono::milliseconds(100));
+                bridge.processSocket();
+            }
+            // Tell the parent everything arrived
+            bridge.send(2, Variant(receiver.count));
+            bridge.flush();
+            _exit(0);
+        }
+
+        close(sockets[1]);
+        Transporter transporter;
+        SocketBridge bridge(&transporter, sockets[0]);
+        CountingBridgeReceiver done(&transporter);
+        bridge.connect(2, &done, ConnectionOptions(C_DIRECT));
+
+        Variant message(std::string(32, 'x'));
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < messages; i++) {
+            while (!bridge.send(1, message)) {
+                bridge.waitForSocket(std::chrono::milliseconds(100));
+                bridge.processSocket();
+            }
+            if (flushEach) {
+                bridge.flush();
+            }
+        }
+        while (done.count == 0 && bridge.isOpen()) {
+            bridge.flush();
+            bridge.waitForSocket(std::chrono::milliseconds(100));
+            bridge.processSocket();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        waitpid(child, nullptr, 0);
+        Benchmark::report(label, messages, elapsed);
+    }
+
+    /**
+     * Compares batched writes with a write per message
+     */
+    static void benchmarkSocketStream() {
+        stream("stream to another process, batched", false);
+        stream("stream to another process, flushed per message", true);
+    }
+
+    static Benchmark socketStream("SocketBridgeStream", &benchmarkSocketStream);
+}
@@ -0,0 +1,67 @@
+#ifndef BEAMMEUP_AFFINITY_H
+#define BEAMMEUP_AFFINITY_H
+
+#include <cstddef>
+
+namespace BeamMeUp {
+    /**
+     * Affinity pins threads to CPUs and places memory on NUMA nodes. Pinning is supported on Linux; elsewhere the
+     * calls report failure and everything runs unpinned. Node local allocation needs the library to be configured
+     * with -DENABLE_NUMA=ON (which links libnuma); otherwise memory comes from the heap and is placed by the OS, which
+     * on Linux means on the node of the thread that first writes it.
+     */
+    class Affinity {
+    public:
+        /**
+         * @return The number of CPUs the system has online
+         */
+        static int getCpuCount();
+
+        /**
+         * @return The CPU the calling thread is running on, or -1 if that can't be found out
+         */
+        static int getCurrentCpu();
+
+        /**
+         * @param cpu A CPU
+         * @return The NUMA node the CPU belongs to, or -1 if it isn't known
+         */
+        static int getNode(int cpu);
+
+        /**
+         * Restricts the calling thread to one CPU
+         * @param cpu The CPU
+         * @return false if the thread couldn't be pinned
+         */
+        static bool pinCurrentThread(int cpu);
+
+        /**
+         * Lets the calling thread run on any CPU again
+         * @return false if the affinity couldn't be changed
+         */
+        static bool unpinCurrentThread();
+
+        /**
+         * @return true if memory can be allocated on a given node, rather than wherever the OS puts it
+         */
+        static bool canAllocateOnNode();
+
+        /**
+         * Allocates memory on a NUMA node. Throws std::bad_alloc on failure.
+         * @param bytes The number of bytes
+         * @param node The node, or -1 for no preference
+         * @return The memory, which must be freed with deallocate and the same bytes and node
+         */
+        static void *allocate(size_t bytes, int node);
+
+        /**
+         * Frees memory from allocate
+         * @param memory The memory
+         * @param bytes The number of bytes it was allocated with
+         * @param node The node it was allocated with
+         */
+        static void deallocate(void *memory, size_t bytes, int node);
+    };
+}
+
+#endif //BEAMMEUP_AFFINITY_H
@@ -0,0 +1,96 @@
+#if !defined(BEAMMEUP_CHANNEL_H) && defined(THREAD_SAFE)
+#define BEAMMEUP_CHANNEL_H
+
+#include <atomic>
+#include <mutex>
+
+#include "MessageQueue.h"
+#include "RingBuffer.h"
+#include "Types.h"
+#include "Variant.h"
+#include "VariantVector.h"
+
+namespace BeamMeUp {
+    /**
+     * Channel carries the messages of a single C_SPSC connection from its Signaler to its Receiver. Messages normally
+     * go through a lock-free ring. If the receiver falls far enough behind that the ring fills, messages spill into
+     * a mutex protected overflow queue until the receiver has caught up, so the producer never blocks and ordering is
+     * preserved.
+     */
+    class Channel {
+    public:
+        /**
+         * Initializes the channel
+         * @param transporter The receiver's transporter, which is told about queued messages. May be nullptr.
+         * @param capacity The capacity of the ring
+         * @param receiver The receiver consuming the channel, which is marked ready when messages are pushed. May be
+         * nullptr.
+         */
+        Channel(Transporter *transporter, size_t capacity, Receiver *receiver = nullptr);
+
+        /**
+         * Adds a message. Must only be called from one thread at a time.
+         * @param signal The signal
+         * @param message The message to copy
+         */
+        void push(Signal signal, const Variant &message);
+
+        /**
+         * Adds several messages on the same signal. Must only be called from one thread at a time.
+         * @param signal The signal
+         * @param messages The messages to copy, in order
+         */
+        void pushBatch(Signal signal, const VariantVector &messages);
+
+        /**
+         * Removes a message. Must only be called from the receiver's processing thread.
+         * @param signal Set to the message's signal
+         * @param message Receives the message
+         * @return false if the channel is empty
+         */
+        bool pop(Signal &signal, Variant &message);
+
+        /**
+         * @return true if there are no messages in the channel
+         */
+        bool empty();
+
+        /**
+         * @return The number of messages in the channel
+         */
+        size_t size();
+
+        /**
+         * @return The number of messages the ring holds before spilling into the overflow queue
+         */
+        size_t capacity() const;
+
+        /**
+         * Marks the channel as closed. Messages already in it can still be popped.
+         */
+        void close();
+
+        /**
+         * @return true if the channel has been closed
+         */
+        bool isClosed() const;
+
+    private:
+        /**
+         * Adds a message without telling the transporter
+         * @param signal The signal
+         * @param message The message to copy
+         */
+        void pushMessage(Signal signal, const Variant &message);
+
+        Transporter *transporter;
+        Receiver *receiver;
+        RingBuffer ring;
+        std::atomic_bool overflowed;
+        std::atomic_bool closed;
+        MessageQueue overflow;
+        std::mutex overflowMutex;
+    };
+}
+
+#endif //BEAMMEUP_CHANNEL_H
@@ -0,0 +1,71 @@
+#if !defined(BEAMMEUP_CHECKPOINT_H) && !defined(_WIN32)
+#define BEAMMEUP_CHECKPOINT_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Types.h"
+
+namespace BeamMeUp {
+    /**
+     * Checkpoint saves the messages waiting in receivers' mailboxes, and the connections between signalers and
+     * receivers, to a file, so a restarted process can pick up where the last one left off. Objects are identified by
+     * names given with add, since their addresses change from one process to the next: only named objects are saved,
+     * and on restore their state goes to the objects added under the same names.
+     *
+     * The file is laid out to be read straight through from a read only mapping. Each receiver's messages are stored
+     * together, encoded with VariantCodec, and restored into its mailbox with one lock and one reservation, so
+     * restoring costs little more than decoding each message.
+     *
+     * Requests are saved as plain messages, as their requesters won't exist after a restart. Connections with filters
+     * aren't saved. Restored C_DIRECT connections deliver inline on the thread that called restore.
+     */
+    class Checkpoint {
+    public:
+        /**
+         * Initializes an empty checkpoint
+         * @param transporter The transporter to quiesce while saving
+         */
+        Checkpoint(Transporter *transporter);
+
+        /**
+         * Names a receiver, so its mailbox and the connections to it are saved and restored
+         * @param name A name unique among the receivers
+         * @param receiver The receiver
+         */
+        void add(const std::string &name, Receiver *receiver);
+
+        /**
+         * Names a signaler, so its connections to named receivers are saved and restored
+         * @param name A name unique among the signalers
+         * @param signaler The signaler
+         */
+        void add(const std::string &name, Signaler *signaler);
+
+        /**
+         * Quiesces the transporter (unless it already is), writes the snapshot and resumes it. Messages stay queued.
+         * Stop any dispatchers first. Throws std::runtime_error if the file can't be written.
+         * @param path Where to write. The file is replaced.
+         * @return The number of messages saved
+         */
+        size_t save(const std::string &path);
+
+        /**
+         * Restores a snapshot to the named objects. Connections that already exist aren't made twice. Messages are
+         * queued behind any already in the mailboxes. State for names that haven't been added is skipped. Throws
+         * std::runtime_error if the file can't be read or isn't a valid snapshot; anything restored before the problem
+         * was found stays restored.
+         * @param path The snapshot
+         * @return The number of messages restored
+         */
+        size_t restore(const std::string &path);
+
+    private:
+        Transporter *transporter;
+        std::vector<std::pair<std::string, Receiver *>> receivers;
+        std::vector<std::pair<std::string, Signaler *>> signalers;
+    };
+}
+
+#endif //BEAMMEUP_CHECKPOINT_H
@@ -0,0 +1,88 @@
+#ifndef BEAMMEUP_CONNECTIONFILTER_H
+#define BEAMMEUP_CONNECTIONFILTER_H
+
+#ifdef THREAD_SAFE
+#include <atomic>
+#endif
+#include <functional>
+#include <string>
+
+#include "Types.h"
+#include "Variant.h"
+
+namespace BeamMeUp {
+    typedef enum {
+        F_EQUAL = 0,
+        F_NOT_EQUAL = 10,
+        F_LESS = 20,
+        F_LESS_EQUAL = 30,
+        F_GREATER = 40,
+        F_GREATER_EQUAL = 50
+    } FilterOperator;
+
+    /**
+     * ConnectionFilter decides, inside notify, whether a message is worth delivering through a connection. Rejected
+     * messages are never copied or queued. It counts what it accepts (hits) and rejects (misses). Filters may be shared
+     * by several connections, in which case the counts are totals. accept is called concurrently by notifying threads,
+     * so callables must be thread safe in the thread safe build.
+     */
+    class ConnectionFilter {
+    public:
+        typedef std::function<bool(Signal signal, const Variant &message)> Predicate;
+
+        /**
+         * Initializes a filter that runs a callable
+         * @param predicate Returns true for messages to deliver
+         */
+        ConnectionFilter(const Predicate &predicate);
+
+        /**
+         * Initializes a filter that compares a field of VariantMap messages with a value. Messages that aren't maps,
+         * or don't have the field, are rejected.
+         * @param field The key to look up. If empty, the whole message is compared.
+         * @param op How to compare
+         * @param value What to compare with, using Variant's comparison operators
+         */
+        ConnectionFilter(const std::string &field, FilterOperator op, const Variant &value);
+
+        /**
+         * Tests a message, counting the outcome
+         * @param signal The signal being notified
+         * @param message The message
+         * @return true if it should be delivered
+         */
+        bool accept(Signal signal, const Variant &message);
+
+        /**
+         * @return The number of messages accepted
+         */
+        unsigned long long getHits() const;
+
+        /**
+         * @return The number of messages rejected
+         */
+        unsigned long long getMisses() const;
+
+    private:
+        /**
+         * Evaluates the field expression
+         * @param message The message
+         * @return true if it matches
+         */
+        bool compare(const Variant &message) const;
+
+        Predicate predicate;
+        std::string field;
+        FilterOperator op;
+        Variant value;
+#ifdef THREAD_SAFE
+        std::atomic<unsigned long long> hits;
+        std::atomic<unsigned long long> misses;
+#else
+        unsigned long long hits;
+        unsigned long long misses;
+#endif
+    };
+}
+
+#endif //BEAMMEUP_CONNECTIONFILTER_H
@@ -0,0 +1,49 @@
+#ifndef BEAMMEUP_CONNECTIONOPTIONS_H
+#define BEAMMEUP_CONNECTIONOPTIONS_H
+
+#include <cstddef>
+#include <memory>
+
+#include "Types.h"
+
+namespace BeamMeUp {
+    typedef enum {
+        // Messages are copied into the receiver's mailbox. Safe for any number of emitting threads.
+        C_QUEUED = 0,
+        // Messages are copied into a lock-free ring owned by the connection. Only one thread may notify through the
+        // connection at a time. Falls back to C_QUEUED in the thread unsafe build.
+        C_SPSC = 10,
+        // processMessage is called inline by notify, with the message passed by reference. Only used when notify is
+        // called on the thread that made the connection, and the receiver isn't already processing a message on it;
+        // otherwise the message is queued. Direct messages can overtake queued ones.
+        C_DIRECT = 20
+    } ConnectionType;
+
+    /**
+     * ConnectionOptions controls how a Signaler delivers messages to a connected Receiver.
+     */
+    class ConnectionOptions {
+    public:
+        static const size_t DEFAULT_CAPACITY;
+
+        /**
+         * Initializes the options
+         * @param type The connection type
+         * @param capacity The number of messages a C_SPSC ring can hold before spilling into a locked overflow queue.
+         * Rounded up to a power of 2.
+         */
+        ConnectionOptions(ConnectionType type = C_QUEUED, size_t capacity = DEFAULT_CAPACITY);
+
+        /**
+         * Initializes queued options with a filter
+         * @param filter Run by notify before delivering each message. Keep a reference to read its counts.
+         */
+        ConnectionOptions(const std::shared_ptr<ConnectionFilter> &filter);
+
+        ConnectionType type;
+        size_t capacity;
+        std::shared_ptr<ConnectionFilter> filter;
+    };
+}
+
+#endif //BEAMMEUP_CONNECTIONOPTIONS_H
@@ -0,0 +1,203 @@
+#ifndef BEAMMEUP_CONNECTIONTABLE_H
+#define BEAMMEUP_CONNECTIONTABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#ifdef THREAD_SAFE
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+#include <vector>
+
+#include "Types.h"
+
+namespace BeamMeUp {
+    /**
+     * A Signaler's link to one Receiver on one signal
+     */
+    struct Connection {
+        Signal signal;
+        Receiver *receiver;
+        // The receiver's handle with the signaler's transporter, or 0 if it isn't registered with it
+        ReceiverHandle handle;
+        // Set if messages should be filtered before they are delivered
+        std::shared_ptr<ConnectionFilter> filter;
+        // Set for C_DIRECT connections
+        bool direct;
+        // Set for connections made for a topic pattern subscription
+        bool subscribed;
+#ifdef THREAD_SAFE
+        // Set for C_SPSC connections
+        std::shared_ptr<Channel> channel;
+        // The thread that made a C_DIRECT connection, the only one that delivers through it inline
+        std::thread::id thread;
+#endif
+    };
+
+    /**
+     * Lets receivers reach the signalers connected to them. It outlives its signaler, which sets signaler to nullptr
+     * (with mutex held) when it is destroyed, once no receiver is using it.
+     */
+    struct SignalerLink {
+        Signaler *signaler;
+#ifdef THREAD_SAFE
+        std::mutex mutex;
+        // The number of receivers using signaler without holding mutex, and signalled when it drops to 0
+        unsigned int users;
+        std::condition_variable released;
+#endif
+    };
+
+    /**
+     * ConnectionTable maps signals to their connections for a Signaler. It is built for notify: readers find a
+     * signal's connections in an open addressing index and walk them as one contiguous array, without taking any
+     * locks. Readers must hold an Epoch::Guard for as long as they use what they find.
+     *
+     * Writers never modify anything a reader can see. Connecting appends past the end of a signal's array and then
+     * publishes the new length; disconnecting, or outgrowing the array or the index, publishes a replacement and
+     * retires the old one through Epoch. Writers must be serialized by the caller.
+     */
+    class ConnectionTable {
+    public:
+        /**
+         * The connections for one signal. Readers see a consistent prefix even while connections are added.
+         */
+        class List {
+            friend class ConnectionTable;
+
+        public:
+            /**
+             * @return The number of connections
+             */
+            size_t size() const;
+
+            /**
+             * @param index The connection's index
+             * @return The connection
+             */
+            const Connection &operator[](size_t index) const;
+
+        private:
+            /**
+             * Initializes an empty list
+             * @param capacity The number of connections it can hold
+             */
+            List(size_t capacity);
+
+            ~List();
+
+            std::atomic<size_t> count;
+            size_t capacity;
+            Connection *connections;
+        };
+
+        typedef std::function<bool(const Connection &connection)> Matcher;
+
+        /**
+         * Initializes an empty table
+         */
+        ConnectionTable();
+
+        /**
+         * Frees the table. There must be no readers.
+         */
+        ~ConnectionTable();
+
+        /**
+         * Finds a signal's connections
+         * @param signal The signal
+         * @return The connections, or nullptr if there are none
+         */
+        const List *find(Signal signal) const;
+
+        /**
+         * Calls visit for every connection, grouped by signal, in the order they were added within each signal
+         * @param visit The function to call
+         */
+        void forEach(const std::function<void(Signal signal, const Connection &connection)> &visit) const;
+
+        /**
+         * Adds a connection
+         * @param signal The signal
+         * @param connection The connection
+         */
+        void add(Signal signal, const Connection &connection);
+
+        /**
+         * Removes a signal's matching connections
+         * @param signal The signal
+         * @param matches Selects the connections to remove
+         * @param removed Receives the removed connections
+         */
+        void remove(Signal signal, const Matcher &matches, std::vector<Connection> &removed);
+
+        /**
+         * Removes matching connections on every signal
+         * @param matches Selects the connections to remove
+         * @param removed Receives the removed connections
+         */
+        void removeAll(const Matcher &matches, std::vector<Connection> &removed);
+
+    private:
+        struct Slot {
+            std::atomic<Signal> signal;
+            // nullptr if the slot has never been used. A list of size 0 marks a signal with no connections left.
+            std::atomic<List *> list;
+        };
+
+        struct Index {
+            /**
+             * Initializes an empty index
+             * @param bits log2 of the number of slots
+             */
+            Index(unsigned int bits);
+
+            ~Index();
+
+            unsigned int bits;
+            size_t mask;
+            // Slots with a signal, including those whose list is now empty. Only used by writers.
+            size_t used;
+            Slot *slots;
+        };
+
+        /**
+         * Finds the slot for a signal
+         * @param index The index to search
+         * @param signal The signal
+         * @return The signal's slot, or the empty slot where it would go
+         */
+        static Slot *findSlot(Index *index, Signal signal);
+
+        /**
+         * Removes a list's matching connections
+         * @param slot The list's slot
+         * @param matches Selects the connections to remove
+         * @param removed Receives the removed connections
+         */
+        static void removeFromSlot(Slot &slot, const Matcher &matches, std::vector<Connection> &removed);
+
+        /**
+         * Replaces the index with a larger one, dropping empty lists
+         */
+        void grow();
+
+        static void deleteList(void *list);
+
+        static void deleteIndex(void *index);
+
+        static const unsigned int MIN_INDEX_BITS;
+        static const size_t MIN_LIST_CAPACITY;
+
+        std::atomic<Index *> index;
+
+        ConnectionTable(const ConnectionTable &) = delete;
+
+        ConnectionTable &operator=(const ConnectionTable &) = delete;
+    };
+}
+
+#endif //BEAMMEUP_CONNECTIONTABLE_H
@@ -0,0 +1,92 @@
+#if !defined(BEAMMEUP_COROUTINE_H) && defined(BEAMMEUP_COROUTINES)
+#define BEAMMEUP_COROUTINE_H
+
+#include <chrono>
+#include <coroutine>
+#include <optional>
+
+#include "Types.h"
+#include "Variant.h"
+
+namespace BeamMeUp {
+    /**
+     * Conversation is the return type for coroutines that talk to receivers. It starts running as soon as it is
+     * called and, at each co_await on Receiver::next, suspends until Transporter::processMessages resumes it with a
+     * message. There is no thread behind a conversation: a suspended one costs only its frame. The frame frees itself
+     * when the coroutine returns. Exceptions escaping the coroutine propagate out of whatever resumed it, and the
+     * frame is freed on the way.
+     */
+    class Conversation {
+    public:
+        struct promise_type {
+            Conversation get_return_object() {
+                return Conversation();
+            }
+
+            std::suspend_never initial_suspend() noexcept {
+                return {};
+            }
+
+            std::suspend_never final_suspend() noexcept {
+                return {};
+            }
+
+            void return_void() {
+            }
+
+            void unhandled_exception() {
+                throw;
+            }
+        };
+    };
+
+    /**
+     * MessageAwaiter is returned by Receiver::next. co_await-ing it suspends the coroutine until the receiver
+     * processes a message on the awaited signal, which is then handed to the coroutine instead of processMessage.
+     * If several coroutines await the same signal, the one that started waiting first gets the message.
+     */
+    class MessageAwaiter {
+        friend class Receiver;
+
+    public:
+        /**
+         * Initializes the awaiter
+         * @param receiver The receiver to wait on
+         * @param signal The signal to wait for
+         * @param timeout How long to wait. duration::max() waits forever.
+         */
+        MessageAwaiter(Receiver *receiver, Signal signal, std::chrono::steady_clock::duration timeout);
+
+        /**
+         * @return false, messages are only ever handed over by processMessages
+         */
+        bool await_ready() const noexcept;
+
+        /**
+         * Starts waiting
+         * @param handle The suspending coroutine
+         */
+        void await_suspend(std::coroutine_handle<> handle);
+
+        /**
+         * @return The message, or nothing if the wait timed out
+         */
+        std::optional<Variant> await_resume();
+
+    private:
+        /**
+         * Resumes the waiting coroutine. A coroutine that ends with an exception is left suspended at its final
+         * suspend point rather than freeing itself, so its frame is destroyed here before the exception is passed on.
+         */
+        void resume();
+
+        Receiver *receiver;
+        Signal signal;
+        std::chrono::steady_clock::duration timeout;
+        std::coroutine_handle<> handle;
+        std::optional<Variant> message;
+        TimerId timer;
+    };
+}
+
+#endif //BEAMMEUP_COROUTINE_H
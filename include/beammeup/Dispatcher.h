@@ -0,0 +1,242 @@
+#if !defined(BEAMMEUP_DISPATCHER_H) && defined(THREAD_SAFE)
+#define BEAMMEUP_DISPATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Types.h"
+
+namespace BeamMeUp {
+    /**
+     * Dispatcher processes a transporter's receivers on a pool of worker threads, instead of on whichever thread calls
+     * Transporter::processMessages. Each worker has its own queue of receivers with messages waiting; a worker with
+     * nothing to do steals from the others, and when every queue is empty one idle worker fires the transporter's
+     * timers and reply callbacks and takes the receivers on the transporter's ready list. A receiver is only ever
+     * processed by one thread at a time, so processMessage implementations need no locking of their own, but
+     * different receivers are processed in parallel.
+     *
+     * Workers can be pinned to CPUs, and receivers to workers, so that receivers sharing data run on the same core.
+     * Pinned receivers are never stolen, and their mailboxes are allocated on their worker's NUMA node. They can be
+     * moved to another worker at any time, by hand or by the rebalancer, which evens out the workers' loads using the
+     * time each receiver spends processing.
+     *
+     * An exception thrown by a handler on a worker doesn't end the thread. The receiver keeps the rest of its messages
+     * and the exception is kept for takeError.
+     */
+    class Dispatcher {
+    public:
+        static const unsigned int BATCH_SIZE;
+        static const std::chrono::microseconds IDLE_WAIT;
+        static const unsigned int MAX_MIGRATIONS;
+
+        /**
+         * Initializes the dispatcher. Nothing runs until start is called.
+         * @param transporter The transporter whose receivers to process. It must outlive the dispatcher.
+         * @param threads The number of workers. At least one is started.
+         */
+        Dispatcher(Transporter *transporter, unsigned int threads = std::thread::hardware_concurrency());
+
+        /**
+         * Initializes the dispatcher with one worker pinned to each of the given CPUs. Nothing runs until start is
+         * called.
+         * @param transporter The transporter whose receivers to process. It must outlive the dispatcher.
+         * @param cpus The CPUs to run workers on. Throws std::runtime_error if empty.
+         */
+        Dispatcher(Transporter *transporter, const std::vector<int> &cpus);
+
+        /**
+         * Stops the workers
+         */
+        ~Dispatcher();
+
+        /**
+         * Starts the workers. Does nothing if they are already running.
+         */
+        void start();
+
+        /**
+         * Stops the workers, waiting for each to finish the receiver it is processing. Messages still queued stay
+         * queued, and are picked up by Transporter::processMessages or the next start.
+         */
+        void stop();
+
+        /**
+         * @return The number of workers
+         */
+        unsigned int getThreads() const;
+
+        /**
+         * @param worker A worker's index
+         * @return The CPU the worker is pinned to, or -1 if it isn't pinned
+         */
+        int getWorkerCpu(unsigned int worker) const;
+
+        /**
+         * Has one worker process a receiver from now on. If the worker is pinned to a CPU, the receiver's mailbox
+         * grows on that CPU's NUMA node, so pin receivers before they get busy. A pinned receiver can be pinned again
+         * to move it while running; its queued messages go with it, in order. Throws std::runtime_error if there is
+         * no such worker.
+         * @param receiver The receiver, which must belong to this dispatcher's transporter
+         * @param worker The worker's index
+         */
+        void pin(Receiver *receiver, unsigned int worker);
+
+        /**
+         * Has the worker pinned to a CPU process a receiver from now on. Throws std::runtime_error if no worker is
+         * pinned to the CPU.
+         * @param receiver The receiver, which must belong to this dispatcher's transporter
+         * @param cpu The CPU
+         */
+        void pinToCpu(Receiver *receiver, int cpu);
+
+        /**
+         * Lets any worker process a receiver again
+         * @param receiver The receiver
+         */
+        void unpin(Receiver *receiver);
+
+        /**
+         * @param receiver A receiver
+         * @return The worker the receiver is pinned to, or -1 if it isn't pinned
+         */
+        int getAffinity(const Receiver *receiver) const;
+
+        /**
+         * Rebalances the pinned receivers automatically
+         * @param interval How often to rebalance. Zero (the default) turns automatic rebalancing off.
+         */
+        void setRebalanceInterval(std::chrono::steady_clock::duration interval);
+
+        /**
+         * Moves pinned receivers from the busiest workers to the idlest, judged by how long each receiver has spent
+         * processing since the last rebalance. Up to MAX_MIGRATIONS receivers are moved, each only if that narrows the
+         * gap between the two workers.
+         * @return The number of receivers moved
+         */
+        unsigned int rebalance();
+
+        /**
+         * @return The first exception a handler threw on a worker since the last call, or null if none has
+         */
+        std::exception_ptr takeError();
+
+        /**
+         * @return The number of exceptions handlers have thrown on the workers
+         */
+        unsigned long long getErrorCount() const;
+
+    private:
+        /**
+         * A receiver with messages waiting
+         */
+        struct Task {
+            Receiver *receiver;
+            ReceiverHandle handle;
+        };
+
+        struct Worker {
+            std::thread thread;
+            // The CPU the thread is pinned to, or -1
+            int cpu;
+            std::mutex mutex;
+            // Receivers any worker may take
+            std::deque<Task> tasks;
+            // Receivers pinned to this worker, which others leave alone
+            std::deque<Task> pinned;
+        };
+
+        /**
+         * Runs a worker until stop is called
+         * @param index The worker's index
+         */
+        void run(unsigned int index);
+
+        /**
+         * Takes the oldest task from a worker's own queues, alternating between its pinned and unpinned receivers
+         * @param index The worker's index
+         * @param task Receives the task
+         * @return false if the queues were empty
+         */
+        bool popTask(unsigned int index, Task &task);
+
+        /**
+         * Takes the oldest unpinned task from another worker's queue
+         * @param index The stealing worker's index
+         * @param task Receives the task
+         * @return false if every other queue was empty
+         */
+        bool stealTask(unsigned int index, Task &task);
+
+        /**
+         * Queues a task, on its receiver's worker if it is pinned, waking an idle worker
+         * @param index The worker to queue an unpinned task for
+         * @param task The task
+         */
+        void pushTask(unsigned int index, const Task &task);
+
+        /**
+         * Processes a batch of a receiver's messages, queueing it again if it has more
+         * @param index The worker's index
+         * @param task The task
+         */
+        void process(unsigned int index, const Task &task);
+
+        /**
+         * Fires timers, calls reply callbacks and queues tasks for the receivers on the transporter's ready list
+         * @param index The scanning worker's index. Unpinned tasks are dealt out starting with it.
+         * @return true if any tasks were queued
+         */
+        bool schedule(unsigned int index);
+
+        /**
+         * Waits for something to do
+         */
+        void idle();
+
+        /**
+         * Rebalances if automatic rebalancing is on and it is time. Only one worker does each time.
+         * @param now The current time
+         */
+        void checkRebalance(std::chrono::steady_clock::time_point now);
+
+        /**
+         * Takes a receiver's queued task off whichever other worker has it pinned and gives it to its new worker
+         * @param receiver The receiver
+         * @param worker The receiver's new worker
+         */
+        void moveTask(Receiver *receiver, unsigned int worker);
+
+        Dispatcher(const Dispatcher &) = delete;
+
+        Dispatcher &operator=(const Dispatcher &) = delete;
+
+        Transporter *transporter;
+        unsigned int threads;
+        std::vector<std::unique_ptr<Worker>> workers;
+        bool running;
+        std::atomic_bool stopping;
+        // Held by the worker looking for new work, so only one does at a time
+        std::mutex scanMutex;
+        std::mutex idleMutex;
+        std::condition_variable idleCondition;
+        // Every pinned receiver, for the rebalancer
+        std::unordered_map<Receiver *, ReceiverHandle> pinnedReceivers;
+        std::mutex pinMutex;
+        std::mutex rebalanceMutex;
+        std::atomic<std::chrono::steady_clock::rep> rebalanceInterval;
+        std::atomic<std::chrono::steady_clock::rep> nextRebalance;
+        std::mutex errorMutex;
+        std::exception_ptr error;
+        std::atomic<unsigned long long> errors;
+    };
+}
+
+#endif //BEAMMEUP_DISPATCHER_H
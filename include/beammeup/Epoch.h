@@ -0,0 +1,69 @@
+#ifndef BEAMMEUP_EPOCH_H
+#define BEAMMEUP_EPOCH_H
+
+#include <cstddef>
+
+namespace BeamMeUp {
+    /**
+     * Epoch implements epoch based reclamation, which lets readers use shared structures without taking locks.
+     * Readers wrap each access in a Guard. Writers publish a replacement and retire the old version, which is freed
+     * once every reader that might still be looking at it has left its guard. Guards nest and are cheap: entering
+     * one is a thread local lookup, a store and a fence.
+     */
+    class Epoch {
+    public:
+        /**
+         * Guard marks the calling thread as reading for its lifetime
+         */
+        class Guard {
+        public:
+            Guard();
+
+            ~Guard();
+
+        private:
+            Guard(const Guard &) = delete;
+
+            Guard &operator=(const Guard &) = delete;
+        };
+
+        typedef void (*Deleter)(void *object);
+
+        /**
+         * Frees an object once no reader can be using it. The object must already be unreachable for new readers.
+         * @param object The object
+         * @param deleter Frees the object
+         */
+        static void retire(void *object, Deleter deleter);
+
+        /**
+         * Waits until every reader that might have seen something unpublished before this call has left its guard.
+         * Readers on the calling thread are not waited for, so this may be called from inside a guard.
+         */
+        static void synchronize();
+
+        /**
+         * Frees whatever retired objects are no longer in use. retire does this itself, so this is only needed to
+         * release memory sooner.
+         */
+        static void reclaim();
+
+        /**
+         * @return The number of retired objects not yet freed
+         */
+        static size_t pending();
+
+    private:
+        /**
+         * Marks the calling thread as reading
+         */
+        static void enter();
+
+        /**
+         * Marks the calling thread as no longer reading, if this was its outermost guard
+         */
+        static void leave();
+    };
+}
+
+#endif //BEAMMEUP_EPOCH_H
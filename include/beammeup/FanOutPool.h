@@ -0,0 +1,71 @@
+#if !defined(BEAMMEUP_FANOUTPOOL_H) && defined(THREAD_SAFE)
+#define BEAMMEUP_FANOUTPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace BeamMeUp {
+    /**
+     * FanOutPool is a set of worker threads that Signaler::broadcast uses to queue a message for a large number of
+     * receivers in parallel. Each worker runs its tasks in the order they were submitted, and each receiver is always
+     * served by the same worker, so broadcasts reach every receiver in the order they were made. A pool can be shared
+     * by any number of signalers.
+     */
+    class FanOutPool {
+        friend class Signaler;
+
+    public:
+        /**
+         * Starts the workers
+         * @param threads The number of workers. At least one is started.
+         */
+        FanOutPool(unsigned int threads = std::thread::hardware_concurrency());
+
+        /**
+         * Finishes any queued broadcasts and stops the workers
+         */
+        ~FanOutPool();
+
+        /**
+         * @return The number of workers
+         */
+        unsigned int getThreads() const;
+
+    private:
+        typedef std::function<void()> Task;
+
+        struct Worker {
+            std::thread thread;
+            std::mutex mutex;
+            std::condition_variable condition;
+            std::deque<Task> tasks;
+            bool stopping;
+        };
+
+        /**
+         * Queues a task for a worker
+         * @param worker The worker's index
+         * @param task The task
+         */
+        void submit(unsigned int worker, Task &&task);
+
+        /**
+         * Runs a worker's tasks until it is stopped and has none left
+         * @param worker The worker
+         */
+        static void run(Worker *worker);
+
+        FanOutPool(const FanOutPool &) = delete;
+
+        FanOutPool &operator=(const FanOutPool &) = delete;
+
+        std::vector<std::unique_ptr<Worker>> workers;
+    };
+}
+
+#endif //BEAMMEUP_FANOUTPOOL_H
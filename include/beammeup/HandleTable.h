@@ -0,0 +1,95 @@
+#ifndef BEAMMEUP_HANDLETABLE_H
+#define BEAMMEUP_HANDLETABLE_H
+
+#include <atomic>
+#include <cstddef>
+#ifdef THREAD_SAFE
+#include <mutex>
+#endif
+
+#include "Types.h"
+
+namespace BeamMeUp {
+    /**
+     * HandleTable is a slot map that gives each registered receiver a handle. A handle is the receiver's slot index
+     * plus the slot's generation, which changes whenever the slot is freed, so checking whether a handle is still
+     * valid is a single atomic load, with no locks and no hashing. Slots are allocated in chunks that never move, so
+     * readers need no protection beyond their own handle.
+     */
+    class HandleTable {
+    public:
+        /**
+         * Initializes an empty table
+         */
+        HandleTable();
+
+        /**
+         * Frees the slots
+         */
+        ~HandleTable();
+
+        /**
+         * Assigns a slot
+         * @param receiver The receiver to assign it to
+         * @return The handle. Never 0.
+         */
+        ReceiverHandle add(Receiver *receiver);
+
+        /**
+         * Frees a slot, invalidating its handle
+         * @param handle The handle. Ignored if already invalid.
+         */
+        void remove(ReceiverHandle handle);
+
+        /**
+         * @param handle The handle
+         * @return true if the handle's receiver hasn't been removed
+         */
+        bool isValid(ReceiverHandle handle) const;
+
+        /**
+         * @param handle The handle
+         * @return The handle's receiver, or nullptr if it has been removed
+         */
+        Receiver *get(ReceiverHandle handle) const;
+
+        /**
+         * @return The number of receivers in the table
+         */
+        size_t size() const;
+
+    private:
+        struct Slot {
+            // Odd while the slot is in use, even while it is free
+            std::atomic<unsigned int> generation;
+            std::atomic<Receiver *> receiver;
+            // The next free slot, while this one is free
+            unsigned int nextFree;
+        };
+
+        /**
+         * @param index The slot's index
+         * @return The slot, or nullptr if it hasn't been allocated
+         */
+        Slot *getSlot(unsigned int index) const;
+
+        static const unsigned int CHUNK_BITS;
+        static const unsigned int MAX_CHUNKS;
+        static const unsigned int NO_SLOT;
+
+        std::atomic<Slot *> *chunks;
+        // Only touched by writers
+        unsigned int slotCount;
+        unsigned int freeSlot;
+        size_t used;
+#ifdef THREAD_SAFE
+        mutable std::mutex mutex;
+#endif
+
+        HandleTable(const HandleTable &) = delete;
+
+        HandleTable &operator=(const HandleTable &) = delete;
+    };
+}
+
+#endif //BEAMMEUP_HANDLETABLE_H
@@ -0,0 +1,162 @@
+#if !defined(BEAMMEUP_JOURNAL_H) && !defined(_WIN32)
+#define BEAMMEUP_JOURNAL_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Receiver.h"
+
+namespace BeamMeUp {
+    typedef enum {
+        // Leave writing to disk to the OS. Survives the process crashing, but not the host.
+        JS_NONE = 0,
+        // Sync an interval after the first message appended since the last sync, covering everything appended by then
+        // (group commit). The sync is a transporter timer, so the transporter must be processed.
+        JS_INTERVAL = 10,
+        // Sync after every message
+        JS_EVERY = 20
+    } JournalSync;
+
+    /**
+     * Journal records the messages it receives in a directory of memory mapped segment files, for replay by a
+     * JournalReplayer after a restart or for post-mortems. Connect the signals to record to it; with C_DIRECT
+     * connections notify encodes each message straight into the mapped segment, so recording costs about a copy of
+     * the message. Messages on other connections are recorded when the journal is processed.
+     *
+     * Each record holds the signal, the wall clock time and the message encoded with VariantCodec. Segments are
+     * allocated at full size and trimmed when the journal moves on from them. A journal opened on a directory that
+     * already has segments starts a new one after them.
+     */
+    class Journal : public Receiver {
+    public:
+        static const size_t DEFAULT_SEGMENT_SIZE;
+        // Each segment starts with SEGMENT_MAGIC, then the records from SEGMENT_HEADER_SIZE on
+        static const unsigned int SEGMENT_MAGIC;
+        static const size_t SEGMENT_HEADER_SIZE;
+
+        /**
+         * Precedes each record's encoded message. Records start on 8 byte boundaries. A length of 0 ends the segment,
+         * as every encoded message takes at least a byte. The length is stored last with release ordering, so a record
+         * cut short by a crash reads as the end, and a reader that loads it with acquire ordering sees the rest.
+         */
+        struct RecordHeader {
+            std::atomic<unsigned int> length;
+            Signal signal;
+            // Nanoseconds since the system clock's epoch
+            long long time;
+        };
+
+        /**
+         * Opens a new segment in the directory, creating the directory if needed. Throws std::runtime_error if the
+         * segment can't be created.
+         * @param transporter The transporter to register with
+         * @param directory Where to keep the segments
+         * @param sync When to sync appended messages to disk
+         * @param syncInterval The time between syncs, for JS_INTERVAL
+         * @param segmentSize The size of each segment. Messages larger than this are dropped.
+         */
+        Journal(Transporter *transporter, const std::string &directory, JournalSync sync = JS_NONE,
+                std::chrono::milliseconds syncInterval = std::chrono::milliseconds(10),
+                size_t segmentSize = DEFAULT_SEGMENT_SIZE);
+
+        /**
+         * Stops deliveries, then syncs, unless the policy is JS_NONE, and closes the current segment
+         */
+        ~Journal();
+
+        /**
+         * Writes everything appended so far to disk
+         */
+        void sync();
+
+        /**
+         * @return true if everything appended has been synced to disk
+         */
+        bool isSynced();
+
+        /**
+         * @return The number of messages recorded
+         */
+        unsigned long long getRecorded() const;
+
+        /**
+         * @return The number of messages dropped, because they were too large or a new segment couldn't be created
+         */
+        unsigned long long getDropped() const;
+
+        /**
+         * @return The number of segments this journal has written to
+         */
+        unsigned int getSegmentCount() const;
+
+        /**
+         * @param directory A journal's directory
+         * @return The paths of its segments, oldest first
+         */
+        static std::vector<std::string> listSegments(const std::string &directory);
+
+    protected:
+        /**
+         * Appends the message to the journal
+         * @param signal The signal
+         * @param message The message
+         */
+        void processMessage(const Signal signal, const Variant &message) override;
+
+    private:
+        class SyncTimer;
+
+        /**
+         * Writes everything appended so far to disk. Must be called with mutex held.
+         */
+        void syncSegment();
+
+        /**
+         * Syncs when the interval started by the first unsynced message has passed
+         */
+        void syncScheduled();
+
+        /**
+         * Trims and closes the current segment, if any, and creates the next one
+         * @return false if the segment couldn't be created
+         */
+        bool openSegment();
+
+        /**
+         * Trims and closes the current segment, syncing first unless the policy is JS_NONE
+         */
+        void closeSegment();
+
+        Journal(const Journal &) = delete;
+
+        Journal &operator=(const Journal &) = delete;
+
+        std::string directory;
+        JournalSync syncPolicy;
+        std::chrono::steady_clock::duration syncInterval;
+        // Whether the interval sync is waiting on syncTimer
+        bool syncPending;
+        size_t segmentSize;
+        unsigned long long nextSegment;
+        unsigned int segmentCount;
+        int descriptor;
+        char *mapping;
+        // Where the next record goes, and how much of the segment has been synced
+        size_t offset;
+        size_t synced;
+        unsigned long long recorded;
+        unsigned long long dropped;
+#ifdef THREAD_SAFE
+        // The interval sync runs on whichever thread processes the transporter
+        std::mutex mutex;
+#endif
+        // Only for JS_INTERVAL
+        std::unique_ptr<SyncTimer> syncTimer;
+    };
+}
+
+#endif //BEAMMEUP_JOURNAL_H
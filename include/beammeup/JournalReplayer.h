@@ -0,0 +1,107 @@
+#if !defined(BEAMMEUP_JOURNALREPLAYER_H) && !defined(_WIN32)
+#define BEAMMEUP_JOURNALREPLAYER_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Journal.h"
+#include "Signaler.h"
+
+namespace BeamMeUp {
+    typedef enum {
+        // Notify messages as fast as replay is called
+        JP_FAST = 0,
+        // Keep the gaps between messages that they had when they were recorded
+        JP_ORIGINAL = 10
+    } JournalPace;
+
+    /**
+     * JournalReplayer reads back the messages a Journal recorded, oldest first, either one at a time with next or by
+     * notifying them on their signals with replay, to whatever is connected here. Segments are mapped read only, one
+     * at a time. Records that can't be decoded are skipped; a segment cut short by a crash ends at the last complete
+     * record.
+     */
+    class JournalReplayer : public Signaler {
+    public:
+        /**
+         * Finds the segments in the directory. Segments added later aren't read.
+         * @param transporter The transporter
+         * @param directory The journal's directory
+         */
+        JournalReplayer(Transporter *transporter, const std::string &directory);
+
+        /**
+         * Unmaps the current segment
+         */
+        ~JournalReplayer();
+
+        /**
+         * Reads the next message
+         * @param signal Set to its signal
+         * @param message Receives the message
+         * @param time Set to when it was recorded
+         * @return false if there are no more messages
+         */
+        bool next(Signal &signal, Variant &message, std::chrono::system_clock::time_point &time);
+
+        /**
+         * Notifies the next messages. At JP_ORIGINAL pace, the first message replayed is due straight away and each
+         * after it when as long has passed as had between it and the first when they were recorded; only messages
+         * that are due are notified. Event loops can wait for getNextDue between calls.
+         * @param pace How fast to replay
+         * @param maxMessages The maximum number of messages to notify. 0 means no limit.
+         * @return The number of messages notified
+         */
+        unsigned int replay(JournalPace pace = JP_FAST, unsigned int maxMessages = 0);
+
+        /**
+         * @return When the next message is due at JP_ORIGINAL pace, or time_point::max() if there are no more
+         */
+        std::chrono::steady_clock::time_point getNextDue();
+
+        /**
+         * @return true once every message has been read
+         */
+        bool isFinished();
+
+    private:
+        /**
+         * Moves on to the next record header, opening segments as needed
+         * @return false if there are no more records
+         */
+        bool findRecord();
+
+        /**
+         * Opens the next segment
+         * @return false if there are no more segments
+         */
+        bool openSegment();
+
+        /**
+         * Unmaps the current segment, if any
+         */
+        void closeSegment();
+
+        /**
+         * @return The header of the current record. Only valid after findRecord returned true.
+         */
+        const Journal::RecordHeader &getRecord() const;
+
+        JournalReplayer(const JournalReplayer &) = delete;
+
+        JournalReplayer &operator=(const JournalReplayer &) = delete;
+
+        std::vector<std::string> segments;
+        size_t nextSegment;
+        char *mapping;
+        size_t mappedSize;
+        size_t offset;
+        // For JP_ORIGINAL pace: when the first message replayed was recorded, and when it was replayed
+        bool started;
+        long long firstTime;
+        std::chrono::steady_clock::time_point firstReplayed;
+    };
+}
+
+#endif //BEAMMEUP_JOURNALREPLAYER_H
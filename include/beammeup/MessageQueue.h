@@ -0,0 +1,158 @@
+#ifndef BEAMMEUP_MESSAGEQUEUE_H
+#define BEAMMEUP_MESSAGEQUEUE_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Types.h"
+#include "Variant.h"
+
+namespace BeamMeUp {
+    /**
+     * MessageQueue is the FIFO behind a Receiver's mailbox. Messages are stored in nodes that are allocated in blocks
+     * and recycled through a free list, so once the queue has grown to its working size, pushing and popping don't
+     * touch the allocator (other than for the message payload itself). Memory is only returned when the queue is
+     * destroyed. MessageQueue does no locking of its own.
+     */
+    class MessageQueue {
+    public:
+        /**
+         * Initializes an empty queue. Nothing is allocated until the first push or reserve.
+         */
+        MessageQueue();
+
+        /**
+         * Adds a message to the back of the queue
+         * @param signal The signal
+         * @param message The message to copy
+         * @param request The id of the request the message belongs to, or 0 if it isn't a request
+         */
+        void push(Signal signal, const Variant &message, RequestId request = 0);
+
+        /**
+         * Adds a message to the back of the queue, swapping its payload in rather than copying it
+         * @param signal The signal
+         * @param message The message. Left holding whatever the node held before.
+         */
+        void push(Signal signal, Variant &&message);
+
+        /**
+         * Adds a message to the back of the queue without copying it, so one payload can be queued for many receivers
+         * @param signal The signal
+         * @param message The shared message
+         */
+        void push(Signal signal, const std::shared_ptr<const Variant> &message);
+
+        /**
+         * Removes the message at the front of the queue. The payload is swapped into message rather than copied.
+         * @param signal Set to the message's signal
+         * @param message Receives the message. Its previous contents are released when the node is next reused.
+         * @return true if there was a message to pop
+         */
+        bool pop(Signal &signal, Variant &message);
+
+        /**
+         * Removes the message at the front of the queue, along with its request id. Shared messages are copied.
+         * @param signal Set to the message's signal
+         * @param message Receives the message
+         * @param request Set to the message's request id, or 0 if it isn't a request
+         * @return true if there was a message to pop
+         */
+        bool pop(Signal &signal, Variant &message, RequestId &request);
+
+        /**
+         * Removes the message at the front of the queue without copying shared messages
+         * @param signal Set to the message's signal
+         * @param message Receives the message, unless it is shared
+         * @param request Set to the message's request id, or 0 if it isn't a request
+         * @param shared Receives the message if it is shared, otherwise reset
+         * @return true if there was a message to pop
+         */
+        bool pop(Signal &signal, Variant &message, RequestId &request, std::shared_ptr<const Variant> &shared);
+
+        /**
+         * Calls visit for every queued message, front to back, without removing them
+         * @param visit The function to call
+         */
+        void forEach(const std::function<void(Signal signal, const Variant &message)> &visit) const;
+
+        /**
+         * @return true if there are no messages queued
+         */
+        bool empty() const;
+
+        /**
+         * @return The number of messages queued
+         */
+        size_t size() const;
+
+        /**
+         * @return The number of message nodes allocated, queued or free
+         */
+        size_t capacity() const;
+
+        /**
+         * Allocates nodes up front so that this many messages can be queued at once without allocating
+         * @param messages The number of messages
+         */
+        void reserve(size_t messages);
+
+        /**
+         * Sets the NUMA node that blocks allocated from now on are placed on. Blocks already allocated stay where they
+         * are. Only has an effect if Affinity::canAllocateOnNode.
+         * @param node The node, or -1 for no preference
+         */
+        void setNode(int node);
+
+        /**
+         * @return The NUMA node new blocks are placed on, or -1 for no preference
+         */
+        int getNode() const;
+
+        /**
+         * Frees all nodes
+         */
+        ~MessageQueue();
+
+    private:
+        struct Node {
+            Signal signal;
+            Variant message;
+            // Set instead of message for shared messages
+            std::shared_ptr<const Variant> shared;
+            RequestId request;
+            Node *next;
+        };
+
+        struct Block {
+            Node *nodes;
+            size_t size;
+            int node;
+        };
+
+        /**
+         * Allocates a block of nodes and adds them to the free list
+         * @param nodes The number of nodes in the block
+         */
+        void grow(size_t nodes);
+
+        MessageQueue(const MessageQueue &) = delete;
+
+        MessageQueue &operator=(const MessageQueue &) = delete;
+
+        static const size_t MIN_BLOCK_SIZE;
+        static const size_t MAX_BLOCK_SIZE;
+
+        Node *head;
+        Node *tail;
+        Node *freeNodes;
+        size_t count;
+        size_t allocated;
+        int node;
+        std::vector<Block> blocks;
+    };
+}
+
+#endif //BEAMMEUP_MESSAGEQUEUE_H
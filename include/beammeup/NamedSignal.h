@@ -0,0 +1,145 @@
+#ifndef BEAMMEUP_NAMEDSIGNAL_H
+#define BEAMMEUP_NAMEDSIGNAL_H
+
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+
+#include "Types.h"
+
+namespace BeamMeUp {
+    /**
+     * Hashes a name to a signal with 32 bit FNV-1a. Usable in constant expressions, and the same hash topicSignal uses.
+     * @param name The name
+     * @param length The length of name
+     * @return The signal
+     */
+    constexpr Signal signalHash(const char *name, size_t length) {
+        Signal hash = 2166136261u;
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= static_cast<unsigned char>(name[i]);
+            hash *= 16777619u;
+        }
+
+        return hash;
+    }
+
+    /**
+     * Checks a set of signals for collisions at compile time: static_assert(signalsDistinct({A, B, C}), "...")
+     * @param signals The signals
+     * @return true if no two are equal
+     */
+    constexpr bool signalsDistinct(std::initializer_list<Signal> signals) {
+        for (const Signal *i = signals.begin(); i != signals.end(); ++i) {
+            for (const Signal *j = i + 1; j != signals.end(); ++j) {
+                if (*i == *j) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * A signal with a name. The signal is computed at compile time and NamedSignal converts to it implicitly, so
+     * named signals cost nothing over raw integers in connect and notify:
+     *
+     *     constexpr NamedSignal PRICE("md.price");
+     *     signaler.notify(PRICE, message);
+     */
+    class NamedSignal {
+    public:
+        /**
+         * @param name The name, which must outlive this object (a string literal, usually)
+         */
+        template<size_t N>
+        explicit constexpr NamedSignal(const char (&name)[N]) : name(name), signal(signalHash(name, N - 1)) {
+        }
+
+        constexpr operator Signal() const {
+            return signal;
+        }
+
+        /**
+         * @return The name
+         */
+        constexpr const char *getName() const {
+            return name;
+        }
+
+        /**
+         * @return The signal
+         */
+        constexpr Signal getSignal() const {
+            return signal;
+        }
+
+    private:
+        const char *name;
+        Signal signal;
+    };
+
+    /**
+     * Hashes a string literal to a signal at compile time: "md.price"_signal
+     */
+    constexpr Signal operator "" _signal(const char *name, size_t length) {
+        return signalHash(name, length);
+    }
+
+    /**
+     * SignalRegistry maps signals back to their names for diagnostics and traces, and catches two names hashing to
+     * the same signal. It is only used when registering and looking up names, never when notifying.
+     */
+    class SignalRegistry {
+    public:
+        /**
+         * Registers a name. Registering the same name again does nothing.
+         * @param name The name
+         * @return Its signal
+         * @throws std::runtime_error If a different name is registered with the same signal
+         */
+        static Signal add(const std::string &name);
+
+        /**
+         * Registers a named signal
+         * @param signal The named signal
+         * @return Its signal
+         * @throws std::runtime_error If a different name is registered with the same signal
+         */
+        static Signal add(const NamedSignal &signal);
+
+        /**
+         * @param signal The signal
+         * @return Its registered name, or an empty string
+         */
+        static std::string getName(Signal signal);
+
+        /**
+         * @param signal The signal
+         * @return Its registered name, or its number if it has none
+         */
+        static std::string describe(Signal signal);
+
+        /**
+         * @return The number of names registered
+         */
+        static size_t size();
+    };
+
+    /**
+     * Registers a named signal during static initialization, so collisions are found when the program starts:
+     *
+     *     static const SignalRegistration registerPrice(PRICE);
+     */
+    class SignalRegistration {
+    public:
+        /**
+         * @param signal The named signal to register
+         * @throws std::runtime_error If a different name is registered with the same signal
+         */
+        SignalRegistration(const NamedSignal &signal);
+    };
+}
+
+#endif //BEAMMEUP_NAMEDSIGNAL_H
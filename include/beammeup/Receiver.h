@@ -1,24 +1,87 @@
 #ifndef BEAMMEUP_RECEIVER_H
 #define BEAMMEUP_RECEIVER_H
 
+#include <chrono>
+#include <functional>
+#ifdef BEAMMEUP_COROUTINES
+#include <list>
+#include <unordered_map>
+#endif
 #include <map>
 #ifdef THREAD_SAFE
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <shared_mutex>
+#include <vector>
 #endif
-#include <queue>
 #include <string>
 #include <typeinfo>
 
+#include "Channel.h"
+#include "ConnectionTable.h"
+#include "Coroutine.h"
+#include "MessageQueue.h"
 #include "Types.h"
 #include "Variant.h"
+#include "VariantVector.h"
 
 namespace BeamMeUp {
     class Receiver {
+#ifdef BEAMMEUP_COROUTINES
+        friend class AwaiterTimer;
+        friend class MessageAwaiter;
+#endif
+#ifdef THREAD_SAFE
+        friend class Channel;
+#endif
+        friend class Checkpoint;
+        friend class Dispatcher;
         friend class Transporter;
         friend class Signaler;
 
     public:
-        int processMessages();
+        /**
+         * Processes queued messages, dispatching each to processMessage. A receiver is only processed by one thread
+         * at a time: if another thread is already processing it, or this is called from its own processMessage, this
+         * returns 0 straight away. processMessage implementations therefore need no locking of their own.
+         * @param maxMessages The maximum number of messages to process. 0 means no limit.
+         * @param deadline Stop processing once this time has passed (checked after each message)
+         * @return The number of messages processed
+         */
+        int processMessages(unsigned int maxMessages = 0,
+                            const std::chrono::steady_clock::time_point &deadline =
+                                std::chrono::steady_clock::time_point::max());
+
+        /**
+         * @return true if this receiver has messages waiting to be processed
+         */
+        bool hasMessages();
+
+        /**
+         * Pre-allocates mailbox space so that this many messages can be queued without allocating
+         * @param messages The number of messages
+         */
+        void reserveMessages(size_t messages);
+
+        /**
+         * @return The number of connections and pattern subscriptions to this receiver, from every signaler
+         */
+        size_t getIncomingCount() const;
+
+#ifdef BEAMMEUP_COROUTINES
+        /**
+         * Waits for a message from inside a Conversation: co_await receiver.next(signal). The next message this
+         * receiver processes on signal is handed to the coroutine instead of processMessage, and the coroutine is
+         * resumed from processMessages. If the receiver is destroyed first, the coroutine is destroyed without being
+         * resumed.
+         * @param signal The signal to wait for
+         * @param timeout How long to wait. duration::max() waits forever. Timeouts need a transporter.
+         * @return An awaiter that yields the message, or nothing if the wait timed out
+         */
+        MessageAwaiter next(Signal signal,
+                            std::chrono::steady_clock::duration timeout = std::chrono::steady_clock::duration::max());
+#endif
 
     protected:
         /**
@@ -34,6 +97,13 @@ namespace BeamMeUp {
          */
         void receiveMessage(Signal signal, const Variant &message);
 
+        /**
+         * Receive several messages on the same signal from another object
+         * @param signal The signal
+         * @param messages The messages to receive, in order
+         */
+        void receiveMessages(Signal signal, const VariantVector &messages);
+
         /**
          * Process a message received from another object. By default, this does nothing.
          * @param queue
@@ -42,15 +112,261 @@ namespace BeamMeUp {
         virtual void processMessage(const Signal signal, const Variant &message);
 
         /**
-         * Disconnects the receiver
+         * Only meaningful inside processMessage. Keep the id to reply later, from any thread.
+         * @return The id of the request being processed, or 0 if the current message isn't a request
+         */
+        RequestId getRequest() const;
+
+        /**
+         * Replies to the request being processed. Only meaningful inside processMessage.
+         * @param message The reply
+         * @return false if the current message isn't a request, or the request has already been answered, timed out
+         * or been cancelled
+         */
+        bool reply(const Variant &message);
+
+        /**
+         * Replies to a request. The reply goes straight to the requester; if several receivers reply to the same
+         * request, only the first reply is delivered.
+         * @param request The id from getRequest
+         * @param message The reply
+         * @return false if the request has already been answered, timed out or been cancelled
+         */
+        bool reply(RequestId request, const Variant &message);
+
+        /**
+         * Stops deliveries to this receiver: unregisters it, then in the thread safe build waits for any thread still
+         * delivering to or processing it to finish. A subclass whose processMessage uses its own members must call
+         * this first in its destructor, as they are gone by the time ~Receiver runs. Must not be called from the
+         * receiver's own processMessage. Calling it again does nothing.
+         */
+        void detach();
+
+        /**
+         * Detaches the receiver, if the subclass hasn't, then disconnects it from every signaler connected to it, in
+         * time proportional to its own number of connections. Must not be called from the receiver's own
+         * processMessage.
          */
         virtual ~Receiver();
 
     private:
+        /**
+         * Receive a request from another object
+         * @param signal The signal
+         * @param message The message to receive
+         * @param request The request's id
+         */
+        void receiveRequest(Signal signal, const Variant &message, RequestId request);
+
+#ifdef THREAD_SAFE
+        /**
+         * Receive a message shared with other receivers, without copying it
+         * @param signal The signal
+         * @param message The message
+         */
+        void receiveShared(Signal signal, const std::shared_ptr<const Variant> &message);
+#endif
+
+        /**
+         * Removes the next message from the mailbox or one of the channels, taking turns between them
+         * @param signal Set to the message's signal
+         * @param message Receives the message
+         * @param request Set to the message's request id, or 0 if it isn't a request
+         * @param shared Receives the message instead if it was queued by receiveShared, otherwise reset
+         * @param useChannels Whether the caller may consume from channels
+         * @return false if there was nothing to remove
+         */
+        bool popMessage(Signal &signal, Variant &message, RequestId &request, std::shared_ptr<const Variant> &shared,
+                        bool useChannels);
+
+        /**
+         * Claims this receiver for inline delivery through a C_DIRECT connection, unless it is already being
+         * processed (on any thread) or a coroutine is waiting for one. A successful claim must be ended with release.
+         * @return false if messages should be queued instead
+         */
+        bool claimDirect();
+
+        /**
+         * Calls processMessage inline for a C_DIRECT connection. Must be called with this receiver claimed by
+         * claimDirect.
+         * @param signal The signal
+         * @param message The message, which isn't copied
+         */
+        void processDirect(Signal signal, const Variant &message);
+
+        /**
+         * Calls visit for every message waiting to be processed, without removing them. Messages waiting in C_SPSC
+         * channels are moved into the mailbox first, so the order is only kept within each connection. Only called
+         * by Checkpoint while nothing is processing this receiver.
+         * @param visit The function to call
+         */
+        void forEachQueued(const std::function<void(Signal signal, const Variant &message)> &visit);
+
+        /**
+         * Queues messages restored by Checkpoint, locking once for all of them
+         * @param count The number of messages expected, to reserve room for
+         * @param next Called for each message in turn. Returns false when there are no more.
+         * @return The number of messages queued
+         */
+        size_t receiveRestored(size_t count, const std::function<bool(Signal &signal, Variant &message)> &next);
+
+        /**
+         * Marks this receiver as being processed by the calling thread
+         * @return false if it is already being processed
+         */
+        bool claim();
+
+        /**
+         * Ends a successful claim
+         */
+        void release();
+
+        /**
+         * Puts this receiver on its transporter's ready list, unless it is already there. Called after queueing
+         * messages.
+         */
+        void markReady();
+
+        /**
+         * Called after taking this receiver off the ready list and processing it. Clears the ready flag, then puts it
+         * straight back if messages are still waiting, so messages queued meanwhile can't be missed.
+         * @return true if the receiver is ready again and the caller should requeue it
+         */
+        bool rearm();
+
+        /**
+         * Processes queued messages. Must be called with this receiver claimed.
+         * @param maxMessages The maximum number of messages to process. 0 means no limit.
+         * @param deadline Stop processing once this time has passed (checked after each message)
+         * @return The number of messages processed
+         */
+        int processClaimed(unsigned int maxMessages, const std::chrono::steady_clock::time_point &deadline);
+
+        /**
+         * Records a connection or pattern subscription to this receiver
+         * @param link The connected signaler's link
+         * @param signal The signal. 0 for a subscription.
+         * @param subscription true for a pattern subscription
+         */
+        void addIncoming(const std::shared_ptr<SignalerLink> &link, Signal signal, bool subscription = false);
+
+        /**
+         * Forgets one connection or pattern subscription to this receiver
+         * @param link The connected signaler's link
+         * @param signal The signal. 0 for a subscription.
+         * @param subscription true for a pattern subscription
+         */
+        void removeIncoming(const SignalerLink *link, Signal signal, bool subscription = false);
+
+        /**
+         * @param link A signaler's link
+         * @return The signals that signaler has connected to this receiver, possibly with repeats. Subscriptions
+         * aren't included.
+         */
+        std::vector<Signal> getIncoming(const SignalerLink *link) const;
+
+#ifdef BEAMMEUP_COROUTINES
+        /**
+         * Starts handing messages on the awaiter's signal to it
+         * @param awaiter The awaiter
+         */
+        void addAwaiter(MessageAwaiter *awaiter);
+
+        /**
+         * Resumes the first coroutine waiting on signal, if any
+         * @param signal The message's signal
+         * @param message The message, which is moved to the coroutine
+         * @return true if a coroutine took the message
+         */
+        bool resumeAwaiter(Signal signal, Variant &message);
+
+        /**
+         * Resumes a coroutine whose wait has timed out, unless it has already been resumed. The awaiter is only
+         * dereferenced if it is still waiting.
+         * @param signal The signal the awaiter is waiting for
+         * @param awaiter The awaiter
+         * @param timer The id of the timer that expired
+         */
+        void expireAwaiter(Signal signal, MessageAwaiter *awaiter, TimerId timer);
+#endif
+
+#ifdef THREAD_SAFE
+        /**
+         * Adds a channel that this receiver will consume from
+         * @param channel The channel
+         */
+        void addChannel(const std::shared_ptr<Channel> &channel);
+
+        /**
+         * Picks up added channels and drops closed, drained ones. Must be called with channelConsumerMutex held.
+         */
+        void updateChannels();
+#endif
+
+        /**
+         * A connection from a signaler to this receiver
+         */
+        struct IncomingConnection {
+            std::shared_ptr<SignalerLink> link;
+            Signal signal;
+            // A pattern subscription, which may not have connected any signals yet
+            bool subscription;
+        };
+
+        // The request being processed on this thread, for getRequest and reply
+        static thread_local RequestId currentRequest;
+
         Transporter *transporter;
-        std::queue<std::pair<Signal, Variant>> messageQueue;
+        // Assigned by the transporter when this is registered
+        ReceiverHandle handle;
+        // Set by detach
+        bool detached;
+        MessageQueue messageQueue;
+        // Set while processMessage may be running, so only one thread processes us at a time
+#ifdef THREAD_SAFE
+        std::atomic_bool processing;
+#else
+        bool processing;
+#endif
+        // Set while this receiver is on its transporter's ready list (or a dispatcher's queue), so it is only there
+        // once
+#ifdef THREAD_SAFE
+        std::atomic_bool ready;
+#else
+        bool ready;
+#endif
+#ifdef THREAD_SAFE
+        // The dispatcher worker pinned to process us, or -1 for any
+        std::atomic<int> affinity;
+        // Nanoseconds spent processing under a dispatcher since its last rebalance
+        std::atomic<unsigned long long> processingTime;
+#endif
+        // Every connection to this receiver, so it can disconnect them all when it is destroyed
+        std::vector<IncomingConnection> incoming;
+#ifdef THREAD_SAFE
+        mutable std::mutex incomingMutex;
+#endif
+#ifdef BEAMMEUP_COROUTINES
+        // Coroutines waiting for a message by signal, oldest first. Guarded by mutex.
+        std::unordered_map<Signal, std::list<MessageAwaiter *>> awaiters;
+#ifdef THREAD_SAFE
+        std::atomic<size_t> awaiting;
+#else
+        size_t awaiting;
+#endif
+#endif
 #ifdef THREAD_SAFE
         std::shared_timed_mutex mutex;
+        // Channels being consumed. Only modified by the consuming thread with channelMutex held.
+        std::vector<std::shared_ptr<Channel>> channels;
+        // Channels waiting to be picked up by the consuming thread. Guarded by channelMutex.
+        std::vector<std::shared_ptr<Channel>> addedChannels;
+        std::atomic_bool channelsChanged;
+        std::mutex channelMutex;
+        // Held while consuming channels, which only one thread may do at a time
+        std::mutex channelConsumerMutex;
+        // Which source popMessage tries first. 0 is the mailbox, the rest are channels.
+        size_t nextSource;
 #endif
     };
 }
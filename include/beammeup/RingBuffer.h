@@ -0,0 +1,88 @@
+#if !defined(BEAMMEUP_RINGBUFFER_H) && defined(THREAD_SAFE)
+#define BEAMMEUP_RINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+
+#include "Types.h"
+#include "Variant.h"
+
+namespace BeamMeUp {
+    /**
+     * RingBuffer is a fixed capacity, lock-free queue of messages for exactly one producing thread and one consuming
+     * thread. The producer and consumer indices live on separate cache lines, and each side keeps a cached copy of
+     * the other side's index so that it only has to read the shared one when the ring looks full (or empty).
+     */
+    class RingBuffer {
+    public:
+        /**
+         * Initializes the ring
+         * @param capacity The number of messages the ring can hold. Rounded up to a power of 2.
+         */
+        RingBuffer(size_t capacity);
+
+        /**
+         * Adds a message. Must only be called from the producing thread.
+         * @param signal The signal
+         * @param message The message to copy
+         * @return false if the ring is full
+         */
+        bool push(Signal signal, const Variant &message);
+
+        /**
+         * Removes a message. Must only be called from the consuming thread. The payload is swapped into message.
+         * @param signal Set to the message's signal
+         * @param message Receives the message
+         * @return false if the ring is empty
+         */
+        bool pop(Signal &signal, Variant &message);
+
+        /**
+         * @return true if the ring is empty. Only exact when called from the consuming thread.
+         */
+        bool empty() const;
+
+        /**
+         * @return The number of messages in the ring. Only exact when called with both sides quiescent.
+         */
+        size_t size() const;
+
+        /**
+         * @return The number of messages the ring can hold
+         */
+        size_t capacity() const;
+
+        /**
+         * Frees the ring
+         */
+        ~RingBuffer();
+
+    private:
+        static const size_t CACHE_LINE_SIZE = 64;
+
+        struct Slot {
+            Signal signal;
+            Variant message;
+        };
+
+        RingBuffer(const RingBuffer &) = delete;
+
+        RingBuffer &operator=(const RingBuffer &) = delete;
+
+        Slot *slots;
+        size_t mask;
+        char padding0[CACHE_LINE_SIZE];
+        // Next slot to write. Written by the producer.
+        std::atomic<size_t> tail;
+        // Producer's last view of head
+        size_t cachedHead;
+        char padding1[CACHE_LINE_SIZE];
+        // Next slot to read. Written by the consumer.
+        std::atomic<size_t> head;
+        // Consumer's last view of tail
+        size_t cachedTail;
+        char padding2[CACHE_LINE_SIZE];
+    };
+}
+
+#endif //BEAMMEUP_RINGBUFFER_H
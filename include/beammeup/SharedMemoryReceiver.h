@@ -0,0 +1,65 @@
+#if !defined(BEAMMEUP_SHAREDMEMORYRECEIVER_H) && defined(THREAD_SAFE) && !defined(_WIN32)
+#define BEAMMEUP_SHAREDMEMORYRECEIVER_H
+
+#include <string>
+
+#include "Receiver.h"
+#include "SharedMemoryRing.h"
+
+namespace BeamMeUp {
+    /**
+     * SharedMemoryReceiver stands in for a receiver in another process. Connect signals to it as to any receiver, and
+     * the messages it processes are written to a SharedMemoryRing, for a SharedMemorySignaler in the other process to
+     * deliver. With a C_DIRECT connection, notifying writes straight to the ring; with other connections messages are
+     * queued here first and written when the transporter processes them.
+     *
+     * Requests are passed on as plain messages, as replies can't be returned, so the requester sees them time out.
+     * Messages are dropped if the ring is full.
+     */
+    class SharedMemoryReceiver : public Receiver {
+    public:
+        /**
+         * Attaches to the ring as its producer. Throws std::runtime_error if that isn't possible; see SharedMemoryRing.
+         * @param transporter The transporter to register with
+         * @param name The ring's name
+         * @param capacity The ring's capacity, if this creates it
+         */
+        SharedMemoryReceiver(Transporter *transporter, const std::string &name,
+                             size_t capacity = SharedMemoryRing::DEFAULT_CAPACITY);
+
+        /**
+         * Stops deliveries before the ring is unmapped
+         */
+        ~SharedMemoryReceiver();
+
+        /**
+         * @param timeout If not zero, the consumer must also have read within this time
+         * @return true if a consumer is attached and still running
+         */
+        bool isPeerAlive(std::chrono::steady_clock::duration timeout = std::chrono::steady_clock::duration::zero())
+                const;
+
+        /**
+         * @return The number of messages dropped because the ring was full
+         */
+        unsigned long long getDropped() const;
+
+        /**
+         * @return The ring messages are written to
+         */
+        SharedMemoryRing &getRing();
+
+    protected:
+        /**
+         * Writes the message to the ring
+         * @param signal The signal
+         * @param message The message
+         */
+        void processMessage(const Signal signal, const Variant &message) override;
+
+    private:
+        SharedMemoryRing ring;
+    };
+}
+
+#endif //BEAMMEUP_SHAREDMEMORYRECEIVER_H
@@ -0,0 +1,122 @@
+#if !defined(BEAMMEUP_SHAREDMEMORYRING_H) && defined(THREAD_SAFE) && !defined(_WIN32)
+#define BEAMMEUP_SHAREDMEMORYRING_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "Types.h"
+
+namespace BeamMeUp {
+    typedef enum {
+        SM_PRODUCER = 0,
+        SM_CONSUMER = 10
+    } SharedMemoryRole;
+
+    /**
+     * SharedMemoryRing is a single producer, single consumer queue of messages in a POSIX shared memory segment, for
+     * passing messages between processes on the same host. Messages are encoded with VariantCodec straight into the
+     * segment and decoded straight out of it, so each costs one encode and one decode and no system calls.
+     *
+     * Either side can create the segment; the other opens it. Each side records its process id when it attaches, so
+     * the other can tell if it has died, and a side that has died can be replaced by a new process attaching in its
+     * role. A producer that dies mid-write leaves nothing visible. A consumer that dies after processing a message but
+     * before it was read to completion may see it again when replaced.
+     */
+    class SharedMemoryRing {
+    public:
+        static const size_t DEFAULT_CAPACITY;
+
+        /**
+         * Attaches to the segment, creating it if necessary. Throws std::runtime_error if the segment can't be created
+         * or mapped, or if a live process is already attached in the same role.
+         * @param name The segment's name, which must start with '/' (e.g. "/md-feed")
+         * @param role Which end of the ring this process is
+         * @param capacity The number of bytes of message data the ring holds, rounded up to a power of two. Only used
+         * when creating the segment.
+         */
+        SharedMemoryRing(const std::string &name, SharedMemoryRole role, size_t capacity = DEFAULT_CAPACITY);
+
+        /**
+         * Detaches from the segment. The segment itself stays until unlink is called.
+         */
+        ~SharedMemoryRing();
+
+        /**
+         * Removes a segment's name, so new processes create a fresh one. Processes still attached keep using theirs.
+         * @param name The segment's name
+         * @return false if there was no such segment
+         */
+        static bool unlink(const std::string &name);
+
+        /**
+         * Adds a message. Producer only.
+         * @param signal The signal
+         * @param message The message
+         * @return false if the ring is full, or the message is larger than half of it, in which case it is dropped
+         */
+        bool write(Signal signal, const Variant &message);
+
+        /**
+         * Takes the oldest message. Consumer only. Messages that can't be decoded are skipped.
+         * @param signal Set to the message's signal
+         * @param message Receives the message
+         * @return false if the ring is empty
+         */
+        bool read(Signal &signal, Variant &message);
+
+        /**
+         * @return true if there are no messages waiting
+         */
+        bool empty() const;
+
+        /**
+         * @return The number of bytes of message data the ring holds
+         */
+        size_t getCapacity() const;
+
+        /**
+         * @return The number of messages write has dropped, over the segment's lifetime
+         */
+        unsigned long long getDropped() const;
+
+        /**
+         * Checks on the process at the other end
+         * @param timeout If not zero, the peer must also have used the ring or called heartbeat within this time
+         * @return true if a process is attached in the other role and is still running
+         */
+        bool isPeerAlive(std::chrono::steady_clock::duration timeout = std::chrono::steady_clock::duration::zero())
+                const;
+
+        /**
+         * Tells the peer we're still alive, for isPeerAlive with a timeout. Reads and writes do this too.
+         */
+        void heartbeat();
+
+    private:
+        struct Side;
+        struct Header;
+
+        // Where the message data starts, after the header
+        static const size_t DATA_OFFSET;
+
+        /**
+         * @param role A role
+         * @return The shared state of the side in that role
+         */
+        Side &getSide(SharedMemoryRole role) const;
+
+        SharedMemoryRing(const SharedMemoryRing &) = delete;
+
+        SharedMemoryRing &operator=(const SharedMemoryRing &) = delete;
+
+        SharedMemoryRole role;
+        Header *header;
+        char *data;
+        size_t mask;
+        size_t mappedSize;
+        int pid;
+    };
+}
+
+#endif //BEAMMEUP_SHAREDMEMORYRING_H
@@ -0,0 +1,50 @@
+#if !defined(BEAMMEUP_SHAREDMEMORYSIGNALER_H) && defined(THREAD_SAFE) && !defined(_WIN32)
+#define BEAMMEUP_SHAREDMEMORYSIGNALER_H
+
+#include <string>
+
+#include "SharedMemoryRing.h"
+#include "Signaler.h"
+
+namespace BeamMeUp {
+    /**
+     * SharedMemorySignaler delivers the messages a SharedMemoryReceiver in another process writes to a
+     * SharedMemoryRing. Each message read is notified on its signal to whatever is connected here, so receivers in
+     * this process can't tell it didn't come from a local signaler. Only one thread may call processMessages at a time.
+     */
+    class SharedMemorySignaler : public Signaler {
+    public:
+        /**
+         * Attaches to the ring as its consumer. Throws std::runtime_error if that isn't possible; see SharedMemoryRing.
+         * @param transporter The transporter
+         * @param name The ring's name
+         * @param capacity The ring's capacity, if this creates it
+         */
+        SharedMemorySignaler(Transporter *transporter, const std::string &name,
+                             size_t capacity = SharedMemoryRing::DEFAULT_CAPACITY);
+
+        /**
+         * Reads messages from the ring and notifies them
+         * @param maxMessages The maximum number of messages to read. 0 means until the ring is empty.
+         * @return The number of messages notified
+         */
+        unsigned int processMessages(unsigned int maxMessages = 0);
+
+        /**
+         * @param timeout If not zero, the producer must also have written within this time
+         * @return true if a producer is attached and still running
+         */
+        bool isPeerAlive(std::chrono::steady_clock::duration timeout = std::chrono::steady_clock::duration::zero())
+                const;
+
+        /**
+         * @return The ring messages are read from
+         */
+        SharedMemoryRing &getRing();
+
+    private:
+        SharedMemoryRing ring;
+    };
+}
+
+#endif //BEAMMEUP_SHAREDMEMORYSIGNALER_H
@@ -1,18 +1,39 @@
 #ifndef BEAMMEUP_SIGNALER_H
 #define BEAMMEUP_SIGNALER_H
 
+#include <chrono>
+#include <functional>
+#ifdef THREAD_SAFE
+#include <future>
+#endif
 #include <map>
+#include <memory>
 #include <queue>
-#include <shared_mutex>
+#ifdef THREAD_SAFE
+#include <atomic>
+#include <mutex>
+#endif
 #include <string>
 #include <typeinfo>
+#include <vector>
 
+#include "ConnectionOptions.h"
+#include "ConnectionTable.h"
+#include "FanOutPool.h"
 #include "Receiver.h"
+#include "Topic.h"
 #include "Types.h"
 #include "Variant.h"
+#include "VariantVector.h"
 
 namespace BeamMeUp {
+    /**
+     * Called with the outcome of a request. The reply is empty unless the status is RS_OK.
+     */
+    typedef std::function<void(ReplyStatus status, const Variant &reply)> ReplyCallback;
+
     class Signaler {
+        friend class Checkpoint;
         friend class Receiver;
         friend class Transporter;
 
@@ -23,12 +44,42 @@ namespace BeamMeUp {
          */
         Signaler(Transporter *transporter);
 
+        /**
+         * Cancels any timers and requests this signaler has outstanding, and disconnects from every receiver
+         */
+        ~Signaler();
+
         /**
          * Connects to receiver's queue. Receiver will be sent data we emit
          * @param signal The Signal to connect
          * @param receiver The receiving object
+         * @param options How messages are delivered
+         */
+        void connect(Signal signal, Receiver *receiver, const ConnectionOptions &options = ConnectionOptions());
+
+        /**
+         * Connects receiver to every topic matching pattern. Topics are '.' separated levels, e.g. "md.venueX.bid". In
+         * a pattern, a "*" level matches exactly one level and a trailing "#" level matches any number of levels,
+         * including none. Matching is done here and in advertise, never when notifying: each matching topic gets an
+         * ordinary connection on its topicSignal. A topic matched by several of a receiver's patterns is connected
+         * once, with the options of the first. A pattern without wildcards connects to topicSignal(pattern) and
+         * needn't be advertised.
+         * @param pattern The topic pattern
+         * @param receiver The receiving object
+         * @param options How messages are delivered
+         * @throws std::runtime_error If "#" isn't the last level
+         */
+        void connect(const std::string &pattern, Receiver *receiver,
+                     const ConnectionOptions &options = ConnectionOptions());
+
+        /**
+         * Declares a topic this signaler notifies on, connecting it to the receivers of any matching patterns.
+         * Advertising a topic twice does nothing. The topic is added to the SignalRegistry.
+         * @param topic The topic, which mustn't contain wildcards
+         * @return The signal to notify on, the same as topicSignal(topic)
+         * @throws std::runtime_error If the topic contains wildcards, or collides with another registered name
          */
-        void connect(Signal signal, Receiver *receiver);
+        Signal advertise(const std::string &topic);
 
         /**
          * Disconnects from any objects identified by signal
@@ -37,8 +88,8 @@ namespace BeamMeUp {
         void disconnect(Signal signal);
 
         /**
-         * Disconnects from the object receiver
-         * @param receiver The receiver to disconnect from
+         * Disconnects from the object receiver. Only the signals the receiver is connected to are visited.
+         * @param receiver The receiver to disconnect from, which must not have been destroyed
          */
         void disconnect(const Receiver *receiver);
 
@@ -49,6 +100,14 @@ namespace BeamMeUp {
          */
         void disconnect(Signal id, const Receiver *receiver);
 
+        /**
+         * Drops receiver's subscriptions to pattern, and its connections to every topic the pattern matches that
+         * none of its other patterns match
+         * @param pattern The topic pattern
+         * @param receiver The receiver to disconnect from
+         */
+        void disconnect(const std::string &pattern, const Receiver *receiver);
+
         /**
          * Disconnects from all signals on all objects
          */
@@ -59,6 +118,11 @@ namespace BeamMeUp {
          */
         std::multimap<Signal, Receiver *> getConnectedObjects();
 
+        /**
+         * @return The number of pattern subscriptions made through this signaler
+         */
+        size_t getSubscriptionCount();
+
         /**
          * Queue some data for other object(s) to pickup
          * @param signal The signal to post
@@ -67,11 +131,212 @@ namespace BeamMeUp {
          */
         void notify(Signal signal, const Variant &message);
 
+        /**
+         * Queues several messages on the same signal. This is equivalent to calling notify for each message in turn,
+         * but the subscribers are looked up once and each lock is taken once for the whole batch.
+         * @param signal The signal to post
+         * @param messages The messages to send, in order
+         */
+        void notifyBatch(Signal signal, const VariantVector &messages);
+
+#ifdef THREAD_SAFE
+        /**
+         * Queues a message for the objects connected to signal using a pool's workers, for signals with very many
+         * receivers. The message is copied once and shared by every receiver's queue. This returns once the work has
+         * been handed off; wait on the future to know every receiver has the message. Receivers are split between the
+         * workers by their handles, so successive broadcasts reach each receiver in order, but a notify made before a
+         * broadcast completes may overtake it. Messages always go through the mailbox. Don't destroy the transporter
+         * before the future is ready.
+         * @param signal The signal to post
+         * @param message The message to send
+         * @param pool The workers to queue the message with
+         * @return A future that is ready once the message is queued for every receiver
+         */
+        std::future<void> broadcast(Signal signal, const Variant &message, FanOutPool &pool);
+#endif
+
+        /**
+         * Queues some data for other object(s) once a delay has passed. The message is sent from
+         * Transporter::processMessages, to whoever is connected at the time.
+         * @param signal The signal to post
+         * @param message The message to send
+         * @param delay How long to wait
+         * @return An id that can be passed to cancelTimer, or 0 if there is no transporter
+         */
+        TimerId notifyAfter(Signal signal, const Variant &message, std::chrono::steady_clock::duration delay);
+
+        /**
+         * Queues some data for other object(s) at a given time. The message is sent from
+         * Transporter::processMessages, to whoever is connected at the time.
+         * @param signal The signal to post
+         * @param message The message to send
+         * @param time When to send it
+         * @return An id that can be passed to cancelTimer, or 0 if there is no transporter
+         */
+        TimerId notifyAt(Signal signal, const Variant &message, std::chrono::steady_clock::time_point time);
+
+        /**
+         * Queues some data for other object(s) repeatedly, starting one interval from now, until cancelled. If
+         * processing falls behind, missed repetitions are skipped rather than sent in a burst.
+         * @param signal The signal to post
+         * @param message The message to send
+         * @param interval The time between messages
+         * @return An id that can be passed to cancelTimer, or 0 if there is no transporter
+         */
+        TimerId notifyEvery(Signal signal, const Variant &message, std::chrono::steady_clock::duration interval);
+
+        /**
+         * Cancels a timer started by notifyAfter, notifyAt or notifyEvery
+         * @param id The timer's id
+         * @return true if the timer was still scheduled
+         */
+        bool cancelTimer(TimerId id);
+
+        /**
+         * Sends a request to the objects connected to signal. Receivers answer with Receiver::reply, which goes
+         * straight back to this signaler. The first reply wins. The callback is called exactly once, from
+         * Transporter::processMessages, with the reply or with the reason there wasn't one. It isn't called if this
+         * signaler is destroyed first.
+         * @param signal The signal to post
+         * @param message The request
+         * @param callback Receives the outcome
+         * @param timeout How long to wait for a reply. Zero waits forever.
+         * @return An id that can be passed to cancelRequest, or 0 if there is no transporter
+         */
+        RequestId request(Signal signal, const Variant &message, const ReplyCallback &callback,
+                          std::chrono::steady_clock::duration timeout = std::chrono::steady_clock::duration::zero());
+
+#ifdef THREAD_SAFE
+        /**
+         * Sends a request to the objects connected to signal, returning a future for the reply. The future is
+         * fulfilled directly by the replying thread, so it can be waited on without processing messages. If there is
+         * no reply it fails with a std::runtime_error saying why.
+         * @param signal The signal to post
+         * @param message The request
+         * @param timeout How long to wait for a reply. Zero waits forever.
+         * @return The future reply
+         */
+        std::future<Variant> request(Signal signal, const Variant &message,
+                                     std::chrono::steady_clock::duration timeout =
+                                         std::chrono::steady_clock::duration::zero());
+#endif
+
+        /**
+         * Cancels a request. Its callback is called with RS_CANCELLED.
+         * @param id The request's id
+         * @return false if the request has already completed
+         */
+        bool cancelRequest(RequestId id);
+
     private:
+        /**
+         * Creates a connection to receiver, adding a channel to it if the options ask for one
+         * @param receiver The receiving object
+         * @param options How messages are delivered
+         * @return The connection
+         */
+        Connection makeConnection(Receiver *receiver, const ConnectionOptions &options);
+
+        /**
+         * Adds a connection to the table and to its receiver's index. Must be called with mutex held.
+         * @param signal The signal
+         * @param connection The connection
+         */
+        void addConnection(Signal signal, Connection connection);
+
+        /**
+         * @param connection A C_DIRECT connection
+         * @return true if the calling thread may deliver through it inline
+         */
+        static bool isDirectThread(const Connection &connection);
+
+        /**
+         * A receiver claimed for inline delivery through a C_DIRECT connection
+         */
+        struct DirectDelivery {
+            Receiver *receiver;
+            // Run on each message before delivering it, if set
+            std::shared_ptr<ConnectionFilter> filter;
+        };
+
+        /**
+         * Delivers messages inline to receivers claimed by claimDirect, then releases them. Called outside of any
+         * Epoch::Guard, as the handlers may destroy other receivers.
+         * @param direct The claimed receivers
+         * @param signal The signal
+         * @param messages The messages
+         * @param count The number of messages
+         */
+        static void deliverDirect(const std::vector<DirectDelivery> &direct, Signal signal, const Variant *messages,
+                                  size_t count);
+
+        /**
+         * Queues a request for the receivers connected to signal
+         * @param signal The signal to post
+         * @param message The request
+         * @param id The request's id
+         * @return false if there were no receivers
+         */
+        bool sendRequest(Signal signal, const Variant &message, RequestId id);
+
+        /**
+         * Removes connections from their receivers' indexes, as addConnection adds them. Must be called with mutex
+         * held: a receiver being destroyed disconnects from us under it, so it can't be freed while we do this.
+         * @param removed The connections that were removed
+         */
+        void forgetConnections(const std::vector<Connection> &removed);
+
+        /**
+         * Removes pattern subscriptions, and removes them from their receivers' indexes, as connect adds them. Must be
+         * called with mutex held, and only for subscriptions whose receivers still exist.
+         * @param matcher Returns true for subscriptions to remove
+         */
+        void unsubscribe(const TopicTrie::SubscriptionMatcher &matcher);
+
+        /**
+         * Removes pattern subscriptions made with exactly this pattern, as unsubscribe does
+         * @param pattern The topic pattern
+         * @param matcher Returns true for subscriptions to remove
+         */
+        void unsubscribe(const std::string &pattern, const TopicTrie::SubscriptionMatcher &matcher);
+
+        /**
+         * Removes every pattern subscription of a receiver being destroyed, which has already cleared its index
+         * @param receiver The receiver
+         */
+        void removeSubscriber(const Receiver *receiver);
+
+#ifdef THREAD_SAFE
+        /**
+         * Closes a removed connection's channel, if it has one, and tells its receiver to drop it. Receivers that
+         * aren't registered with our transporter can't be checked for liveness, so they are left to drop it when
+         * they are destroyed.
+         * @param connection The connection being removed
+         */
+        void closeConnection(const Connection &connection);
+#endif
+
+        /**
+         * Tells the receivers of removed connections they will get no more messages through them
+         * @param removed The connections that were removed
+         */
+        void closeConnections(const std::vector<Connection> &removed);
+
         Transporter *transporter;
-        std::multimap<Signal, Receiver *> connectedObjects;
+        // Read without locks under an Epoch::Guard
+        ConnectionTable connections;
+        // Advertised topics and pattern subscriptions, only used to work out connections
+        TopicTrie topics;
+        // Shared with the receivers we connect to
+        std::shared_ptr<SignalerLink> link;
 #ifdef THREAD_SAFE
-        std::shared_timed_mutex mutex;
+        // Serializes changes to connections and topics
+        std::mutex mutex;
+        std::atomic_bool hasTimers;
+        std::atomic_bool hasRequests;
+#else
+        bool hasTimers;
+        bool hasRequests;
 #endif
     };
 }
@@ -0,0 +1,226 @@
+#if !defined(BEAMMEUP_SOCKETBRIDGE_H) && defined(THREAD_SAFE) && !defined(_WIN32)
+#define BEAMMEUP_SOCKETBRIDGE_H
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Receiver.h"
+#include "Signaler.h"
+
+namespace BeamMeUp {
+    /**
+     * SocketBridge forwards messages to and from another process over a connected Unix domain stream socket. Connect
+     * signals to the bridge as to any receiver, and the peer's bridge notifies them to whatever is connected there; the
+     * peer's messages are notified by this bridge in turn. Messages are encoded with VariantCodec.
+     *
+     * Small messages are combined into batches and the batches written together with one writev, so a burst of
+     * messages costs a few system calls rather than one each. Reads go through readv into the inbound buffer and a
+     * stack buffer, so one call picks up whatever has arrived.
+     *
+     * Flow control is credit based: each side grants the other a window of bytes, and only sends while it has credit.
+     * Credit is granted back as received messages are notified, so a slow peer holds up the sender rather than
+     * having its own buffers grow. The sender buffers up to a limit, then send fails and messages are dropped. The
+     * windows may differ: each side's first grant is its whole window, and the other sizes its batches and largest
+     * message by it.
+     *
+     * Nothing happens in the background: the owner polls getDescriptor (waitForSocket does this) and calls
+     * processSocket when it is readable, or writable while wantsWrite, or while hasBuffered. Messages are only written once a batch fills,
+     * or by flush and processSocket, so call flush after processing messages for the bridge. Requests are passed on as
+     * plain messages, as replies can't be returned, so the requester sees them time out.
+     */
+    class SocketBridge : public Signaler, public Receiver {
+    public:
+        static const size_t DEFAULT_WINDOW;
+        static const size_t DEFAULT_LIMIT;
+
+        /**
+         * Takes ownership of a connected socket, which is made non-blocking, and grants the peer its window
+         * @param transporter The transporter to register with
+         * @param descriptor The socket
+         * @param window The number of bytes of messages the peer may have in flight to us. The peer rejects messages
+         * larger than half of it.
+         * @param limit The number of bytes of messages to buffer while waiting for credit
+         */
+        SocketBridge(Transporter *transporter, int descriptor, size_t window = DEFAULT_WINDOW,
+                     size_t limit = DEFAULT_LIMIT);
+
+        /**
+         * Stops deliveries and closes the socket. Messages not yet written are lost.
+         */
+        ~SocketBridge();
+
+        /**
+         * Creates a socket listening on a path, replacing any stale socket file there. Throws std::runtime_error on
+         * failure.
+         * @param path The path
+         * @return The listening socket
+         */
+        static int openListener(const std::string &path);
+
+        /**
+         * Waits for a connection. Throws std::runtime_error on failure.
+         * @param listener A socket from openListener
+         * @return The connected socket
+         */
+        static int acceptConnection(int listener);
+
+        /**
+         * Connects to a listening socket. Throws std::runtime_error on failure.
+         * @param path The path the peer is listening on
+         * @return The connected socket
+         */
+        static int openConnection(const std::string &path);
+
+        /**
+         * Queues a message for the peer, writing the queued messages if they have filled a batch
+         * @param signal The signal the peer notifies it on
+         * @param message The message
+         * @return false if the message was dropped, because it is larger than half the peer's window, the buffer is
+         * full or the socket closed. Messages sent before the peer's window is known are dropped later if too large.
+         */
+        bool send(Signal signal, const Variant &message);
+
+        /**
+         * Writes as many queued messages as credit and the socket allow
+         * @return true if nothing is left to write
+         */
+        bool flush();
+
+        /**
+         * Reads what has arrived, notifies the messages in it, grants credit for them, then flushes
+         * @param maxMessages The maximum number of messages to notify. 0 means no limit. Any left over are notified
+         * by the next call; they have already been read, so the socket may not poll readable again until then.
+         * @return The number of messages notified
+         */
+        unsigned int processSocket(unsigned int maxMessages = 0);
+
+        /**
+         * Waits until processSocket has something to do: a whole message is already buffered, or the socket is
+         * readable, or writable while wantsWrite
+         * @param timeout The maximum time to wait
+         * @return false if the timeout expired
+         */
+        bool waitForSocket(std::chrono::milliseconds timeout);
+
+        /**
+         * Call from the thread that calls processSocket
+         * @return true if a whole message that has been read but not yet notified is buffered, so processSocket
+         * should be called without waiting for the socket
+         */
+        bool hasBuffered() const;
+
+        /**
+         * @return The socket, for adding to a poll loop
+         */
+        int getDescriptor() const;
+
+        /**
+         * @return true if there is something that could be written now, so the loop should wait for the socket to
+         * become writable
+         */
+        bool wantsWrite();
+
+        /**
+         * @return false once the peer has closed the connection or it has failed
+         */
+        bool isOpen() const;
+
+        /**
+         * @return The number of bytes we may still send before the peer grants more
+         */
+        size_t getCredit();
+
+        /**
+         * @return The number of bytes of messages buffered, waiting for credit or to be written
+         */
+        size_t getBuffered();
+
+        /**
+         * @return The number of messages send has dropped
+         */
+        unsigned long long getDropped() const;
+
+    protected:
+        /**
+         * Sends the message to the peer
+         * @param signal The signal
+         * @param message The message
+         */
+        void processMessage(const Signal signal, const Variant &message) override;
+
+    private:
+        /**
+         * Finds the batch to append a message to, starting a new one if the last is full. Must be called with mutex
+         * held.
+         * @param size The size of the message's frame
+         * @return The batch
+         */
+        std::string &batchFor(size_t size);
+
+        /**
+         * Sizes batches by the window the peer announced, and rebatches those waiting to fit it, dropping messages
+         * too large for it. Must be called with mutex held.
+         * @param window The peer's window
+         */
+        void resize(size_t window);
+
+        /**
+         * Moves waiting batches the peer has granted credit for to the ready queue. Must be called with mutex held.
+         */
+        void admit();
+
+        /**
+         * Writes from the ready queue until it is empty or the socket is full. Must be called with mutex held.
+         * @return false if the connection failed
+         */
+        bool write();
+
+        /**
+         * Queues a grant of credit to the peer. Must be called with mutex held.
+         * @param bytes The number of bytes granted
+         * @param initial true for the first grant, which tells the peer our window
+         */
+        void grant(size_t bytes, bool initial = false);
+
+        /**
+         * Marks the connection closed
+         */
+        void fail();
+
+        SocketBridge(const SocketBridge &) = delete;
+
+        SocketBridge &operator=(const SocketBridge &) = delete;
+
+        int descriptor;
+        size_t window;
+        size_t limit;
+        size_t batchSize;
+        // 0 until the peer's first grant arrives
+        size_t peerWindow;
+        std::atomic_bool open;
+        std::atomic<unsigned long long> dropped;
+
+        // Outgoing. Messages are encoded into batches in waiting, which move to ready once the peer has granted
+        // credit for them; grants go straight into ready, so they are never held up by a lack of credit.
+        std::mutex mutex;
+        std::deque<std::string> waiting;
+        std::deque<std::string> ready;
+        // How much of ready.front() has been written
+        size_t readyOffset;
+        size_t credit;
+        size_t buffered;
+
+        // Incoming, only touched by processSocket. Data between inboundHead and inboundTail hasn't been notified yet.
+        std::vector<char> inbound;
+        size_t inboundHead;
+        size_t inboundTail;
+        // Bytes of messages notified since credit was last granted
+        size_t consumed;
+    };
+}
+
+#endif //BEAMMEUP_SOCKETBRIDGE_H
@@ -0,0 +1,168 @@
+#ifndef BEAMMEUP_TIMERWHEEL_H
+#define BEAMMEUP_TIMERWHEEL_H
+
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "Types.h"
+
+namespace BeamMeUp {
+    /**
+     * TimerWheel is a hierarchical timing wheel. Time is divided into ticks; each level has 256 slots and covers 256
+     * times the span of the level below, so four levels cover 2^32 ticks. Adding and cancelling a timer are O(1);
+     * timers in the upper levels are moved down a level ("cascaded") as their slot comes round. Timers further out
+     * than the top level are parked in it and re-filed until they fit. TimerWheel does no locking of its own.
+     */
+    class TimerWheel {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        /**
+         * Timer is the base class for anything scheduled on the wheel. The wheel owns timers once they are added.
+         */
+        class Timer {
+            friend class TimerWheel;
+
+        public:
+            Timer();
+
+            /**
+             * Called by whoever advances the wheel when the timer is due
+             */
+            virtual void expire() = 0;
+
+            /**
+             * @return The id assigned when the timer was added
+             */
+            TimerId getId() const;
+
+            /**
+             * @return true if the timer was cancelled while expiring, so it must not be expired again
+             */
+            bool isCancelled() const;
+
+            virtual ~Timer();
+
+        private:
+            TimerId id;
+            unsigned long long tick;
+            unsigned long long interval;
+            bool firing;
+            bool cancelled;
+            int level;
+            size_t slot;
+            Timer *previous;
+            Timer *next;
+        };
+
+        /**
+         * Initializes an empty wheel
+         * @param resolution The length of a tick. Timers never fire early, but may fire up to a tick late.
+         * @param origin The time of tick 0
+         */
+        TimerWheel(Clock::duration resolution = std::chrono::milliseconds(1), Clock::time_point origin = Clock::now());
+
+        /**
+         * Schedules a timer
+         * @param timer The timer. The wheel takes ownership.
+         * @param due When the timer should first expire
+         * @param interval Zero for a one-shot timer, otherwise the time between expiries
+         * @return The timer's id, which is never 0
+         */
+        TimerId add(Timer *timer, Clock::time_point due, Clock::duration interval = Clock::duration::zero());
+
+        /**
+         * Cancels a timer. If it is currently expiring it will be deleted by finish instead of being rescheduled.
+         * @param id The id returned by add
+         * @return true if the timer was found
+         */
+        bool cancel(TimerId id);
+
+        /**
+         * Cancels every timer that matches a predicate
+         * @param matches The predicate
+         */
+        void cancel(const std::function<bool(Timer *)> &matches);
+
+        /**
+         * Moves the wheel forward to now and collects the timers that are due. Each of them must be passed to
+         * finish once expired.
+         * @param now The current time
+         * @param expired Receives the due timers, in expiry order
+         */
+        void advance(Clock::time_point now, std::vector<Timer *> &expired);
+
+        /**
+         * Completes the expiry of a timer returned by advance, either rescheduling it (if periodic) or deleting it
+         * @param timer The timer
+         */
+        void finish(Timer *timer);
+
+        /**
+         * @return The earliest time at which advance might return a timer, or time_point::max() if there are no
+         * timers. May be earlier than the actual next expiry, but never later.
+         */
+        Clock::time_point nextExpiry() const;
+
+        /**
+         * @return The number of scheduled timers, including ones currently expiring
+         */
+        size_t size() const;
+
+        /**
+         * Deletes all timers
+         */
+        ~TimerWheel();
+
+    private:
+        static const int LEVELS = 4;
+        static const int LEVEL_BITS = 8;
+        static const size_t SLOTS = 1 << LEVEL_BITS;
+        static const size_t SLOT_MASK = SLOTS - 1;
+
+        /**
+         * Files a timer into the slot for its tick
+         * @param timer The timer
+         */
+        void insert(Timer *timer);
+
+        /**
+         * Takes a timer out of its slot
+         * @param timer The timer
+         */
+        void unlink(Timer *timer);
+
+        /**
+         * Moves forward a single tick
+         * @param expired Receives the due timers
+         */
+        void step(std::vector<Timer *> &expired);
+
+        /**
+         * Moves every timer in a slot to expired
+         * @param level The level (LEVELS for the overdue list)
+         * @param slot The slot
+         * @param expired Receives the timers
+         */
+        void expireSlot(int level, size_t slot, std::vector<Timer *> &expired);
+
+        /**
+         * @param tick A tick
+         * @return The time at which tick starts
+         */
+        Clock::time_point timeOf(unsigned long long tick) const;
+
+        Clock::duration resolution;
+        Clock::time_point origin;
+        unsigned long long current;
+        TimerId nextId;
+        // Slots for each level, plus a final level holding timers that were already due when added
+        Timer *slots[LEVELS + 1][SLOTS];
+        size_t counts[LEVELS + 1];
+        std::unordered_map<TimerId, Timer *> timers;
+    };
+}
+
+#endif //BEAMMEUP_TIMERWHEEL_H
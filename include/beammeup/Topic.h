@@ -0,0 +1,150 @@
+#ifndef BEAMMEUP_TOPIC_H
+#define BEAMMEUP_TOPIC_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ConnectionOptions.h"
+#include "Types.h"
+
+namespace BeamMeUp {
+    class Receiver;
+
+    /**
+     * Hashes a topic to the signal it is sent on, using 32 bit FNV-1a. The same topic always gives the same signal,
+     * which is also the signal a NamedSignal of the same name has.
+     * @param topic The topic, e.g. "md.venueX.bid"
+     * @return The signal
+     */
+    Signal topicSignal(const std::string &topic);
+
+    /**
+     * @param topic The topic or pattern
+     * @return true if it contains a wildcard level
+     */
+    bool isTopicPattern(const std::string &topic);
+
+    /**
+     * TopicTrie holds topics and subscription patterns, split into '.' separated levels. In a pattern, a "*" level
+     * matches exactly one level and a "#" level, which must come last, matches any number of levels including none.
+     * It isn't thread safe; Signaler guards it with its connection mutex.
+     */
+    class TopicTrie {
+    public:
+        struct Subscription {
+            Receiver *receiver;
+            ReceiverHandle handle;
+            ConnectionOptions options;
+        };
+
+        typedef std::function<bool(const Subscription &subscription)> SubscriptionMatcher;
+
+        TopicTrie();
+
+        /**
+         * Adds a topic
+         * @param topic The topic, which mustn't contain wildcards
+         * @return false if the topic was already known
+         */
+        bool addTopic(const std::string &topic);
+
+        /**
+         * Adds a subscription
+         * @param pattern The topic pattern
+         * @param subscription The subscription
+         */
+        void addSubscription(const std::string &pattern, const Subscription &subscription);
+
+        /**
+         * Removes subscriptions made with exactly this pattern
+         * @param pattern The topic pattern
+         * @param matcher Returns true for subscriptions to remove
+         * @return The number removed
+         */
+        size_t removeSubscriptions(const std::string &pattern, const SubscriptionMatcher &matcher);
+
+        /**
+         * Removes subscriptions, whatever their pattern
+         * @param matcher Returns true for subscriptions to remove
+         * @return The number removed
+         */
+        size_t removeSubscriptions(const SubscriptionMatcher &matcher);
+
+        /**
+         * Calls visitor for every subscription whose pattern matches topic
+         * @param topic The topic
+         * @param visitor Called for each subscription
+         */
+        void matchSubscriptions(const std::string &topic,
+                                const std::function<void(const Subscription &subscription)> &visitor) const;
+
+        /**
+         * @param topic The topic
+         * @param matcher Returns true for the subscriptions to look for
+         * @return true if a matching subscription's pattern matches topic
+         */
+        bool hasSubscription(const std::string &topic, const SubscriptionMatcher &matcher) const;
+
+        /**
+         * Calls visitor for every known topic that matches pattern
+         * @param pattern The topic pattern
+         * @param visitor Called for each topic
+         */
+        void matchTopics(const std::string &pattern, const std::function<void(const std::string &topic)> &visitor) const;
+
+        /**
+         * @return The number of subscriptions
+         */
+        size_t getSubscriptionCount() const;
+
+        /**
+         * Checks a pattern is well formed
+         * @param pattern The topic pattern
+         * @throws std::runtime_error If "#" isn't the last level
+         */
+        static void validatePattern(const std::string &pattern);
+
+    private:
+        struct Node {
+            std::map<std::string, std::unique_ptr<Node>> children;
+            bool isTopic;
+            std::vector<Subscription> subscriptions;
+
+            Node() : isTopic(false) {
+            }
+
+            /**
+             * @return true if the node holds nothing, so it can be removed
+             */
+            bool isEmpty() const {
+                return !isTopic && subscriptions.empty() && children.empty();
+            }
+        };
+
+        /**
+         * Finds the node for a topic or pattern, creating it if needed
+         * @param topic The topic or pattern
+         * @return The node
+         */
+        Node *insert(const std::string &topic);
+
+        static void matchSubscriptions(const Node *node, const std::vector<std::string> &levels, size_t level,
+                                       const std::function<void(const Subscription &subscription)> &visitor);
+
+        static void matchTopics(const Node *node, const std::vector<std::string> &levels, size_t level,
+                                std::string &path, const std::function<void(const std::string &topic)> &visitor);
+
+        static void visitTopics(const Node *node, size_t depth, std::string &path,
+                                const std::function<void(const std::string &topic)> &visitor);
+
+        static size_t removeSubscriptions(Node *node, const SubscriptionMatcher &matcher);
+
+        Node root;
+        size_t subscriptionCount;
+    };
+}
+
+#endif //BEAMMEUP_TOPIC_H
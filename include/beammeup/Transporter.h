@@ -2,18 +2,36 @@
 #define BEAMMEUP_TRANSPORTER_H
 
 #ifdef THREAD_SAFE
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <shared_mutex>
 #endif
+#include <chrono>
+#include <deque>
+#ifdef THREAD_SAFE
+#include <future>
+#include <memory>
+#include <thread>
+#endif
 #include <queue>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
+#include "HandleTable.h"
 #include "Signaler.h"
+#include "TimerWheel.h"
 #include "Types.h"
 #include "Variant.h"
 
 namespace BeamMeUp {
     class Transporter : public Signaler {
+        friend class Channel;
+        friend class Checkpoint;
+        friend class Dispatcher;
         friend class Receiver;
+        friend class RequestTimer;
         friend class Signaler;
 
     public:
@@ -23,10 +41,87 @@ namespace BeamMeUp {
         Transporter();
 
         /**
-         * Processes any queued events
+         * Closes the event descriptor, if one was opened
+         */
+        ~Transporter();
+
+        /**
+         * Processes any queued events, then calls the callbacks of any requests that have completed. Only receivers
+         * with messages waiting are visited.
          */
         void processMessages();
 
+        /**
+         * Processes queued events until the queues are empty or the budget is used up. Receivers with messages
+         * waiting are visited round robin, one message per visit, so a flooded receiver can't delay the others. The
+         * next call resumes with the receiver after the last one visited.
+         * @param maxMessages The maximum number of messages to process. 0 means no limit.
+         * @param timeLimit The maximum time to spend processing. Zero means no limit.
+         * @return true if messages remain queued
+         */
+        bool processMessages(unsigned int maxMessages,
+                             std::chrono::steady_clock::duration timeLimit = std::chrono::steady_clock::duration::zero());
+
+        /**
+         * @return true if any receiver has messages waiting to be processed
+         */
+        bool hasPendingMessages();
+
+        /**
+         * @return The number of receivers waiting to be processed. Each is counted once, however many messages it has.
+         */
+        size_t getReadyCount();
+
+        /**
+         * Blocks until a message is queued for any receiver, a timer is due, the timeout expires or wakeUp is called.
+         * The caller spins briefly before going to sleep; the spin length adapts to how often spinning pays off. In
+         * the thread unsafe build only timers can produce work while we block, so this sleeps until the next one is
+         * due (within the timeout) or returns immediately if there are none.
+         * @param timeout The maximum time to wait. duration::max() waits forever.
+         * @return true if messages are pending or timers are due
+         */
+        bool waitForMessages(std::chrono::steady_clock::duration timeout = std::chrono::steady_clock::duration::max());
+
+        /**
+         * Wakes any threads blocked in waitForMessages, even if there are no messages. Useful for shutdown. If no
+         * thread is blocked, the next call to waitForMessages returns without sleeping.
+         */
+        void wakeUp();
+
+        /**
+         * Stops processMessages doing anything, then waits for calls already under way on other threads to finish, so
+         * no receiver is being processed when this returns. Messages can still be queued. Dispatchers process
+         * receivers themselves, so stop them first. Called from a handler, it doesn't wait for the call processing
+         * that handler, which carries on once the handler returns. Used to take a Checkpoint.
+         */
+        void quiesce();
+
+        /**
+         * Lets processMessages work again after quiesce
+         */
+        void resume();
+
+        /**
+         * @return true if quiesce has been called without resume
+         */
+        bool isQuiesced() const;
+
+        /**
+         * Opens a descriptor that can be added to an external poll/epoll/select loop. It becomes readable when any
+         * receiver has messages pending and is reset once they have all been processed, so the loop only needs to
+         * call processMessages when it fires. On Linux this is an eventfd, elsewhere the read end of a pipe. Calling
+         * this again returns the same descriptor. The descriptor is owned by the transporter.
+         * @return The descriptor, or -1 if it couldn't be created
+         */
+        int openEventDescriptor();
+
+        /**
+         * The event descriptor doesn't fire for timers. Loops using it should wake by this time (e.g. via the epoll
+         * timeout) and call processMessages.
+         * @return The earliest time a timer may be due, or time_point::max() if there are no timers
+         */
+        std::chrono::steady_clock::time_point getNextTimerExpiry();
+
         /**
          * Checks if this object is registered
          * @param object The object to check
@@ -57,11 +152,233 @@ namespace BeamMeUp {
         void unregisterObject(Receiver *object);
 
     private:
-        typedef std::unordered_set<Receiver *> ObjectSet;
-        ObjectSet objects;
+        /**
+         * Called by receivers when messages are added to their queue
+         * @param count The number of messages added
+         */
+        void messagesQueued(size_t count);
+
+        /**
+         * Called by receivers when messages are removed from their queue
+         * @param count The number of messages removed
+         */
+        void messagesDequeued(size_t count);
+
+        /**
+         * Called by a receiver when it gets messages while it isn't already on the ready list
+         * @param receiver The receiver
+         */
+        void receiverReady(Receiver *receiver);
+
+        /**
+         * A receiver on the ready list
+         */
+        struct ReadyReceiver {
+            Receiver *receiver;
+            // Taken when the receiver was added, so a receiver destroyed since can be skipped
+            ReceiverHandle handle;
+        };
+
+        /**
+         * Takes the receiver at the front of the ready list
+         * @param ready Receives the receiver
+         * @return false if the list was empty
+         */
+        bool popReady(ReadyReceiver &ready);
+
+        /**
+         * Puts a receiver back at the end of the ready list
+         * @param ready The receiver
+         */
+        void pushReady(const ReadyReceiver &ready);
+
+        /**
+         * Processes a receiver from the ready list, putting it back at the end if it still has messages afterwards
+         * @param ready The receiver
+         * @param maxMessages The maximum number of messages to process. 0 means no limit.
+         * @param deadline Stop processing once this time has passed
+         * @return The number of messages processed
+         */
+        int processReady(const ReadyReceiver &ready, unsigned int maxMessages,
+                         const std::chrono::steady_clock::time_point &deadline);
+
+        /**
+         * Schedules a delayed notification
+         * @param signaler The signaler to notify from
+         * @param signal The signal
+         * @param message The message
+         * @param due When to first notify
+         * @param interval Zero for a one-shot notification, otherwise the time between notifications
+         * @return The timer's id
+         */
+        TimerId scheduleTimer(Signaler *signaler, Signal signal, const Variant &message,
+                              std::chrono::steady_clock::time_point due, std::chrono::steady_clock::duration interval);
+
+        /**
+         * Cancels a timer
+         * @param id The timer's id
+         * @return true if the timer was still scheduled
+         */
+        bool unscheduleTimer(TimerId id);
+
+        /**
+         * Cancels every timer scheduled by a signaler. If one of them is expiring on another thread, waits for it to
+         * finish so that the signaler can safely be destroyed.
+         * @param signaler The signaler
+         */
+        void unscheduleTimers(Signaler *signaler);
+
+        /**
+         * Adds a timer to the wheel, waking waiters if it is now the earliest
+         * @param timer The timer, which the wheel takes ownership of
+         * @param due When it expires
+         * @param interval Zero for a one-shot timer, otherwise the time between expiries
+         * @return The timer's id
+         */
+        TimerId addTimer(TimerWheel::Timer *timer, std::chrono::steady_clock::time_point due,
+                         std::chrono::steady_clock::duration interval);
+
 #ifdef THREAD_SAFE
+        /**
+         * Adds a request to the pending table
+         * @param requester The signaler making the request
+         * @param callback Called with the outcome, if set
+         * @param promise Fulfilled with the outcome, if set
+         * @param timeout How long to wait for a reply. Zero waits forever.
+         * @return The request's id
+         */
+        RequestId startRequest(Signaler *requester, const ReplyCallback &callback,
+                               const std::shared_ptr<std::promise<Variant>> &promise,
+                               std::chrono::steady_clock::duration timeout);
+#else
+        /**
+         * Adds a request to the pending table
+         * @param requester The signaler making the request
+         * @param callback Called with the outcome
+         * @param timeout How long to wait for a reply. Zero waits forever.
+         * @return The request's id
+         */
+        RequestId startRequest(Signaler *requester, const ReplyCallback &callback,
+                               std::chrono::steady_clock::duration timeout);
+#endif
+
+        /**
+         * Completes a pending request. Promises are fulfilled immediately; callbacks are queued for processReplies.
+         * @param id The request's id
+         * @param status The outcome
+         * @param reply The reply, for RS_OK
+         * @return false if the request wasn't pending
+         */
+        bool completeRequest(RequestId id, ReplyStatus status, const Variant &reply);
+
+        /**
+         * Drops every request made by a signaler, without calling their callbacks
+         * @param requester The signaler
+         */
+        void cancelRequests(Signaler *requester);
+
+        /**
+         * Calls the callbacks of completed requests
+         */
+        void processReplies();
+
+        /**
+         * Sends the notifications for any timers that are due
+         */
+        void fireTimers();
+
+#ifdef THREAD_SAFE
+        /**
+         * Takes a timer off the expiring list and wakes anyone waiting for it
+         * @param timer The timer, which has just expired
+         */
+        void endExpiry(TimerWheel::Timer *timer);
+#endif
+
+        /**
+         * Recalculates nextTimerExpiry. Must be called with timerMutex held.
+         */
+        void updateNextTimerExpiry();
+
+        /**
+         * @return true if messages are pending or a timer is due
+         */
+        bool isWorkReady();
+
+        class ProcessingScope;
+
+        /**
+         * Makes the event descriptor readable
+         */
+        void setEventDescriptor();
+
+        /**
+         * Resets the event descriptor so it is no longer readable
+         */
+        void resetEventDescriptor();
+
+        struct PendingRequest {
+            Signaler *requester;
+            ReplyCallback callback;
+#ifdef THREAD_SAFE
+            std::shared_ptr<std::promise<Variant>> promise;
+#endif
+            TimerId timer;
+        };
+
+        struct CompletedRequest {
+            Signaler *requester;
+            ReplyCallback callback;
+            ReplyStatus status;
+            Variant reply;
+        };
+
+        std::unordered_set<Receiver *> objects;
+        // Receivers with messages waiting, in the order they got them. readyHead is the front; entries before it
+        // have been taken, and are only erased once they're a good share of the vector, so the list doesn't
+        // allocate once it has grown to the usual number of ready receivers.
+        std::vector<ReadyReceiver> readyReceivers;
+        size_t readyHead;
+#ifdef THREAD_SAFE
+        std::mutex readyMutex;
+        static const unsigned int MIN_SPIN;
+        static const unsigned int MAX_SPIN;
+
+        std::atomic<size_t> pendingMessages;
         std::shared_timed_mutex mutex;
+        std::mutex waitMutex;
+        std::condition_variable waitCondition;
+        std::atomic<unsigned int> waiters;
+        std::atomic<unsigned int> spinLimit;
+        bool wakeRequested;
+        unsigned long wakeGeneration;
+        std::atomic<int> eventDescriptor;
+        std::mutex timerMutex;
+        // Signalled whenever a timer finishes expiring
+        std::condition_variable timerCondition;
+        // The timers currently expiring, and the threads expiring them
+        std::vector<std::pair<TimerWheel::Timer *, std::thread::id>> expiringTimers;
+        std::atomic<std::chrono::steady_clock::rep> nextTimerExpiry;
+        std::mutex requestMutex;
+        std::atomic<RequestId> nextRequestId;
+        std::atomic_bool hasCompletedRequests;
+        std::atomic_bool quiesced;
+        // The number of processMessages calls under way
+        std::atomic<unsigned int> processors;
+#else
+        size_t pendingMessages;
+        int eventDescriptor;
+        std::chrono::steady_clock::rep nextTimerExpiry;
+        RequestId nextRequestId;
+        bool hasCompletedRequests;
+        bool quiesced;
 #endif
+        int eventWriteDescriptor;
+        // Generation tagged handles for the registered objects, so their liveness can be checked without locking
+        HandleTable handles;
+        TimerWheel timers;
+        std::unordered_map<RequestId, PendingRequest> requests;
+        std::deque<CompletedRequest> completedRequests;
     };
 
 }
@@ -8,9 +8,20 @@ namespace BeamMeUp {
     class VariantVector;
 
     typedef unsigned int Signal;
+    typedef unsigned long long TimerId;
+    typedef unsigned long long RequestId;
+    typedef unsigned long long ReceiverHandle;
+    typedef enum {
+        RS_OK = 0,
+        RS_TIMEOUT = 10,
+        RS_CANCELLED = 20,
+        RS_NO_RECEIVER = 30
+    } ReplyStatus;
     class Transporter;
     class Signaler;
     class Receiver;
+    class Channel;
+    class ConnectionFilter;
 }
 
 #endif //BEAMMEUP_TYPES_H
@@ -29,6 +29,8 @@ namespace BeamMeUp {
     } DataType;
 
     class Variant {
+        friend class VariantCodec;
+
     public:
         /**
          * Initializes a null variant.
@@ -257,6 +259,13 @@ namespace BeamMeUp {
          */
         const bool toBool() const;
 
+        /**
+         * Looks up a key without copying the map
+         * @param key The key
+         * @return The value, or nullptr if this isn't a map or doesn't have the key
+         */
+        const Variant *find(const std::string &key) const;
+
         /**
          * Checks if this variant represents nullptr. Returns true if so else false.
          * @return Is this variant referencing null?
@@ -316,6 +325,12 @@ namespace BeamMeUp {
          */
         bool operator<=(const Variant &value) const;
 
+        /**
+         * Exchanges the contents of this variant with another without copying either
+         * @param value The value to swap with
+         */
+        void swap(Variant &value);
+
         /**
          * Returns the actual type of this variant
          * @return The type
@@ -0,0 +1,85 @@
+#ifndef BEAMMEUP_VARIANTCODEC_H
+#define BEAMMEUP_VARIANTCODEC_H
+
+#include <cstddef>
+#include <string>
+
+#include "Types.h"
+
+namespace BeamMeUp {
+    /**
+     * VariantCodec converts variants to and from a compact binary form, for sending them to other processes or
+     * writing them to disk. Each value is a one byte type followed by its data: integers as varints (zigzag encoded
+     * if signed), floating point values in host byte order, and strings and containers as a varint length followed
+     * by their contents. Pointers can't leave the process, so they are encoded as null.
+     */
+    class VariantCodec {
+    public:
+        /**
+         * @param value A variant
+         * @return The number of bytes encode will write for it
+         */
+        static size_t size(const Variant &value);
+
+        /**
+         * Encodes a variant
+         * @param value The variant
+         * @param out Where to write it. Must have room for size(value) bytes.
+         * @return The end of what was written
+         */
+        static char *encode(const Variant &value, char *out);
+
+        /**
+         * Appends an encoded variant to a string
+         * @param value The variant
+         * @param out The string to append to
+         */
+        static void encode(const Variant &value, std::string &out);
+
+        /**
+         * Decodes a variant
+         * @param data The encoded variant. Advanced past it on success.
+         * @param end The end of the available data
+         * @param value Receives the variant
+         * @return false if the data is truncated or malformed
+         */
+        static bool decode(const char *&data, const char *end, Variant &value);
+
+        /**
+         * @param value An unsigned integer
+         * @return The number of bytes its varint takes
+         */
+        static size_t varintSize(unsigned long long value);
+
+        /**
+         * Encodes an unsigned integer as a varint: seven bits per byte, low bits first, with the top bit set on every
+         * byte but the last
+         * @param value The integer
+         * @param out Where to write it
+         * @return The end of what was written
+         */
+        static char *encodeVarint(unsigned long long value, char *out);
+
+        /**
+         * Decodes a varint
+         * @param data The varint. Advanced past it on success.
+         * @param end The end of the available data
+         * @param value Receives the integer
+         * @return false if the varint is truncated or too long
+         */
+        static bool decodeVarint(const char *&data, const char *end, unsigned long long &value);
+
+    private:
+        /**
+         * Decodes a variant nested in a container
+         * @param data The encoded variant. Advanced past it, even on failure.
+         * @param end The end of the available data
+         * @param value Receives the variant
+         * @param depth How deeply the variant is nested
+         * @return false if the data is truncated or malformed
+         */
+        static bool decodeValue(const char *&data, const char *end, Variant &value, unsigned int depth);
+    };
+}
+
+#endif //BEAMMEUP_VARIANTCODEC_H
@@ -0,0 +1,131 @@
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#if defined(__linux__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+#ifdef BEAMMEUP_NUMA
+#include <numa.h>
+#endif
+
+#include "include/beammeup/Affinity.h"
+
+namespace BeamMeUp {
+    int Affinity::getCpuCount() {
+#if defined(__linux__)
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        if (online > 0) {
+            return static_cast<int>(online);
+        }
+#endif
+        unsigned int count = std::thread::hardware_concurrency();
+        return count == 0 ? 1 : static_cast<int>(count);
+    }
+
+    int Affinity::getCurrentCpu() {
+#if defined(__linux__)
+        return sched_getcpu();
+#else
+        return -1;
+#endif
+    }
+
+    int Affinity::getNode(int cpu) {
+#if defined(__linux__)
+        if (cpu < 0) {
+            return -1;
+        }
+
+        // Each CPU's sysfs directory has a nodeN link to the node it belongs to. This works without libnuma.
+        std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        DIR *directory = opendir(path.c_str());
+        if (directory == nullptr) {
+            return -1;
+        }
+
+        int node = -1;
+        while (dirent *entry = readdir(directory)) {
+            if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+                node = std::stoi(entry->d_name + 4);
+                break;
+            }
+        }
+        closedir(directory);
+
+        // Machines without NUMA have everything on node 0, but may not say so
+        return node == -1 ? 0 : node;
+#else
+        return -1;
+#endif
+    }
+
+    bool Affinity::pinCurrentThread(int cpu) {
+#if defined(__linux__)
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            return false;
+        }
+
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+        return false;
+#endif
+    }
+
+    bool Affinity::unpinCurrentThread() {
+#if defined(__linux__)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        int count = getCpuCount();
+        for (int cpu = 0; cpu < count && cpu < CPU_SETSIZE; ++cpu) {
+            CPU_SET(cpu, &cpus);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+        return false;
+#endif
+    }
+
+    bool Affinity::canAllocateOnNode() {
+#ifdef BEAMMEUP_NUMA
+        static const bool available = numa_available() != -1;
+        return available;
+#else
+        return false;
+#endif
+    }
+
+    void *Affinity::allocate(size_t bytes, int node) {
+#ifdef BEAMMEUP_NUMA
+        if (node >= 0 && canAllocateOnNode()) {
+            void *memory = numa_alloc_onnode(bytes, node);
+            if (memory == nullptr) {
+                throw std::bad_alloc();
+            }
+            return memory;
+        }
+#else
+        (void)node;
+#endif
+        return ::operator new(bytes);
+    }
+
+    void Affinity::deallocate(void *memory, size_t bytes, int node) {
+#ifdef BEAMMEUP_NUMA
+        if (node >= 0 && canAllocateOnNode()) {
+            numa_free(memory, bytes);
+            return;
+        }
+#else
+        (void)bytes;
+        (void)node;
+#endif
+        ::operator delete(memory);
+    }
+}
@@ -0,0 +1,91 @@
+#include "include/beammeup/Channel.h"
+#include "include/beammeup/Receiver.h"
+#include "include/beammeup/Transporter.h"
+#include "include/beammeup/VariantVector.h"
+
+namespace BeamMeUp {
+    Channel::Channel(Transporter *transporter, size_t capacity, Receiver *receiver) :
+            transporter(transporter), receiver(receiver), ring(capacity) {
+        overflowed = false;
+        closed = false;
+    }
+
+    void Channel::push(Signal signal, const Variant &message) {
+        pushMessage(signal, message);
+
+        if (transporter != nullptr) {
+            transporter->messagesQueued(1);
+            if (receiver != nullptr) {
+                receiver->markReady();
+            }
+        }
+    }
+
+    void Channel::pushBatch(Signal signal, const VariantVector &messages) {
+        for (auto &message : messages) {
+            pushMessage(signal, message);
+        }
+
+        if (transporter != nullptr) {
+            transporter->messagesQueued(messages.size());
+            if (receiver != nullptr) {
+                receiver->markReady();
+            }
+        }
+    }
+
+    void Channel::pushMessage(Signal signal, const Variant &message) {
+        // Once we've overflowed, everything has to go to the overflow queue until the receiver drains it, otherwise
+        // newer messages in the ring could be processed before older ones in the overflow queue.
+        if (overflowed.load(std::memory_order_acquire) || !ring.push(signal, message)) {
+            std::unique_lock<std::mutex> lock(overflowMutex);
+            overflowed.store(true, std::memory_order_release);
+            overflow.push(signal, message);
+        }
+    }
+
+    bool Channel::pop(Signal &signal, Variant &message) {
+        if (ring.pop(signal, message)) {
+            return true;
+        }
+
+        if (!overflowed.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        std::unique_lock<std::mutex> lock(overflowMutex);
+        // The producer doesn't touch the ring while overflowed is set, and anything it put there before setting it
+        // is older than the overflow queue
+        if (ring.pop(signal, message)) {
+            return true;
+        }
+
+        bool popped = overflow.pop(signal, message);
+        if (overflow.empty()) {
+            overflowed.store(false, std::memory_order_release);
+        }
+
+        return popped;
+    }
+
+    bool Channel::empty() {
+        return ring.empty() && !overflowed.load(std::memory_order_acquire);
+    }
+
+    size_t Channel::size() {
+        std::unique_lock<std::mutex> lock(overflowMutex);
+        return ring.size() + overflow.size();
+    }
+
+    size_t Channel::capacity() const {
+        return ring.capacity();
+    }
+
+    void Channel::close() {
+        closed = true;
+    }
+
+    bool Channel::isClosed() const {
+        return closed;
+    }
+}
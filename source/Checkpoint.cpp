@@ -0,0 +1,386 @@
+#ifndef _WIN32
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "include/beammeup/Checkpoint.h"
+#include "include/beammeup/Epoch.h"
+#include "include/beammeup/Receiver.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Transporter.h"
+#include "include/beammeup/Variant.h"
+#include "include/beammeup/VariantCodec.h"
+
+namespace BeamMeUp {
+    static const unsigned int MAGIC = 0x4b434d42;
+    static const unsigned int VERSION = 1;
+
+    /*
+     * The file is a FileHeader, then the names of the receivers and then the signalers (each a length, the
+     * characters and padding to 8 bytes), then the ConnectionRecords, then for each mailbox a MailboxHeader followed
+     * by its messages (each a MessageHeader, the encoded message and padding to 8 bytes). Names are referred to by
+     * their index.
+     */
+    struct FileHeader {
+        unsigned int magic;
+        unsigned int version;
+        unsigned int receivers;
+        unsigned int signalers;
+        unsigned long long connections;
+        unsigned long long mailboxes;
+        unsigned long long messages;
+    };
+
+    struct ConnectionRecord {
+        unsigned int signaler;
+        unsigned int receiver;
+        Signal signal;
+        unsigned int type;
+        unsigned long long capacity;
+    };
+
+    struct MailboxHeader {
+        unsigned int receiver;
+        unsigned int reserved;
+        unsigned long long count;
+    };
+
+    struct MessageHeader {
+        unsigned int length;
+        Signal signal;
+    };
+
+    static inline size_t padding(size_t size) {
+        return (8 - (size & 7)) & 7;
+    }
+
+    /**
+     * Buffered writes to the snapshot file
+     */
+    class SnapshotWriter {
+    public:
+        SnapshotWriter(const std::string &path) : path(path), file(fopen(path.c_str(), "wb")) {
+            if (file == nullptr) {
+                throw std::runtime_error("Can't write checkpoint " + path + ": " + strerror(errno));
+            }
+            setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        }
+
+        ~SnapshotWriter() {
+            if (file != nullptr) {
+                fclose(file);
+                unlink(path.c_str());
+            }
+        }
+
+        void write(const void *data, size_t size) {
+            static const char zeros[8] = {};
+            if (fwrite(data, 1, size, file) != size || fwrite(zeros, 1, padding(size), file) != padding(size)) {
+                throw std::runtime_error("Can't write checkpoint " + path + ": " + strerror(errno));
+            }
+        }
+
+        long tell() {
+            return ftell(file);
+        }
+
+        void rewrite(long position, const void *data, size_t size) {
+            long end = ftell(file);
+            if (fseek(file, position, SEEK_SET) != 0 || fwrite(data, 1, size, file) != size ||
+                fseek(file, end, SEEK_SET) != 0) {
+                throw std::runtime_error("Can't write checkpoint " + path + ": " + strerror(errno));
+            }
+        }
+
+        /**
+         * Flushes and closes the file, leaving it in place
+         */
+        void finish() {
+            int result = fflush(file) == 0 ? fsync(fileno(file)) : -1;
+            result |= fclose(file);
+            file = nullptr;
+            if (result != 0) {
+                unlink(path.c_str());
+                throw std::runtime_error("Can't write checkpoint " + path + ": " + strerror(errno));
+            }
+        }
+
+    private:
+        std::string path;
+        FILE *file;
+    };
+
+    /**
+     * Bounds checked reads from a mapped snapshot
+     */
+    class SnapshotReader {
+    public:
+        SnapshotReader(const std::string &path) : data(nullptr), size(0), position(0) {
+            int descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (descriptor == -1) {
+                throw std::runtime_error("Can't read checkpoint " + path + ": " + strerror(errno));
+            }
+            struct stat status;
+            void *mapped = MAP_FAILED;
+            if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+                size = static_cast<size_t>(status.st_size);
+                mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            }
+            close(descriptor);
+            if (mapped == MAP_FAILED) {
+                throw std::runtime_error("Can't map checkpoint " + path);
+            }
+            data = static_cast<const char *>(mapped);
+            madvise(const_cast<char *>(data), size, MADV_SEQUENTIAL);
+        }
+
+        ~SnapshotReader() {
+            munmap(const_cast<char *>(data), size);
+        }
+
+        /**
+         * @param bytes The number of bytes wanted
+         * @return The next bytes, skipping the padding after them, or nullptr if the file is too short
+         */
+        const char *take(size_t bytes) {
+            if (size - position < bytes || size - position - bytes < padding(bytes)) {
+                return nullptr;
+            }
+            const char *taken = data + position;
+            position += bytes + padding(bytes);
+            return taken;
+        }
+
+        template<typename Record>
+        const Record &take() {
+            const char *taken = take(sizeof(Record));
+            if (taken == nullptr) {
+                throw std::runtime_error("Checkpoint is truncated");
+            }
+            return *reinterpret_cast<const Record *>(taken);
+        }
+
+    private:
+        const char *data;
+        size_t size;
+        size_t position;
+    };
+
+    Checkpoint::Checkpoint(Transporter *transporter) : transporter(transporter) {
+    }
+
+    void Checkpoint::add(const std::string &name, Receiver *receiver) {
+        receivers.emplace_back(name, receiver);
+    }
+
+    void Checkpoint::add(const std::string &name, Signaler *signaler) {
+        signalers.emplace_back(name, signaler);
+    }
+
+    size_t Checkpoint::save(const std::string &path) {
+        bool weQuiesced = transporter != nullptr && !transporter->isQuiesced();
+        if (weQuiesced) {
+            transporter->quiesce();
+        }
+
+        size_t saved = 0;
+        try {
+            // Written alongside and renamed over the old snapshot, so a crash can't leave a half written one
+            std::string temporary = path + ".tmp";
+            SnapshotWriter writer(temporary);
+            FileHeader header = {MAGIC, VERSION, static_cast<unsigned int>(receivers.size()),
+                                 static_cast<unsigned int>(signalers.size()), 0, 0, 0};
+            writer.write(&header, sizeof(header));
+
+            std::unordered_map<Receiver *, unsigned int> receiverIds;
+            for (auto &receiver : receivers) {
+                receiverIds[receiver.second] = static_cast<unsigned int>(receiverIds.size());
+            }
+            for (auto &named : receivers) {
+                unsigned int length = static_cast<unsigned int>(named.first.size());
+                writer.write(&length, sizeof(length));
+                writer.write(named.first.data(), named.first.size());
+            }
+            for (auto &named : signalers) {
+                unsigned int length = static_cast<unsigned int>(named.first.size());
+                writer.write(&length, sizeof(length));
+                writer.write(named.first.data(), named.first.size());
+            }
+
+            for (unsigned int i = 0; i < signalers.size(); ++i) {
+                std::vector<ConnectionRecord> records;
+                {
+                    Epoch::Guard guard;
+                    signalers[i].second->connections.forEach([&](Signal signal, const Connection &connection) {
+                        auto id = receiverIds.find(connection.receiver);
+                        if (id == receiverIds.end() || connection.filter != nullptr) {
+                            return;
+                        }
+                        ConnectionRecord record = {i, id->second, signal, C_QUEUED, ConnectionOptions::DEFAULT_CAPACITY};
+                        if (connection.direct) {
+                            record.type = C_DIRECT;
+                        }
+#ifdef THREAD_SAFE
+                        if (connection.channel != nullptr) {
+                            record.type = C_SPSC;
+                            record.capacity = connection.channel->capacity();
+                        }
+#endif
+                        records.push_back(record);
+                    });
+                }
+                for (auto &record : records) {
+                    writer.write(&record, sizeof(record));
+                }
+                header.connections += records.size();
+            }
+
+            std::string encoded;
+            for (auto &named : receivers) {
+                // The count is filled in afterwards, as messages may still be arriving
+                MailboxHeader mailbox = {receiverIds[named.second], 0, 0};
+                long position = writer.tell();
+                writer.write(&mailbox, sizeof(mailbox));
+                named.second->forEachQueued([&](Signal signal, const Variant &message) {
+                    encoded.clear();
+                    VariantCodec::encode(message, encoded);
+                    MessageHeader record = {static_cast<unsigned int>(encoded.size()), signal};
+                    writer.write(&record, sizeof(record));
+                    writer.write(encoded.data(), encoded.size());
+                    mailbox.count++;
+                });
+                writer.rewrite(position, &mailbox, sizeof(mailbox));
+                header.mailboxes++;
+                header.messages += mailbox.count;
+            }
+
+            writer.rewrite(0, &header, sizeof(header));
+            writer.finish();
+            if (rename(temporary.c_str(), path.c_str()) != 0) {
+                unlink(temporary.c_str());
+                throw std::runtime_error("Can't replace checkpoint " + path + ": " + strerror(errno));
+            }
+            saved = static_cast<size_t>(header.messages);
+        } catch (...) {
+            if (weQuiesced) {
+                transporter->resume();
+            }
+            throw;
+        }
+
+        if (weQuiesced) {
+            transporter->resume();
+        }
+        return saved;
+    }
+
+    size_t Checkpoint::restore(const std::string &path) {
+        SnapshotReader reader(path);
+        const FileHeader header = reader.take<FileHeader>();
+        if (header.magic != MAGIC || header.version != VERSION) {
+            throw std::runtime_error("Not a checkpoint: " + path);
+        }
+
+        // Match the saved names to the objects added here
+        std::unordered_map<std::string, Receiver *> receiversByName(receivers.begin(), receivers.end());
+        std::unordered_map<std::string, Signaler *> signalersByName(signalers.begin(), signalers.end());
+        std::vector<Receiver *> savedReceivers;
+        std::vector<Signaler *> savedSignalers;
+        for (unsigned int i = 0; i < header.receivers + header.signalers; ++i) {
+            unsigned int length = reader.take<unsigned int>();
+            const char *name = reader.take(length);
+            if (name == nullptr) {
+                throw std::runtime_error("Checkpoint is truncated");
+            }
+            std::string key(name, length);
+            if (i < header.receivers) {
+                auto found = receiversByName.find(key);
+                savedReceivers.push_back(found != receiversByName.end() ? found->second : nullptr);
+            } else {
+                auto found = signalersByName.find(key);
+                savedSignalers.push_back(found != signalersByName.end() ? found->second : nullptr);
+            }
+        }
+
+        std::map<Signaler *, std::multimap<Signal, Receiver *>> existing;
+        for (unsigned long long i = 0; i < header.connections; ++i) {
+            const ConnectionRecord record = reader.take<ConnectionRecord>();
+            if (record.signaler >= savedSignalers.size() || record.receiver >= savedReceivers.size()) {
+                throw std::runtime_error("Checkpoint is damaged");
+            }
+            Signaler *signaler = savedSignalers[record.signaler];
+            Receiver *receiver = savedReceivers[record.receiver];
+            if (signaler == nullptr || receiver == nullptr) {
+                continue;
+            }
+
+            auto connected = existing.find(signaler);
+            if (connected == existing.end()) {
+                connected = existing.emplace(signaler, signaler->getConnectedObjects()).first;
+            }
+            auto range = connected->second.equal_range(record.signal);
+            bool duplicate = false;
+            for (auto it = range.first; it != range.second && !duplicate; ++it) {
+                duplicate = it->second == receiver;
+            }
+            if (!duplicate) {
+                signaler->connect(record.signal, receiver,
+                                  ConnectionOptions(static_cast<ConnectionType>(record.type),
+                                                    static_cast<size_t>(record.capacity)));
+            }
+        }
+
+        size_t restored = 0;
+        for (unsigned long long i = 0; i < header.mailboxes; ++i) {
+            const MailboxHeader mailbox = reader.take<MailboxHeader>();
+            if (mailbox.receiver >= savedReceivers.size()) {
+                throw std::runtime_error("Checkpoint is damaged");
+            }
+
+            bool truncated = false;
+            unsigned long long remaining = mailbox.count;
+            auto next = [&](Signal &signal, Variant &message) {
+                while (remaining > 0) {
+                    remaining--;
+                    const char *data = reader.take(sizeof(MessageHeader));
+                    const char *payload = data != nullptr ?
+                            reader.take(reinterpret_cast<const MessageHeader *>(data)->length) : nullptr;
+                    if (payload == nullptr) {
+                        truncated = true;
+                        remaining = 0;
+                        return false;
+                    }
+                    auto record = reinterpret_cast<const MessageHeader *>(data);
+                    signal = record->signal;
+                    const char *end = payload + record->length;
+                    if (VariantCodec::decode(payload, end, message) && payload == end) {
+                        return true;
+                    }
+                }
+                return false;
+            };
+
+            Receiver *receiver = savedReceivers[mailbox.receiver];
+            if (receiver != nullptr) {
+                restored += receiver->receiveRestored(static_cast<size_t>(mailbox.count), next);
+            } else {
+                Signal signal;
+                Variant message;
+                while (next(signal, message)) {
+                }
+            }
+            if (truncated) {
+                throw std::runtime_error("Checkpoint is truncated");
+            }
+        }
+
+        return restored;
+    }
+}
+#endif
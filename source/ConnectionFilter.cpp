@@ -0,0 +1,58 @@
+#include "include/beammeup/ConnectionFilter.h"
+
+namespace BeamMeUp {
+    ConnectionFilter::ConnectionFilter(const Predicate &predicate) : predicate(predicate), op(F_EQUAL), hits(0),
+                                                                     misses(0) {
+    }
+
+    ConnectionFilter::ConnectionFilter(const std::string &field, FilterOperator op, const Variant &value)
+            : field(field), op(op), value(value), hits(0), misses(0) {
+    }
+
+    bool ConnectionFilter::accept(Signal signal, const Variant &message) {
+        bool accepted = predicate ? predicate(signal, message) : compare(message);
+#ifdef THREAD_SAFE
+        (accepted ? hits : misses).fetch_add(1, std::memory_order_relaxed);
+#else
+        (accepted ? hits : misses)++;
+#endif
+
+        return accepted;
+    }
+
+    unsigned long long ConnectionFilter::getHits() const {
+        return hits;
+    }
+
+    unsigned long long ConnectionFilter::getMisses() const {
+        return misses;
+    }
+
+    bool ConnectionFilter::compare(const Variant &message) const {
+        const Variant *actual = &message;
+        if (!field.empty()) {
+            // Looked up in place: copying the map would cost as much as delivering the message
+            actual = message.find(field);
+            if (actual == nullptr) {
+                return false;
+            }
+        }
+
+        switch (op) {
+            case F_EQUAL:
+                return *actual == value;
+            case F_NOT_EQUAL:
+                return *actual != value;
+            case F_LESS:
+                return *actual < value;
+            case F_LESS_EQUAL:
+                return *actual <= value;
+            case F_GREATER:
+                return *actual > value;
+            case F_GREATER_EQUAL:
+                return *actual >= value;
+        }
+
+        return false;
+    }
+}
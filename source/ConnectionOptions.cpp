@@ -0,0 +1,12 @@
+#include "include/beammeup/ConnectionOptions.h"
+
+namespace BeamMeUp {
+    const size_t ConnectionOptions::DEFAULT_CAPACITY = 1024;
+
+    ConnectionOptions::ConnectionOptions(ConnectionType type, size_t capacity) : type(type), capacity(capacity) {
+    }
+
+    ConnectionOptions::ConnectionOptions(const std::shared_ptr<ConnectionFilter> &filter)
+            : type(C_QUEUED), capacity(DEFAULT_CAPACITY), filter(filter) {
+    }
+}
@@ -0,0 +1,243 @@
+#include <algorithm>
+
+#include "include/beammeup/ConnectionTable.h"
+#include "include/beammeup/Epoch.h"
+
+namespace BeamMeUp {
+    const unsigned int ConnectionTable::MIN_INDEX_BITS = 4;
+    const size_t ConnectionTable::MIN_LIST_CAPACITY = 4;
+
+    /**
+     * Spreads signals over the index. Signals are often small consecutive integers, so they are multiplied by the
+     * golden ratio and the top bits taken.
+     * @param signal The signal
+     * @param bits log2 of the number of slots
+     * @return The signal's home slot
+     */
+    static inline size_t hashSignal(Signal signal, unsigned int bits) {
+        return static_cast<size_t>((static_cast<unsigned long long>(signal) * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+    }
+
+    ConnectionTable::List::List(size_t capacity) : count(0), capacity(capacity) {
+        connections = new Connection[capacity];
+    }
+
+    ConnectionTable::List::~List() {
+        delete[] connections;
+    }
+
+    size_t ConnectionTable::List::size() const {
+        return count.load(std::memory_order_acquire);
+    }
+
+    const Connection &ConnectionTable::List::operator[](size_t index) const {
+        return connections[index];
+    }
+
+    ConnectionTable::Index::Index(unsigned int bits) : bits(bits), mask((size_t(1) << bits) - 1), used(0) {
+        slots = new Slot[mask + 1];
+        for (size_t i = 0; i <= mask; ++i) {
+            slots[i].signal.store(0, std::memory_order_relaxed);
+            slots[i].list.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ConnectionTable::Index::~Index() {
+        delete[] slots;
+    }
+
+    ConnectionTable::ConnectionTable() {
+        index.store(new Index(MIN_INDEX_BITS), std::memory_order_release);
+    }
+
+    ConnectionTable::~ConnectionTable() {
+        Index *current = index.load(std::memory_order_relaxed);
+        for (size_t i = 0; i <= current->mask; ++i) {
+            delete current->slots[i].list.load(std::memory_order_relaxed);
+        }
+        delete current;
+    }
+
+    const ConnectionTable::List *ConnectionTable::find(Signal signal) const {
+        Index *current = index.load(std::memory_order_acquire);
+
+        for (size_t i = hashSignal(signal, current->bits);; i = (i + 1) & current->mask) {
+            Slot &slot = current->slots[i];
+            // The list is published after the signal, so a non-null list means the signal can be read
+            List *list = slot.list.load(std::memory_order_acquire);
+            if (list == nullptr) {
+                return nullptr;
+            }
+            if (slot.signal.load(std::memory_order_relaxed) == signal) {
+                return list->size() != 0 ? list : nullptr;
+            }
+        }
+    }
+
+    void ConnectionTable::forEach(const std::function<void(Signal signal, const Connection &connection)> &visit) const {
+        Index *current = index.load(std::memory_order_acquire);
+
+        for (size_t i = 0; i <= current->mask; ++i) {
+            Slot &slot = current->slots[i];
+            List *list = slot.list.load(std::memory_order_acquire);
+            if (list == nullptr) {
+                continue;
+            }
+
+            Signal signal = slot.signal.load(std::memory_order_relaxed);
+            size_t count = list->size();
+            for (size_t j = 0; j < count; ++j) {
+                visit(signal, list->connections[j]);
+            }
+        }
+    }
+
+    void ConnectionTable::add(Signal signal, const Connection &connection) {
+        Index *current = index.load(std::memory_order_relaxed);
+        Slot *slot = findSlot(current, signal);
+        List *list = slot->list.load(std::memory_order_relaxed);
+
+        if (list == nullptr) {
+            // Keep the index at most half full so probes stay short
+            if ((current->used + 1) * 2 > current->mask + 1) {
+                grow();
+                current = index.load(std::memory_order_relaxed);
+                slot = findSlot(current, signal);
+            }
+
+            list = new List(MIN_LIST_CAPACITY);
+            list->connections[0] = connection;
+            list->count.store(1, std::memory_order_relaxed);
+            slot->signal.store(signal, std::memory_order_relaxed);
+            slot->list.store(list, std::memory_order_release);
+            current->used++;
+            return;
+        }
+
+        size_t count = list->count.load(std::memory_order_relaxed);
+        if (count < list->capacity) {
+            // Readers only look below count, so the new entry can be filled in place
+            list->connections[count] = connection;
+            list->count.store(count + 1, std::memory_order_release);
+            return;
+        }
+
+        List *larger = new List(list->capacity * 2);
+        for (size_t i = 0; i < count; ++i) {
+            larger->connections[i] = list->connections[i];
+        }
+        larger->connections[count] = connection;
+        larger->count.store(count + 1, std::memory_order_relaxed);
+        slot->list.store(larger, std::memory_order_release);
+        Epoch::retire(list, &deleteList);
+    }
+
+    void ConnectionTable::remove(Signal signal, const Matcher &matches, std::vector<Connection> &removed) {
+        Slot *slot = findSlot(index.load(std::memory_order_relaxed), signal);
+        if (slot->list.load(std::memory_order_relaxed) != nullptr) {
+            removeFromSlot(*slot, matches, removed);
+        }
+    }
+
+    void ConnectionTable::removeAll(const Matcher &matches, std::vector<Connection> &removed) {
+        Index *current = index.load(std::memory_order_relaxed);
+        for (size_t i = 0; i <= current->mask; ++i) {
+            if (current->slots[i].list.load(std::memory_order_relaxed) != nullptr) {
+                removeFromSlot(current->slots[i], matches, removed);
+            }
+        }
+    }
+
+    ConnectionTable::Slot *ConnectionTable::findSlot(Index *index, Signal signal) {
+        for (size_t i = hashSignal(signal, index->bits);; i = (i + 1) & index->mask) {
+            Slot &slot = index->slots[i];
+            if (slot.list.load(std::memory_order_relaxed) == nullptr ||
+                slot.signal.load(std::memory_order_relaxed) == signal) {
+                return &slot;
+            }
+        }
+    }
+
+    void ConnectionTable::removeFromSlot(Slot &slot, const Matcher &matches, std::vector<Connection> &removed) {
+        List *list = slot.list.load(std::memory_order_relaxed);
+        size_t count = list->count.load(std::memory_order_relaxed);
+
+        size_t matched = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (matches(list->connections[i])) {
+                matched++;
+            }
+        }
+        if (matched == 0) {
+            return;
+        }
+
+        // Readers may be walking the old list, so the survivors go into a new one. An emptied list stays in the
+        // slot until the index is next rebuilt, so that probes for other signals still pass over it.
+        List *remaining = new List(std::max(count - matched, MIN_LIST_CAPACITY));
+        size_t kept = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (matches(list->connections[i])) {
+                removed.push_back(list->connections[i]);
+            } else {
+                remaining->connections[kept++] = list->connections[i];
+            }
+        }
+        remaining->count.store(kept, std::memory_order_relaxed);
+        slot.list.store(remaining, std::memory_order_release);
+        Epoch::retire(list, &deleteList);
+    }
+
+    void ConnectionTable::grow() {
+        Index *current = index.load(std::memory_order_relaxed);
+
+        size_t live = 0;
+        for (size_t i = 0; i <= current->mask; ++i) {
+            List *list = current->slots[i].list.load(std::memory_order_relaxed);
+            if (list != nullptr && list->count.load(std::memory_order_relaxed) != 0) {
+                live++;
+            }
+        }
+
+        // Size for a quarter full, so the index doubles at most once per doubling of the signals
+        unsigned int bits = MIN_INDEX_BITS;
+        while ((size_t(1) << bits) < (live + 1) * 4) {
+            bits++;
+        }
+
+        Index *larger = new Index(bits);
+        std::vector<List *> emptied;
+        for (size_t i = 0; i <= current->mask; ++i) {
+            Slot &slot = current->slots[i];
+            List *list = slot.list.load(std::memory_order_relaxed);
+            if (list == nullptr) {
+                continue;
+            }
+            if (list->count.load(std::memory_order_relaxed) == 0) {
+                emptied.push_back(list);
+                continue;
+            }
+
+            Signal signal = slot.signal.load(std::memory_order_relaxed);
+            Slot *target = findSlot(larger, signal);
+            target->signal.store(signal, std::memory_order_relaxed);
+            target->list.store(list, std::memory_order_relaxed);
+            larger->used++;
+        }
+
+        index.store(larger, std::memory_order_release);
+        // The other lists now belong to the new index, so only the slots are freed
+        Epoch::retire(current, &deleteIndex);
+        for (auto list : emptied) {
+            Epoch::retire(list, &deleteList);
+        }
+    }
+
+    void ConnectionTable::deleteList(void *list) {
+        delete static_cast<List *>(list);
+    }
+
+    void ConnectionTable::deleteIndex(void *index) {
+        delete static_cast<Index *>(index);
+    }
+}
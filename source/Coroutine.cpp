@@ -0,0 +1,35 @@
+#include "include/beammeup/Coroutine.h"
+
+#ifdef BEAMMEUP_COROUTINES
+#include "include/beammeup/Receiver.h"
+
+namespace BeamMeUp {
+    MessageAwaiter::MessageAwaiter(Receiver *receiver, Signal signal, std::chrono::steady_clock::duration timeout) :
+            receiver(receiver), signal(signal), timeout(timeout), timer(0) {
+    }
+
+    bool MessageAwaiter::await_ready() const noexcept {
+        return false;
+    }
+
+    void MessageAwaiter::await_suspend(std::coroutine_handle<> handle) {
+        this->handle = handle;
+        receiver->addAwaiter(this);
+    }
+
+    std::optional<Variant> MessageAwaiter::await_resume() {
+        return std::move(message);
+    }
+
+    void MessageAwaiter::resume() {
+        // The awaiter lives in the frame, so it is gone once the coroutine finishes
+        std::coroutine_handle<> coroutine = handle;
+        try {
+            coroutine.resume();
+        } catch (...) {
+            coroutine.destroy();
+            throw;
+        }
+    }
+}
+#endif
@@ -0,0 +1,433 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "include/beammeup/Affinity.h"
+#include "include/beammeup/Dispatcher.h"
+#include "include/beammeup/Epoch.h"
+#include "include/beammeup/Receiver.h"
+#include "include/beammeup/Transporter.h"
+
+namespace BeamMeUp {
+    const unsigned int Dispatcher::BATCH_SIZE = 64;
+    const std::chrono::microseconds Dispatcher::IDLE_WAIT(200);
+    const unsigned int Dispatcher::MAX_MIGRATIONS = 8;
+
+    Dispatcher::Dispatcher(Transporter *transporter, unsigned int threads) :
+            transporter(transporter), threads(threads == 0 ? 1 : threads), running(false), stopping(true),
+            rebalanceInterval(0), nextRebalance(0), errors(0) {
+        for (unsigned int i = 0; i < this->threads; ++i) {
+            workers.emplace_back(new Worker());
+            workers.back()->cpu = -1;
+        }
+    }
+
+    Dispatcher::Dispatcher(Transporter *transporter, const std::vector<int> &cpus) :
+            transporter(transporter), threads(static_cast<unsigned int>(cpus.size())), running(false),
+            stopping(true), rebalanceInterval(0), nextRebalance(0), errors(0) {
+        if (cpus.empty()) {
+            throw std::runtime_error("Dispatcher needs at least one CPU");
+        }
+
+        for (int cpu : cpus) {
+            workers.emplace_back(new Worker());
+            workers.back()->cpu = cpu;
+        }
+    }
+
+    Dispatcher::~Dispatcher() {
+        stop();
+    }
+
+    void Dispatcher::start() {
+        if (running) {
+            return;
+        }
+
+        running = true;
+        stopping = false;
+        for (unsigned int i = 0; i < threads; ++i) {
+            workers[i]->thread = std::thread(&Dispatcher::run, this, i);
+        }
+    }
+
+    void Dispatcher::stop() {
+        if (!running) {
+            return;
+        }
+
+        stopping = true;
+        transporter->wakeUp();
+        {
+            std::unique_lock<std::mutex> lock(idleMutex);
+            idleCondition.notify_all();
+        }
+        for (auto &worker : workers) {
+            worker->thread.join();
+        }
+        running = false;
+
+        // The receivers we had queued are still marked ready, so they have to go back on the transporter's list or
+        // they would never be processed again
+        for (auto &worker : workers) {
+            for (auto *queue : {&worker->pinned, &worker->tasks}) {
+                for (auto &task : *queue) {
+                    transporter->pushReady({task.receiver, task.handle});
+                }
+                queue->clear();
+            }
+        }
+    }
+
+    unsigned int Dispatcher::getThreads() const {
+        return threads;
+    }
+
+    int Dispatcher::getWorkerCpu(unsigned int worker) const {
+        return worker < threads ? workers[worker]->cpu : -1;
+    }
+
+    void Dispatcher::pin(Receiver *receiver, unsigned int worker) {
+        if (worker >= threads) {
+            throw std::runtime_error("No dispatcher worker " + std::to_string(worker));
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(pinMutex);
+            pinnedReceivers[receiver] = receiver->handle;
+            receiver->affinity = static_cast<int>(worker);
+        }
+        {
+            int node = Affinity::getNode(workers[worker]->cpu);
+            std::unique_lock<std::shared_timed_mutex> lock(receiver->mutex);
+            receiver->messageQueue.setNode(node);
+        }
+
+        // If the old worker has it queued, it moves now rather than after its next batch there. Either way it is
+        // only processed by one thread at a time, so its messages stay in order.
+        moveTask(receiver, worker);
+    }
+
+    void Dispatcher::pinToCpu(Receiver *receiver, int cpu) {
+        for (unsigned int i = 0; i < threads; ++i) {
+            if (workers[i]->cpu == cpu) {
+                pin(receiver, i);
+                return;
+            }
+        }
+
+        throw std::runtime_error("No dispatcher worker on CPU " + std::to_string(cpu));
+    }
+
+    void Dispatcher::unpin(Receiver *receiver) {
+        {
+            std::unique_lock<std::mutex> lock(pinMutex);
+            pinnedReceivers.erase(receiver);
+            receiver->affinity = -1;
+        }
+        std::unique_lock<std::shared_timed_mutex> lock(receiver->mutex);
+        receiver->messageQueue.setNode(-1);
+    }
+
+    int Dispatcher::getAffinity(const Receiver *receiver) const {
+        return receiver->affinity;
+    }
+
+    void Dispatcher::setRebalanceInterval(std::chrono::steady_clock::duration interval) {
+        rebalanceInterval = interval.count();
+        nextRebalance = (std::chrono::steady_clock::now() + interval).time_since_epoch().count();
+    }
+
+    unsigned int Dispatcher::rebalance() {
+        std::unique_lock<std::mutex> rebalancing(rebalanceMutex);
+
+        struct Load {
+            Receiver *receiver;
+            unsigned int worker;
+            unsigned long long time;
+        };
+        std::vector<Load> loads;
+        std::vector<unsigned long long> workerLoads(threads, 0);
+        {
+            std::unique_lock<std::mutex> lock(pinMutex);
+            // The guard keeps the receivers from being destroyed while we read them
+            Epoch::Guard guard;
+            for (auto it = pinnedReceivers.begin(); it != pinnedReceivers.end();) {
+                if (!transporter->handles.isValid(it->second)) {
+                    it = pinnedReceivers.erase(it);
+                    continue;
+                }
+
+                Receiver *receiver = it->first;
+                unsigned int worker = static_cast<unsigned int>(receiver->affinity.load());
+                unsigned long long time = receiver->processingTime.exchange(0);
+                loads.push_back({receiver, worker, time});
+                workerLoads[worker] += time;
+                ++it;
+            }
+        }
+
+        // Largest first, so the biggest receiver that fits in a gap is found first
+        std::sort(loads.begin(), loads.end(), [](const Load &a, const Load &b) { return a.time > b.time; });
+
+        std::vector<Load> moves;
+        while (moves.size() < MAX_MIGRATIONS) {
+            auto busiest = std::max_element(workerLoads.begin(), workerLoads.end()) - workerLoads.begin();
+            auto idlest = std::min_element(workerLoads.begin(), workerLoads.end()) - workerLoads.begin();
+            unsigned long long gap = workerLoads[busiest] - workerLoads[idlest];
+
+            // Moving a receiver that took less than the gap leaves the pair closer than they were
+            auto candidate = std::find_if(loads.begin(), loads.end(), [busiest, gap](const Load &load) {
+                return load.worker == static_cast<unsigned int>(busiest) && load.time != 0 && load.time < gap;
+            });
+            if (candidate == loads.end()) {
+                break;
+            }
+
+            workerLoads[busiest] -= candidate->time;
+            workerLoads[idlest] += candidate->time;
+            candidate->worker = static_cast<unsigned int>(idlest);
+            moves.push_back(*candidate);
+        }
+
+        unsigned int moved = 0;
+        for (auto &move : moves) {
+            Epoch::Guard guard;
+            ReceiverHandle handle;
+            {
+                std::unique_lock<std::mutex> lock(pinMutex);
+                auto it = pinnedReceivers.find(move.receiver);
+                // Unpinned or destroyed since we looked
+                if (it == pinnedReceivers.end()) {
+                    continue;
+                }
+                handle = it->second;
+            }
+            if (transporter->handles.isValid(handle)) {
+                pin(move.receiver, move.worker);
+                moved++;
+            }
+        }
+
+        return moved;
+    }
+
+    std::exception_ptr Dispatcher::takeError() {
+        std::unique_lock<std::mutex> lock(errorMutex);
+        std::exception_ptr taken = error;
+        error = nullptr;
+        return taken;
+    }
+
+    unsigned long long Dispatcher::getErrorCount() const {
+        return errors;
+    }
+
+    void Dispatcher::moveTask(Receiver *receiver, unsigned int worker) {
+        Task task;
+        bool found = false;
+        for (unsigned int i = 0; i < threads && !found; ++i) {
+            if (i == worker) {
+                continue;
+            }
+
+            Worker &old = *workers[i];
+            std::unique_lock<std::mutex> lock(old.mutex);
+            for (auto it = old.pinned.begin(); it != old.pinned.end(); ++it) {
+                if (it->receiver == receiver && it->handle == receiver->handle) {
+                    task = *it;
+                    old.pinned.erase(it);
+                    found = true;
+                    break;
+                }
+            }
+        }
+
+        if (found) {
+            pushTask(worker, task);
+        }
+    }
+
+    void Dispatcher::checkRebalance(std::chrono::steady_clock::time_point now) {
+        std::chrono::steady_clock::rep interval = rebalanceInterval;
+        if (interval == 0) {
+            return;
+        }
+
+        std::chrono::steady_clock::rep due = nextRebalance;
+        if (now.time_since_epoch().count() < due) {
+            return;
+        }
+
+        // Whoever moves the time on does the rebalancing
+        if (nextRebalance.compare_exchange_strong(due, now.time_since_epoch().count() + interval)) {
+            rebalance();
+        }
+    }
+
+    void Dispatcher::run(unsigned int index) {
+        if (workers[index]->cpu != -1) {
+            Affinity::pinCurrentThread(workers[index]->cpu);
+        }
+
+        while (!stopping) {
+            try {
+                Task task;
+                if (popTask(index, task) || stealTask(index, task)) {
+                    process(index, task);
+                    checkRebalance(std::chrono::steady_clock::now());
+                    continue;
+                }
+
+                // Out of work. One worker at a time looks for more; the rest wait for it.
+                std::unique_lock<std::mutex> scanning(scanMutex, std::try_to_lock);
+                if (scanning.owns_lock() && schedule(index)) {
+                    continue;
+                }
+            } catch (...) {
+                // Escaping the thread would terminate the process, so it is kept for takeError instead
+                std::unique_lock<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                errors++;
+                continue;
+            }
+
+            idle();
+        }
+    }
+
+    bool Dispatcher::popTask(unsigned int index, Task &task) {
+        Worker &worker = *workers[index];
+        std::unique_lock<std::mutex> lock(worker.mutex);
+
+        // Oldest first, as a receiver with more to do goes to the back after each batch. Alternate between the queues
+        // so neither kind of receiver can starve the other.
+        bool pinnedFirst = worker.pinned.size() >= worker.tasks.size();
+        std::deque<Task> &first = pinnedFirst ? worker.pinned : worker.tasks;
+        std::deque<Task> &second = pinnedFirst ? worker.tasks : worker.pinned;
+        std::deque<Task> &queue = first.empty() ? second : first;
+        if (queue.empty()) {
+            return false;
+        }
+
+        task = queue.front();
+        queue.pop_front();
+        return true;
+    }
+
+    bool Dispatcher::stealTask(unsigned int index, Task &task) {
+        for (unsigned int i = 1; i < threads; ++i) {
+            Worker &victim = *workers[(index + i) % threads];
+            std::unique_lock<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                // From the back, the receiver its owner would get to last
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void Dispatcher::pushTask(unsigned int index, const Task &task) {
+        // Must be called with the receiver known to be alive
+        int affinity = task.receiver->affinity;
+        bool pinned = affinity >= 0 && static_cast<unsigned int>(affinity) < threads;
+        {
+            Worker &worker = *workers[pinned ? static_cast<unsigned int>(affinity) : index];
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            (pinned ? worker.pinned : worker.tasks).push_back(task);
+        }
+
+        std::unique_lock<std::mutex> lock(idleMutex);
+        // Only the one worker can take a pinned task, so make sure it wakes
+        if (pinned) {
+            idleCondition.notify_all();
+        } else {
+            idleCondition.notify_one();
+        }
+    }
+
+    void Dispatcher::process(unsigned int index, const Task &task) {
+        // The guard keeps the receiver from being destroyed until it is claimed. Once claimed, its destructor waits
+        // for the claim to be released, so handlers don't run inside the guard.
+        {
+            Epoch::Guard guard;
+            if (!transporter->handles.isValid(task.handle)) {
+                return;
+            }
+
+            // Another thread is processing the receiver. It stays ours, as it is still marked ready.
+            if (!task.receiver->claim()) {
+                if (task.receiver->rearm()) {
+                    pushTask(index, task);
+                }
+                return;
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        int count;
+        try {
+            count = task.receiver->processClaimed(BATCH_SIZE, std::chrono::steady_clock::time_point::max());
+        } catch (...) {
+            // Queued again if messages are left, or nothing would ever process them
+            bool again = task.receiver->rearm();
+            task.receiver->release();
+            if (again) {
+                pushTask(index, task);
+            }
+            throw;
+        }
+        if (count != 0) {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            task.receiver->processingTime.fetch_add(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+        }
+
+        // Receivers that are ready again stay with the dispatcher rather than going back on the transporter's list.
+        // Rearmed before releasing, as the receiver may be destroyed as soon as it is released.
+        bool again = task.receiver->rearm();
+        task.receiver->release();
+        if (again) {
+            pushTask(index, task);
+        }
+    }
+
+    bool Dispatcher::schedule(unsigned int index) {
+        transporter->fireTimers();
+        transporter->processReplies();
+
+        // Deal out the receivers that got messages since we last looked
+        unsigned int next = index;
+        bool scheduled = false;
+        Transporter::ReadyReceiver ready;
+        while (transporter->popReady(ready)) {
+            Epoch::Guard guard;
+            if (!transporter->handles.isValid(ready.handle)) {
+                continue;
+            }
+            pushTask(next, {ready.receiver, ready.handle});
+            next = (next + 1) % threads;
+            scheduled = true;
+        }
+
+        return scheduled;
+    }
+
+    void Dispatcher::idle() {
+        if (!transporter->hasPendingMessages()) {
+            // Woken by new messages, timers and stop
+            transporter->waitForMessages(std::chrono::milliseconds(10));
+            return;
+        }
+
+        // Messages are waiting, but their receivers are busy on other workers. Wait for a task to be queued, or for
+        // a while before looking again.
+        std::unique_lock<std::mutex> lock(idleMutex);
+        idleCondition.wait_for(lock, IDLE_WAIT);
+    }
+}
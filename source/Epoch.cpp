@@ -0,0 +1,199 @@
+#include <algorithm>
+#ifdef THREAD_SAFE
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <thread>
+#endif
+#include <vector>
+
+#include "include/beammeup/Epoch.h"
+
+namespace BeamMeUp {
+    struct RetiredObject {
+        void *object;
+        Epoch::Deleter deleter;
+        unsigned long long epoch;
+    };
+
+#ifdef THREAD_SAFE
+    /**
+     * The reading state of one thread. Records are never freed; a thread's record is reused by later threads
+     * once it exits.
+     */
+    struct EpochRecord {
+        // The global epoch when the thread started reading, or 0 when it isn't reading
+        std::atomic<unsigned long long> epoch;
+        std::atomic_bool inUse;
+        // Only touched by the owning thread
+        unsigned int depth;
+        EpochRecord *next;
+    };
+
+    static std::atomic<unsigned long long> globalEpoch(1);
+    static std::atomic<EpochRecord *> records(nullptr);
+    static std::mutex retiredMutex;
+
+    /**
+     * Claims a record for the calling thread and gives it back when the thread exits
+     */
+    class EpochRecordOwner {
+    public:
+        EpochRecordOwner() {
+            for (record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+                bool free = false;
+                if (record->inUse.compare_exchange_strong(free, true)) {
+                    return;
+                }
+            }
+
+            record = new EpochRecord();
+            record->epoch = 0;
+            record->inUse = true;
+            record->depth = 0;
+            record->next = records.load(std::memory_order_relaxed);
+            while (!records.compare_exchange_weak(record->next, record)) {
+            }
+        }
+
+        ~EpochRecordOwner() {
+            record->epoch.store(0, std::memory_order_release);
+            record->depth = 0;
+            record->inUse.store(false, std::memory_order_release);
+        }
+
+        EpochRecord *record;
+    };
+
+    static EpochRecord *localRecord() {
+        static thread_local EpochRecordOwner owner;
+        return owner.record;
+    }
+#else
+    static unsigned int depth = 0;
+#endif
+
+    /**
+     * @return Objects waiting to be freed. A function so it is initialized before first use.
+     */
+    static std::vector<RetiredObject> &getRetired() {
+        static std::vector<RetiredObject> retired;
+        return retired;
+    }
+
+    Epoch::Guard::Guard() {
+        Epoch::enter();
+    }
+
+    Epoch::Guard::~Guard() {
+        Epoch::leave();
+    }
+
+    void Epoch::retire(void *object, Deleter deleter) {
+#ifdef THREAD_SAFE
+        // Readers that start after this increment can't reach the object
+        unsigned long long epoch = globalEpoch.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(retiredMutex);
+            getRetired().push_back(RetiredObject{object, deleter, epoch});
+        }
+        reclaim();
+#else
+        // The only reader can be further up our own stack
+        if (depth == 0) {
+            deleter(object);
+        } else {
+            getRetired().push_back(RetiredObject{object, deleter, 0});
+        }
+#endif
+    }
+
+    void Epoch::synchronize() {
+#ifdef THREAD_SAFE
+        unsigned long long epoch = globalEpoch.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        EpochRecord *own = localRecord();
+        for (EpochRecord *record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+            if (record == own) {
+                continue;
+            }
+
+            for (;;) {
+                unsigned long long readerEpoch = record->epoch.load(std::memory_order_acquire);
+                if (readerEpoch == 0 || readerEpoch > epoch) {
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+#endif
+    }
+
+    void Epoch::reclaim() {
+        std::vector<RetiredObject> freeable;
+#ifdef THREAD_SAFE
+        // Pairs with the fence in enter: either we see the reader's epoch, or it sees the retired object unpublished
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        unsigned long long oldest = std::numeric_limits<unsigned long long>::max();
+        for (EpochRecord *record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+            unsigned long long epoch = record->epoch.load(std::memory_order_acquire);
+            if (epoch != 0) {
+                oldest = std::min(oldest, epoch);
+            }
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(retiredMutex);
+            auto &retired = getRetired();
+            // An object retired at epoch e can only be held by readers that started at or before e
+            auto it = std::partition(retired.begin(), retired.end(), [oldest](const RetiredObject &entry) {
+                return entry.epoch >= oldest;
+            });
+            freeable.assign(it, retired.end());
+            retired.erase(it, retired.end());
+        }
+#else
+        if (depth != 0) {
+            return;
+        }
+        freeable.swap(getRetired());
+#endif
+
+        for (auto &entry : freeable) {
+            entry.deleter(entry.object);
+        }
+    }
+
+    size_t Epoch::pending() {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(retiredMutex);
+#endif
+        return getRetired().size();
+    }
+
+    void Epoch::enter() {
+#ifdef THREAD_SAFE
+        EpochRecord *record = localRecord();
+        if (record->depth++ == 0) {
+            record->epoch.store(globalEpoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+#else
+        depth++;
+#endif
+    }
+
+    void Epoch::leave() {
+#ifdef THREAD_SAFE
+        EpochRecord *record = localRecord();
+        if (--record->depth == 0) {
+            record->epoch.store(0, std::memory_order_release);
+        }
+#else
+        if (--depth == 0 && !getRetired().empty()) {
+            reclaim();
+        }
+#endif
+    }
+}
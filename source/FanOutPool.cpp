@@ -0,0 +1,56 @@
+#include "include/beammeup/FanOutPool.h"
+
+namespace BeamMeUp {
+    FanOutPool::FanOutPool(unsigned int threads) {
+        if (threads == 0) {
+            threads = 1;
+        }
+
+        for (unsigned int i = 0; i < threads; ++i) {
+            std::unique_ptr<Worker> worker(new Worker());
+            worker->stopping = false;
+            worker->thread = std::thread(&FanOutPool::run, worker.get());
+            workers.push_back(std::move(worker));
+        }
+    }
+
+    FanOutPool::~FanOutPool() {
+        for (auto &worker : workers) {
+            std::unique_lock<std::mutex> lock(worker->mutex);
+            worker->stopping = true;
+            worker->condition.notify_one();
+        }
+        for (auto &worker : workers) {
+            worker->thread.join();
+        }
+    }
+
+    unsigned int FanOutPool::getThreads() const {
+        return static_cast<unsigned int>(workers.size());
+    }
+
+    void FanOutPool::submit(unsigned int worker, Task &&task) {
+        Worker &target = *workers[worker];
+        std::unique_lock<std::mutex> lock(target.mutex);
+        target.tasks.push_back(std::move(task));
+        target.condition.notify_one();
+    }
+
+    void FanOutPool::run(Worker *worker) {
+        std::unique_lock<std::mutex> lock(worker->mutex);
+        while (true) {
+            worker->condition.wait(lock, [worker]() {
+                return worker->stopping || !worker->tasks.empty();
+            });
+            if (worker->tasks.empty()) {
+                return;
+            }
+
+            Task task = std::move(worker->tasks.front());
+            worker->tasks.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#include <stdexcept>
+
+#include "include/beammeup/HandleTable.h"
+
+namespace BeamMeUp {
+    const unsigned int HandleTable::CHUNK_BITS = 10;
+    const unsigned int HandleTable::MAX_CHUNKS = 4096;
+    const unsigned int HandleTable::NO_SLOT = 0xFFFFFFFF;
+
+    HandleTable::HandleTable() : slotCount(0), freeSlot(NO_SLOT), used(0) {
+        chunks = new std::atomic<Slot *>[MAX_CHUNKS];
+        for (unsigned int i = 0; i < MAX_CHUNKS; ++i) {
+            chunks[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    HandleTable::~HandleTable() {
+        for (unsigned int i = 0; i < MAX_CHUNKS; ++i) {
+            delete[] chunks[i].load(std::memory_order_relaxed);
+        }
+        delete[] chunks;
+    }
+
+    ReceiverHandle HandleTable::add(Receiver *receiver) {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(mutex);
+#endif
+        unsigned int index = freeSlot;
+        Slot *slot;
+        if (index != NO_SLOT) {
+            slot = getSlot(index);
+            freeSlot = slot->nextFree;
+        } else {
+            index = slotCount;
+            unsigned int chunk = index >> CHUNK_BITS;
+            if (chunk >= MAX_CHUNKS) {
+                throw std::runtime_error("Too many receivers");
+            }
+            if ((index & ((1u << CHUNK_BITS) - 1)) == 0) {
+                Slot *slots = new Slot[1u << CHUNK_BITS];
+                for (unsigned int i = 0; i < (1u << CHUNK_BITS); ++i) {
+                    slots[i].generation.store(0, std::memory_order_relaxed);
+                    slots[i].receiver.store(nullptr, std::memory_order_relaxed);
+                }
+                chunks[chunk].store(slots, std::memory_order_release);
+            }
+            slotCount++;
+            slot = getSlot(index);
+        }
+
+        unsigned int generation = slot->generation.load(std::memory_order_relaxed) + 1;
+        slot->receiver.store(receiver, std::memory_order_relaxed);
+        slot->generation.store(generation, std::memory_order_release);
+        used++;
+
+        return (static_cast<ReceiverHandle>(generation) << 32) | index;
+    }
+
+    void HandleTable::remove(ReceiverHandle handle) {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(mutex);
+#endif
+        unsigned int index = static_cast<unsigned int>(handle);
+        Slot *slot = getSlot(index);
+        if (slot == nullptr ||
+            slot->generation.load(std::memory_order_relaxed) != static_cast<unsigned int>(handle >> 32)) {
+            return;
+        }
+
+        slot->generation.store(slot->generation.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        slot->receiver.store(nullptr, std::memory_order_relaxed);
+        slot->nextFree = freeSlot;
+        freeSlot = index;
+        used--;
+    }
+
+    bool HandleTable::isValid(ReceiverHandle handle) const {
+        Slot *slot = getSlot(static_cast<unsigned int>(handle));
+        return slot != nullptr &&
+               slot->generation.load(std::memory_order_acquire) == static_cast<unsigned int>(handle >> 32);
+    }
+
+    Receiver *HandleTable::get(ReceiverHandle handle) const {
+        Slot *slot = getSlot(static_cast<unsigned int>(handle));
+        if (slot == nullptr) {
+            return nullptr;
+        }
+
+        Receiver *receiver = slot->receiver.load(std::memory_order_relaxed);
+        // Re-check the generation so that a receiver read from a reused slot isn't returned
+        if (slot->generation.load(std::memory_order_acquire) != static_cast<unsigned int>(handle >> 32)) {
+            return nullptr;
+        }
+        return receiver;
+    }
+
+    size_t HandleTable::size() const {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(mutex);
+#endif
+        return used;
+    }
+
+    HandleTable::Slot *HandleTable::getSlot(unsigned int index) const {
+        unsigned int chunk = index >> CHUNK_BITS;
+        if (chunk >= MAX_CHUNKS) {
+            return nullptr;
+        }
+
+        Slot *slots = chunks[chunk].load(std::memory_order_acquire);
+        if (slots == nullptr) {
+            return nullptr;
+        }
+        return &slots[index & ((1u << CHUNK_BITS) - 1)];
+    }
+}
@@ -0,0 +1,256 @@
+#ifndef _WIN32
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "include/beammeup/Journal.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Variant.h"
+#include "include/beammeup/VariantCodec.h"
+
+namespace BeamMeUp {
+    const size_t Journal::DEFAULT_SEGMENT_SIZE = 64 * 1024 * 1024;
+    const unsigned int Journal::SEGMENT_MAGIC = 0x4a4d5542;
+    const size_t Journal::SEGMENT_HEADER_SIZE = 64;
+
+    static const char *SEGMENT_EXTENSION = ".journal";
+
+    /**
+     * Notifies itself when the interval sync is due, so the sync comes from processing the transporter
+     */
+    class Journal::SyncTimer : public Signaler, public Receiver {
+    public:
+        SyncTimer(Transporter *transporter, Journal *journal) :
+                Signaler(transporter), Receiver(transporter), journal(journal) {
+            connect(0, this);
+        }
+
+    protected:
+        void processMessage(const Signal, const Variant &) override {
+            journal->syncScheduled();
+        }
+
+    private:
+        Journal *journal;
+    };
+
+    static inline size_t recordSize(size_t length) {
+        return sizeof(Journal::RecordHeader) + ((length + 7) & ~static_cast<size_t>(7));
+    }
+
+    /**
+     * @param name A file name
+     * @return The segment number, or 0 if it isn't a segment
+     */
+    static unsigned long long segmentNumber(const std::string &name) {
+        size_t extension = strlen(SEGMENT_EXTENSION);
+        if (name.size() <= extension || name.compare(name.size() - extension, extension, SEGMENT_EXTENSION) != 0 ||
+            !std::all_of(name.begin(), name.end() - extension, [](char c) { return c >= '0' && c <= '9'; })) {
+            return 0;
+        }
+        return std::stoull(name.substr(0, name.size() - extension));
+    }
+
+    Journal::Journal(Transporter *transporter, const std::string &directory, JournalSync sync,
+                     std::chrono::milliseconds syncInterval, size_t segmentSize) :
+            Receiver(transporter), directory(directory), syncPolicy(sync), syncInterval(syncInterval),
+            syncPending(false), segmentSize(segmentSize), nextSegment(1), segmentCount(0), descriptor(-1),
+            mapping(nullptr), offset(0), synced(0), recorded(0), dropped(0) {
+        if (sync == JS_INTERVAL) {
+            syncTimer.reset(new SyncTimer(transporter, this));
+        }
+        mkdir(directory.c_str(), 0755);
+        std::vector<std::string> existing = listSegments(directory);
+        if (!existing.empty()) {
+            std::string last = existing.back().substr(existing.back().find_last_of('/') + 1);
+            nextSegment = segmentNumber(last) + 1;
+        }
+        if (!openSegment()) {
+            throw std::runtime_error("Can't create a journal segment in " + directory + ": " + strerror(errno));
+        }
+    }
+
+    Journal::~Journal() {
+        // Nothing may be appending once the segment is unmapped
+        detach();
+        // Waits for a sync that is under way, and cancels any still to come
+        syncTimer.reset();
+#ifdef THREAD_SAFE
+        // In case sync is being called on another thread
+        std::lock_guard<std::mutex> lock(mutex);
+#endif
+        closeSegment();
+    }
+
+    void Journal::sync() {
+#ifdef THREAD_SAFE
+        std::lock_guard<std::mutex> lock(mutex);
+#endif
+        syncSegment();
+    }
+
+    bool Journal::isSynced() {
+#ifdef THREAD_SAFE
+        std::lock_guard<std::mutex> lock(mutex);
+#endif
+        return mapping == nullptr || synced == offset;
+    }
+
+    void Journal::syncSegment() {
+        if (mapping == nullptr || synced == offset) {
+            return;
+        }
+        // msync wants a page aligned start
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t start = synced & ~(page - 1);
+        msync(mapping + start, offset - start, MS_SYNC);
+        synced = offset;
+    }
+
+    unsigned long long Journal::getRecorded() const {
+        return recorded;
+    }
+
+    unsigned long long Journal::getDropped() const {
+        return dropped;
+    }
+
+    unsigned int Journal::getSegmentCount() const {
+        return segmentCount;
+    }
+
+    std::vector<std::string> Journal::listSegments(const std::string &directory) {
+        std::vector<std::pair<unsigned long long, std::string>> found;
+        DIR *listing = opendir(directory.c_str());
+        if (listing != nullptr) {
+            while (dirent *entry = readdir(listing)) {
+                unsigned long long number = segmentNumber(entry->d_name);
+                if (number != 0) {
+                    found.emplace_back(number, directory + "/" + entry->d_name);
+                }
+            }
+            closedir(listing);
+        }
+        std::sort(found.begin(), found.end());
+
+        std::vector<std::string> segments;
+        for (auto &segment : found) {
+            segments.push_back(segment.second);
+        }
+        return segments;
+    }
+
+    void Journal::syncScheduled() {
+#ifdef THREAD_SAFE
+        std::lock_guard<std::mutex> lock(mutex);
+#endif
+        syncPending = false;
+        syncSegment();
+    }
+
+    void Journal::processMessage(const Signal signal, const Variant &message) {
+        size_t length = VariantCodec::size(message);
+        size_t size = recordSize(length);
+#ifdef THREAD_SAFE
+        std::lock_guard<std::mutex> lock(mutex);
+#endif
+        if (SEGMENT_HEADER_SIZE + size > segmentSize) {
+            dropped++;
+            return;
+        }
+        if (mapping == nullptr || offset + size > segmentSize) {
+            if (!openSegment()) {
+                dropped++;
+                return;
+            }
+        }
+
+        auto header = reinterpret_cast<RecordHeader *>(mapping + offset);
+        VariantCodec::encode(message, mapping + offset + sizeof(RecordHeader));
+        header->signal = signal;
+        header->time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        header->length.store(static_cast<unsigned int>(length), std::memory_order_release);
+        offset += size;
+        recorded++;
+
+        if (syncPolicy == JS_EVERY) {
+            syncSegment();
+        } else if (syncPolicy == JS_INTERVAL && !syncPending) {
+            // Scheduled rather than checked here, so a burst followed by silence is still synced
+            syncPending = true;
+            if (syncTimer->notifyAfter(0, Variant(), syncInterval) == 0) {
+                // There's no transporter to time it
+                syncPending = false;
+                syncSegment();
+            }
+        }
+    }
+
+    bool Journal::openSegment() {
+        closeSegment();
+
+        char name[32];
+        snprintf(name, sizeof(name), "%020llu", nextSegment++);
+        std::string path = directory + "/" + name + SEGMENT_EXTENSION;
+        descriptor = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (descriptor == -1) {
+            return false;
+        }
+        // Allocate the blocks up front, so running out of space fails here rather than with SIGBUS on a write
+#if defined(__linux__)
+        int result = posix_fallocate(descriptor, 0, static_cast<off_t>(segmentSize));
+        if (result != 0) {
+            errno = result;
+        }
+        bool sized = result == 0;
+#else
+        bool sized = ftruncate(descriptor, static_cast<off_t>(segmentSize)) == 0;
+#endif
+        // Fault the pages in now rather than one by one on the notify path
+#if defined(MAP_POPULATE)
+        int flags = MAP_SHARED | MAP_POPULATE;
+#else
+        int flags = MAP_SHARED;
+#endif
+        void *mapped = sized ? mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, flags, descriptor, 0) : MAP_FAILED;
+        if (mapped == MAP_FAILED) {
+            close(descriptor);
+            unlink(path.c_str());
+            descriptor = -1;
+            return false;
+        }
+
+        mapping = static_cast<char *>(mapped);
+        memcpy(mapping, &SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+        offset = SEGMENT_HEADER_SIZE;
+        synced = 0;
+        segmentCount++;
+        return true;
+    }
+
+    void Journal::closeSegment() {
+        if (mapping == nullptr) {
+            return;
+        }
+        if (syncPolicy != JS_NONE) {
+            syncSegment();
+        }
+        munmap(mapping, segmentSize);
+        // Give back the space that wasn't used; the end of the file ends the segment as well as a 0 length does
+        if (ftruncate(descriptor, static_cast<off_t>(offset)) == 0 && syncPolicy != JS_NONE) {
+            fsync(descriptor);
+        }
+        close(descriptor);
+        mapping = nullptr;
+        descriptor = -1;
+    }
+}
+#endif
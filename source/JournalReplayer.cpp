@@ -0,0 +1,136 @@
+#ifndef _WIN32
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "include/beammeup/JournalReplayer.h"
+#include "include/beammeup/Variant.h"
+#include "include/beammeup/VariantCodec.h"
+
+namespace BeamMeUp {
+    JournalReplayer::JournalReplayer(Transporter *transporter, const std::string &directory) :
+            Signaler(transporter), segments(Journal::listSegments(directory)), nextSegment(0), mapping(nullptr),
+            mappedSize(0), offset(0), started(false), firstTime(0) {
+    }
+
+    JournalReplayer::~JournalReplayer() {
+        closeSegment();
+    }
+
+    bool JournalReplayer::next(Signal &signal, Variant &message, std::chrono::system_clock::time_point &time) {
+        while (findRecord()) {
+            const Journal::RecordHeader &record = getRecord();
+            const char *data = mapping + offset + sizeof(Journal::RecordHeader);
+            // findRecord has loaded the length with acquire ordering
+            unsigned int length = record.length.load(std::memory_order_relaxed);
+            const char *end = data + length;
+            bool decoded = VariantCodec::decode(data, end, message) && data == end;
+            signal = record.signal;
+            time = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    std::chrono::nanoseconds(record.time)));
+            offset += sizeof(Journal::RecordHeader) + ((length + 7) & ~7u);
+            if (decoded) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    unsigned int JournalReplayer::replay(JournalPace pace, unsigned int maxMessages) {
+        unsigned int count = 0;
+        Signal signal;
+        Variant message;
+        std::chrono::system_clock::time_point time;
+        while (maxMessages == 0 || count < maxMessages) {
+            if (pace == JP_ORIGINAL) {
+                // The first call to getNextDue starts the clock, so it must come before reading the time
+                auto due = getNextDue();
+                if (due > std::chrono::steady_clock::now()) {
+                    break;
+                }
+            }
+            if (!next(signal, message, time)) {
+                break;
+            }
+            notify(signal, message);
+            count++;
+        }
+        return count;
+    }
+
+    std::chrono::steady_clock::time_point JournalReplayer::getNextDue() {
+        if (!findRecord()) {
+            return std::chrono::steady_clock::time_point::max();
+        }
+        if (!started) {
+            started = true;
+            firstTime = getRecord().time;
+            firstReplayed = std::chrono::steady_clock::now();
+        }
+        return firstReplayed + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::nanoseconds(getRecord().time - firstTime));
+    }
+
+    bool JournalReplayer::isFinished() {
+        return !findRecord();
+    }
+
+    bool JournalReplayer::findRecord() {
+        for (;;) {
+            if (mapping != nullptr && offset + sizeof(Journal::RecordHeader) <= mappedSize) {
+                // A 0 length is the unwritten end of the segment; a length past the end is damage
+                unsigned int length = getRecord().length.load(std::memory_order_acquire);
+                if (length != 0 && length <= mappedSize - offset - sizeof(Journal::RecordHeader)) {
+                    return true;
+                }
+            }
+            if (!openSegment()) {
+                return false;
+            }
+        }
+    }
+
+    bool JournalReplayer::openSegment() {
+        closeSegment();
+        while (nextSegment < segments.size()) {
+            int descriptor = open(segments[nextSegment++].c_str(), O_RDONLY | O_CLOEXEC);
+            if (descriptor == -1) {
+                continue;
+            }
+            struct stat status;
+            void *mapped = MAP_FAILED;
+            if (fstat(descriptor, &status) == 0 && static_cast<size_t>(status.st_size) > Journal::SEGMENT_HEADER_SIZE) {
+                mappedSize = static_cast<size_t>(status.st_size);
+                mapped = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, descriptor, 0);
+            }
+            close(descriptor);
+            if (mapped == MAP_FAILED) {
+                continue;
+            }
+
+            mapping = static_cast<char *>(mapped);
+            if (memcmp(mapping, &Journal::SEGMENT_MAGIC, sizeof(Journal::SEGMENT_MAGIC)) != 0) {
+                closeSegment();
+                continue;
+            }
+            madvise(mapping, mappedSize, MADV_SEQUENTIAL);
+            offset = Journal::SEGMENT_HEADER_SIZE;
+            return true;
+        }
+        return false;
+    }
+
+    void JournalReplayer::closeSegment() {
+        if (mapping != nullptr) {
+            munmap(mapping, mappedSize);
+            mapping = nullptr;
+        }
+    }
+
+    const Journal::RecordHeader &JournalReplayer::getRecord() const {
+        return *reinterpret_cast<const Journal::RecordHeader *>(mapping + offset);
+    }
+}
+#endif
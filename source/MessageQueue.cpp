@@ -0,0 +1,141 @@
+#include <algorithm>
+
+#include "include/beammeup/Affinity.h"
+#include "include/beammeup/MessageQueue.h"
+
+namespace BeamMeUp {
+    const size_t MessageQueue::MIN_BLOCK_SIZE = 16;
+    const size_t MessageQueue::MAX_BLOCK_SIZE = 1024;
+
+    MessageQueue::MessageQueue() : head(nullptr), tail(nullptr), freeNodes(nullptr), count(0), allocated(0), node(-1) {
+    }
+
+    void MessageQueue::push(Signal signal, const Variant &message, RequestId request) {
+        if (freeNodes == nullptr) {
+            // Grow geometrically so a burst costs a handful of allocations rather than one per message
+            grow(std::min(std::max(allocated, MIN_BLOCK_SIZE), MAX_BLOCK_SIZE));
+        }
+
+        Node *node = freeNodes;
+        freeNodes = node->next;
+
+        node->signal = signal;
+        node->message = message;
+        node->request = request;
+        node->next = nullptr;
+
+        if (tail == nullptr) {
+            head = node;
+        } else {
+            tail->next = node;
+        }
+        tail = node;
+        count++;
+    }
+
+    void MessageQueue::push(Signal signal, Variant &&message) {
+        static const Variant empty;
+        push(signal, empty);
+        tail->message.swap(message);
+    }
+
+    void MessageQueue::push(Signal signal, const std::shared_ptr<const Variant> &message) {
+        push(signal, Variant());
+        tail->shared = message;
+    }
+
+    bool MessageQueue::pop(Signal &signal, Variant &message) {
+        RequestId request;
+        return pop(signal, message, request);
+    }
+
+    bool MessageQueue::pop(Signal &signal, Variant &message, RequestId &request) {
+        std::shared_ptr<const Variant> shared;
+        if (!pop(signal, message, request, shared)) {
+            return false;
+        }
+
+        if (shared != nullptr) {
+            message = *shared;
+        }
+        return true;
+    }
+
+    bool MessageQueue::pop(Signal &signal, Variant &message, RequestId &request,
+                           std::shared_ptr<const Variant> &shared) {
+        if (head == nullptr) {
+            return false;
+        }
+
+        Node *node = head;
+        head = node->next;
+        if (head == nullptr) {
+            tail = nullptr;
+        }
+        count--;
+
+        signal = node->signal;
+        request = node->request;
+        message.swap(node->message);
+        // Moved out so the payload is released as soon as its last receiver is done with it
+        shared = std::move(node->shared);
+
+        node->next = freeNodes;
+        freeNodes = node;
+
+        return true;
+    }
+
+    void MessageQueue::forEach(const std::function<void(Signal signal, const Variant &message)> &visit) const {
+        for (Node *node = head; node != nullptr; node = node->next) {
+            visit(node->signal, node->shared != nullptr ? *node->shared : node->message);
+        }
+    }
+
+    bool MessageQueue::empty() const {
+        return head == nullptr;
+    }
+
+    size_t MessageQueue::size() const {
+        return count;
+    }
+
+    size_t MessageQueue::capacity() const {
+        return allocated;
+    }
+
+    void MessageQueue::reserve(size_t messages) {
+        if (allocated < messages) {
+            grow(messages - allocated);
+        }
+    }
+
+    void MessageQueue::setNode(int node) {
+        this->node = node;
+    }
+
+    int MessageQueue::getNode() const {
+        return node;
+    }
+
+    void MessageQueue::grow(size_t nodes) {
+        Node *block = static_cast<Node *>(Affinity::allocate(nodes * sizeof(Node), node));
+        blocks.push_back({block, nodes, node});
+        allocated += nodes;
+
+        for (size_t i = 0; i < nodes; ++i) {
+            new(&block[i]) Node();
+            block[i].next = freeNodes;
+            freeNodes = &block[i];
+        }
+    }
+
+    MessageQueue::~MessageQueue() {
+        for (auto &block : blocks) {
+            for (size_t i = 0; i < block.size; ++i) {
+                block.nodes[i].~Node();
+            }
+            Affinity::deallocate(block.nodes, block.size * sizeof(Node), block.node);
+        }
+    }
+}
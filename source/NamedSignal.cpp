@@ -0,0 +1,68 @@
+#ifdef THREAD_SAFE
+#include <mutex>
+#endif
+#include <stdexcept>
+#include <unordered_map>
+
+#include "include/beammeup/NamedSignal.h"
+
+namespace BeamMeUp {
+    /**
+     * The registry's state, built on first use so it can be used during static initialization
+     */
+    struct SignalNames {
+        std::unordered_map<Signal, std::string> names;
+#ifdef THREAD_SAFE
+        std::mutex mutex;
+#endif
+    };
+
+    static SignalNames &getSignalNames() {
+        static SignalNames names;
+        return names;
+    }
+
+    Signal SignalRegistry::add(const std::string &name) {
+        Signal signal = signalHash(name.data(), name.size());
+        SignalNames &registry = getSignalNames();
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(registry.mutex);
+#endif
+        auto result = registry.names.emplace(signal, name);
+        if (!result.second && result.first->second != name) {
+            throw std::runtime_error("Signal name '" + name + "' collides with '" + result.first->second + "'");
+        }
+
+        return signal;
+    }
+
+    Signal SignalRegistry::add(const NamedSignal &signal) {
+        return add(std::string(signal.getName()));
+    }
+
+    std::string SignalRegistry::getName(Signal signal) {
+        SignalNames &registry = getSignalNames();
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(registry.mutex);
+#endif
+        auto it = registry.names.find(signal);
+        return it == registry.names.end() ? std::string() : it->second;
+    }
+
+    std::string SignalRegistry::describe(Signal signal) {
+        std::string name = getName(signal);
+        return name.empty() ? std::to_string(signal) : name;
+    }
+
+    size_t SignalRegistry::size() {
+        SignalNames &registry = getSignalNames();
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(registry.mutex);
+#endif
+        return registry.names.size();
+    }
+
+    SignalRegistration::SignalRegistration(const NamedSignal &signal) {
+        SignalRegistry::add(signal);
+    }
+}
@@ -1,8 +1,46 @@
+#include <algorithm>
+#ifdef THREAD_SAFE
+#include <thread>
+#endif
+
+#include "include/beammeup/Epoch.h"
 #include "include/beammeup/Receiver.h"
 #include "include/beammeup/Transporter.h"
 
 namespace BeamMeUp {
-    Receiver::Receiver(Transporter *transporter) : transporter(transporter) {
+    thread_local RequestId Receiver::currentRequest = 0;
+
+#ifdef BEAMMEUP_COROUTINES
+    /**
+     * Timer that ends a coroutine's wait for a message
+     */
+    class AwaiterTimer : public TimerWheel::Timer {
+    public:
+        AwaiterTimer(Receiver *receiver, Signal signal, MessageAwaiter *awaiter) :
+                receiver(receiver), signal(signal), awaiter(awaiter) {
+        }
+
+        void expire() override {
+            receiver->expireAwaiter(signal, awaiter, getId());
+        }
+
+        Receiver *receiver;
+        Signal signal;
+        MessageAwaiter *awaiter;
+    };
+#endif
+
+    Receiver::Receiver(Transporter *transporter) :
+            transporter(transporter), handle(0), detached(false), processing(false), ready(false) {
+#ifdef BEAMMEUP_COROUTINES
+        awaiting = 0;
+#endif
+#ifdef THREAD_SAFE
+        affinity = -1;
+        processingTime = 0;
+        channelsChanged = false;
+        nextSource = 0;
+#endif
         if (transporter != nullptr) {
             transporter->registerObject(this);
         }
@@ -12,53 +50,592 @@ namespace BeamMeUp {
 #ifdef THREAD_SAFE
         std::unique_lock<std::shared_timed_mutex> lock(mutex);
 #endif
-        messageQueue.push(std::pair<Signal, Variant>(signal, message));
+        messageQueue.push(signal, message);
+
+        if (transporter != nullptr) {
+            transporter->messagesQueued(1);
+            markReady();
+        }
     }
 
-    int Receiver::processMessages() {
+    void Receiver::receiveMessages(Signal signal, const VariantVector &messages) {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+#endif
+        for (auto &message : messages) {
+            messageQueue.push(signal, message);
+        }
+
+        if (transporter != nullptr) {
+            transporter->messagesQueued(messages.size());
+            markReady();
+        }
+    }
+
+    void Receiver::receiveRequest(Signal signal, const Variant &message, RequestId request) {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+#endif
+        messageQueue.push(signal, message, request);
+
+        if (transporter != nullptr) {
+            transporter->messagesQueued(1);
+            markReady();
+        }
+    }
+
+#ifdef THREAD_SAFE
+    void Receiver::receiveShared(Signal signal, const std::shared_ptr<const Variant> &message) {
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+        messageQueue.push(signal, message);
+
+        if (transporter != nullptr) {
+            transporter->messagesQueued(1);
+            markReady();
+        }
+    }
+#endif
+
+    int Receiver::processMessages(unsigned int maxMessages, const std::chrono::steady_clock::time_point &deadline) {
+        if (!claim()) {
+            return 0;
+        }
+
+        int count;
+        try {
+            count = processClaimed(maxMessages, deadline);
+        } catch (...) {
+            release();
+            throw;
+        }
+        release();
+
+        return count;
+    }
+
+    int Receiver::processClaimed(unsigned int maxMessages, const std::chrono::steady_clock::time_point &deadline) {
         int count = 0;
+        bool checkDeadline = deadline != std::chrono::steady_clock::time_point::max();
 
-        while (true) {
-            {
 #ifdef THREAD_SAFE
-                std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        // Channels only support one consumer. If another thread is already draining them, leave them to it.
+        std::unique_lock<std::mutex> consumerLock(channelConsumerMutex, std::try_to_lock);
+        bool useChannels = consumerLock.owns_lock();
+        if (useChannels && channelsChanged) {
+            updateChannels();
+        }
+#else
+        bool useChannels = false;
 #endif
-                if (messageQueue.empty()) {
-                    return count;
+
+        while (maxMessages == 0 || static_cast<unsigned int>(count) < maxMessages) {
+            Signal signal;
+            Variant message;
+            RequestId request;
+            std::shared_ptr<const Variant> shared;
+            if (!popMessage(signal, message, request, shared, useChannels)) {
+                return count;
+            }
+
+            // Saved and restored in case processMessage processes another receiver's messages
+            RequestId previousRequest = currentRequest;
+            currentRequest = request;
+#ifdef BEAMMEUP_COROUTINES
+            // Coroutines waiting on the signal take the message ahead of processMessage. They keep it, so it can't
+            // stay shared.
+            if (awaiting != 0 && shared != nullptr) {
+                message = *shared;
+                shared.reset();
+            }
+            if (awaiting == 0 || !resumeAwaiter(signal, message)) {
+                processMessage(signal, shared != nullptr ? *shared : message);
+            }
+#else
+            processMessage(signal, shared != nullptr ? *shared : message);
+#endif
+            currentRequest = previousRequest;
+            count++;
+
+            if (checkDeadline && std::chrono::steady_clock::now() >= deadline) {
+                return count;
+            }
+        }
+
+        return count;
+    }
+
+    bool Receiver::claimDirect() {
+#ifdef BEAMMEUP_COROUTINES
+        // Waiting coroutines take their messages from the queue
+        if (awaiting != 0) {
+            return false;
+        }
+#endif
+        // Fails if another thread is processing us, or if we're notifying ourselves from processMessage, which would
+        // otherwise recurse
+        return claim();
+    }
+
+    void Receiver::processDirect(Signal signal, const Variant &message) {
+        RequestId previousRequest = currentRequest;
+        currentRequest = 0;
+        try {
+            processMessage(signal, message);
+        } catch (...) {
+            currentRequest = previousRequest;
+            throw;
+        }
+        currentRequest = previousRequest;
+    }
+
+    bool Receiver::claim() {
+#ifdef THREAD_SAFE
+        // Acquire and release order successive processMessage calls, even on different threads
+        return !processing.exchange(true, std::memory_order_acquire);
+#else
+        if (processing) {
+            return false;
+        }
+        processing = true;
+        return true;
+#endif
+    }
+
+    void Receiver::release() {
+#ifdef THREAD_SAFE
+        processing.store(false, std::memory_order_release);
+#else
+        processing = false;
+#endif
+    }
+
+    void Receiver::markReady() {
+#ifdef THREAD_SAFE
+        // Pairs with the fence in rearm: either it sees our message, or we see the flag it cleared
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ready.load(std::memory_order_relaxed) || ready.exchange(true)) {
+            return;
+        }
+#else
+        if (ready) {
+            return;
+        }
+        ready = true;
+#endif
+        transporter->receiverReady(this);
+    }
+
+    bool Receiver::rearm() {
+#ifdef THREAD_SAFE
+        ready.store(false, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!hasMessages()) {
+            return false;
+        }
+        // A sender may have put us back on the list since we cleared the flag
+        return !ready.exchange(true);
+#else
+        ready = hasMessages();
+        return ready;
+#endif
+    }
+
+    void Receiver::addIncoming(const std::shared_ptr<SignalerLink> &link, Signal signal, bool subscription) {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(incomingMutex);
+#endif
+        incoming.push_back({link, signal, subscription});
+    }
+
+    void Receiver::removeIncoming(const SignalerLink *link, Signal signal, bool subscription) {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(incomingMutex);
+#endif
+        for (auto it = incoming.begin(); it != incoming.end(); ++it) {
+            if (it->link.get() == link && it->signal == signal && it->subscription == subscription) {
+                // Order doesn't matter, so fill the gap from the back
+                *it = std::move(incoming.back());
+                incoming.pop_back();
+                return;
+            }
+        }
+    }
+
+    std::vector<Signal> Receiver::getIncoming(const SignalerLink *link) const {
+        std::vector<Signal> signals;
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(incomingMutex);
+#endif
+        for (auto &connection : incoming) {
+            if (connection.link.get() == link && !connection.subscription) {
+                signals.push_back(connection.signal);
+            }
+        }
+
+        return signals;
+    }
+
+    size_t Receiver::getIncomingCount() const {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(incomingMutex);
+#endif
+        return incoming.size();
+    }
+
+    bool Receiver::hasMessages() {
+#ifdef THREAD_SAFE
+        {
+            std::unique_lock<std::mutex> lock(channelMutex);
+            for (auto &channel : channels) {
+                if (!channel->empty()) {
+                    return true;
                 }
             }
+            for (auto &channel : addedChannels) {
+                if (!channel->empty()) {
+                    return true;
+                }
+            }
+        }
 
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+#endif
+        return !messageQueue.empty();
+    }
+
+    void Receiver::reserveMessages(size_t messages) {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+#endif
+        messageQueue.reserve(messages);
+    }
+
+    void Receiver::forEachQueued(const std::function<void(Signal signal, const Variant &message)> &visit) {
+#ifdef THREAD_SAFE
+        {
+            std::unique_lock<std::mutex> consumerLock(channelConsumerMutex);
+            if (channelsChanged) {
+                updateChannels();
+            }
+            // The messages stay queued, so the transporter's count doesn't change
             Signal signal;
             Variant message;
-            bool hasMessage = false;
-            {
+            for (auto &channel : channels) {
+                while (channel->pop(signal, message)) {
+                    std::unique_lock<std::shared_timed_mutex> lock(mutex);
+                    messageQueue.push(signal, message);
+                }
+            }
+        }
+
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+#endif
+        messageQueue.forEach(visit);
+    }
+
+    size_t Receiver::receiveRestored(size_t count, const std::function<bool(Signal &signal, Variant &message)> &next) {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+#endif
+        messageQueue.reserve(messageQueue.size() + count);
+        size_t restored = 0;
+        Signal signal;
+        Variant message;
+        while (next(signal, message)) {
+            messageQueue.push(signal, std::move(message));
+            restored++;
+        }
+
+        if (transporter != nullptr && restored > 0) {
+            transporter->messagesQueued(restored);
+            markReady();
+        }
+        return restored;
+    }
+
+    bool Receiver::popMessage(Signal &signal, Variant &message, RequestId &request,
+                              std::shared_ptr<const Variant> &shared, bool useChannels) {
 #ifdef THREAD_SAFE
+        size_t sources = useChannels ? channels.size() + 1 : 1;
+
+        for (size_t i = 0; i < sources; ++i) {
+            size_t source = nextSource++ % sources;
+            bool popped;
+            if (source == 0) {
                 std::unique_lock<std::shared_timed_mutex> lock(mutex);
+                popped = messageQueue.pop(signal, message, request, shared);
+            } else {
+                popped = channels[source - 1]->pop(signal, message);
+                request = 0;
+                shared.reset();
+            }
+
+            if (popped) {
+                if (transporter != nullptr) {
+                    transporter->messagesDequeued(1);
+                }
+                return true;
+            }
+        }
+
+        return false;
+#else
+        // Channels only exist in the thread safe build
+        (void)useChannels;
+        if (!messageQueue.pop(signal, message, request, shared)) {
+            return false;
+        }
+
+        if (transporter != nullptr) {
+            transporter->messagesDequeued(1);
+        }
+        return true;
+#endif
+    }
+
+#ifdef BEAMMEUP_COROUTINES
+    MessageAwaiter Receiver::next(Signal signal, std::chrono::steady_clock::duration timeout) {
+        return MessageAwaiter(this, signal, timeout);
+    }
+
+    void Receiver::addAwaiter(MessageAwaiter *awaiter) {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+#endif
+        awaiters[awaiter->signal].push_back(awaiter);
+        awaiting++;
+
+        // Scheduled with the lock held so the coroutine can't be resumed (and the awaiter freed) before the timer's
+        // id is stored
+        if (transporter != nullptr && awaiter->timeout != std::chrono::steady_clock::duration::max()) {
+            awaiter->timer = transporter->addTimer(new AwaiterTimer(this, awaiter->signal, awaiter),
+                                                   std::chrono::steady_clock::now() + awaiter->timeout,
+                                                   std::chrono::steady_clock::duration::zero());
+        }
+    }
+
+    bool Receiver::resumeAwaiter(Signal signal, Variant &message) {
+        MessageAwaiter *awaiter = nullptr;
+        {
+#ifdef THREAD_SAFE
+            std::unique_lock<std::shared_timed_mutex> lock(mutex);
 #endif
-                if (!messageQueue.empty()) {
-                    auto data = messageQueue.front();
-                    messageQueue.pop();
-                    signal = data.first;
-                    message = data.second;
-                    hasMessage = true;
+            auto it = awaiters.find(signal);
+            if (it != awaiters.end()) {
+                awaiter = it->second.front();
+                it->second.pop_front();
+                if (it->second.empty()) {
+                    awaiters.erase(it);
                 }
+                awaiting--;
             }
+        }
+
+        if (awaiter == nullptr) {
+            return false;
+        }
+
+        if (awaiter->timer != 0) {
+            transporter->unscheduleTimer(awaiter->timer);
+        }
+        awaiter->message.emplace();
+        awaiter->message->swap(message);
+        awaiter->resume();
+
+        return true;
+    }
 
-            if (hasMessage) {
-                processMessage(signal, message);
-                count++;
+    void Receiver::expireAwaiter(Signal signal, MessageAwaiter *awaiter, TimerId timer) {
+        {
+#ifdef THREAD_SAFE
+            std::unique_lock<std::shared_timed_mutex> lock(mutex);
+#endif
+            // A message may have beaten the timer, in which case the awaiter may even have been freed and its address
+            // reused, hence the check of the timer id
+            auto signalAwaiters = awaiters.find(signal);
+            if (signalAwaiters == awaiters.end()) {
+                return;
+            }
+            auto &list = signalAwaiters->second;
+            auto it = std::find(list.begin(), list.end(), awaiter);
+            if (it == list.end() || (*it)->timer != timer) {
+                return;
+            }
+            // Resuming the coroutine counts as processing us. If another thread is, try again shortly.
+            if (!claim()) {
+                awaiter->timer = transporter->addTimer(new AwaiterTimer(this, signal, awaiter),
+                                                       std::chrono::steady_clock::now() + std::chrono::milliseconds(1),
+                                                       std::chrono::steady_clock::duration::zero());
+                return;
             }
+            list.erase(it);
+            if (list.empty()) {
+                awaiters.erase(signalAwaiters);
+            }
+            awaiting--;
         }
 
-        return count;
+        try {
+            awaiter->resume();
+        } catch (...) {
+            release();
+            throw;
+        }
+        release();
+    }
+#endif
+
+#ifdef THREAD_SAFE
+    void Receiver::addChannel(const std::shared_ptr<Channel> &channel) {
+        std::unique_lock<std::mutex> lock(channelMutex);
+        addedChannels.push_back(channel);
+        channelsChanged = true;
     }
 
+    void Receiver::updateChannels() {
+        std::unique_lock<std::mutex> lock(channelMutex);
+        channelsChanged = false;
+
+        channels.insert(channels.end(), addedChannels.begin(), addedChannels.end());
+        addedChannels.clear();
+
+        for (auto it = channels.begin(); it != channels.end();) {
+            if ((*it)->isClosed() && (*it)->empty()) {
+                it = channels.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+#endif
+
     void Receiver::processMessage(const Signal signal, const Variant &message) {
     }
 
-    Receiver::~Receiver() {
+    RequestId Receiver::getRequest() const {
+        return currentRequest;
+    }
+
+    bool Receiver::reply(const Variant &message) {
+        if (currentRequest == 0) {
+            return false;
+        }
+
+        return reply(currentRequest, message);
+    }
+
+    bool Receiver::reply(RequestId request, const Variant &message) {
+        if (transporter == nullptr) {
+            return false;
+        }
+
+        return transporter->completeRequest(request, RS_OK, message);
+    }
+
+    void Receiver::detach() {
+        if (detached) {
+            return;
+        }
+        detached = true;
         if (transporter != nullptr) {
             transporter->unregisterObject(this);
+#ifdef THREAD_SAFE
+            // Our handle is now invalid, so nobody new will deliver to or claim us. Wait out anyone who already
+            // checked it; nobody holds a guard across processMessage, so this is brief.
+            Epoch::synchronize();
+            // Then for whoever claimed us to finish processing
+            while (processing.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+#endif
+        }
+    }
+
+    Receiver::~Receiver() {
+        detach();
+
+        // Signalers that disconnect us from now on find their connections gone from our index, which is harmless
+        std::vector<IncomingConnection> connections;
+        {
+#ifdef THREAD_SAFE
+            std::unique_lock<std::mutex> lock(incomingMutex);
+#endif
+            connections.swap(incoming);
+        }
+        for (auto &connection : connections) {
+            SignalerLink *link = connection.link.get();
+#ifdef THREAD_SAFE
+            // Counting ourselves as a user keeps the signaler from being destroyed while we use it, without holding
+            // the link's mutex while disconnecting
+            Signaler *signaler;
+            {
+                std::unique_lock<std::mutex> lock(link->mutex);
+                signaler = link->signaler;
+                if (signaler == nullptr) {
+                    continue;
+                }
+                link->users++;
+            }
+            if (connection.subscription) {
+                signaler->removeSubscriber(this);
+            } else {
+                signaler->disconnect(connection.signal, this);
+            }
+            std::unique_lock<std::mutex> lock(link->mutex);
+            if (--link->users == 0) {
+                link->released.notify_all();
+            }
+#else
+            if (link->signaler == nullptr) {
+                continue;
+            }
+            if (connection.subscription) {
+                link->signaler->removeSubscriber(this);
+            } else {
+                link->signaler->disconnect(connection.signal, this);
+            }
+#endif
+        }
+
+#ifdef BEAMMEUP_COROUTINES
+        std::unordered_map<Signal, std::list<MessageAwaiter *>> waiting;
+        {
+#ifdef THREAD_SAFE
+            std::unique_lock<std::shared_timed_mutex> lock(mutex);
+#endif
+            waiting.swap(awaiters);
+            awaiting = 0;
+        }
+        for (auto &signalAwaiters : waiting) {
+            for (auto awaiter : signalAwaiters.second) {
+                if (awaiter->timer != 0) {
+                    transporter->unscheduleTimer(awaiter->timer);
+                }
+                // The awaiter lives in the coroutine's frame, so this frees it too
+                awaiter->handle.destroy();
+            }
+        }
+#endif
+
+#ifdef THREAD_SAFE
+        size_t discarded = 0;
+        {
+            std::unique_lock<std::mutex> lock(channelMutex);
+            channels.insert(channels.end(), addedChannels.begin(), addedChannels.end());
+            for (auto &channel : channels) {
+                // Signalers may still hold the channel, but must stop using it
+                channel->close();
+                discarded += channel->size();
+            }
+        }
+
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+#else
+        size_t discarded = 0;
+#endif
+        if (transporter != nullptr) {
+            // Anything still queued will never be processed
+            transporter->messagesDequeued(discarded + messageQueue.size());
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,65 @@
+#include "include/beammeup/RingBuffer.h"
+
+namespace BeamMeUp {
+    RingBuffer::RingBuffer(size_t capacity) : tail(0), cachedHead(0), head(0), cachedTail(0) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+
+        slots = new Slot[size];
+        mask = size - 1;
+    }
+
+    bool RingBuffer::push(Signal signal, const Variant &message) {
+        size_t position = tail.load(std::memory_order_relaxed);
+
+        if (position - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead > mask) {
+                return false;
+            }
+        }
+
+        Slot &slot = slots[position & mask];
+        slot.signal = signal;
+        slot.message = message;
+        tail.store(position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    bool RingBuffer::pop(Signal &signal, Variant &message) {
+        size_t position = head.load(std::memory_order_relaxed);
+
+        if (position == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position == cachedTail) {
+                return false;
+            }
+        }
+
+        Slot &slot = slots[position & mask];
+        signal = slot.signal;
+        message.swap(slot.message);
+        head.store(position + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    bool RingBuffer::empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    size_t RingBuffer::size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    size_t RingBuffer::capacity() const {
+        return mask + 1;
+    }
+
+    RingBuffer::~RingBuffer() {
+        delete[] slots;
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef _WIN32
+#include "include/beammeup/SharedMemoryReceiver.h"
+
+namespace BeamMeUp {
+    SharedMemoryReceiver::SharedMemoryReceiver(Transporter *transporter, const std::string &name, size_t capacity) :
+            Receiver(transporter), ring(name, SM_PRODUCER, capacity) {
+    }
+
+    SharedMemoryReceiver::~SharedMemoryReceiver() {
+        detach();
+    }
+
+    bool SharedMemoryReceiver::isPeerAlive(std::chrono::steady_clock::duration timeout) const {
+        return ring.isPeerAlive(timeout);
+    }
+
+    unsigned long long SharedMemoryReceiver::getDropped() const {
+        return ring.getDropped();
+    }
+
+    SharedMemoryRing &SharedMemoryReceiver::getRing() {
+        return ring;
+    }
+
+    void SharedMemoryReceiver::processMessage(const Signal signal, const Variant &message) {
+        // Only one thread processes a receiver at a time, so this is the ring's only writer
+        ring.write(signal, message);
+    }
+}
+#endif
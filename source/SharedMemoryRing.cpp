@@ -0,0 +1,271 @@
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "include/beammeup/SharedMemoryRing.h"
+#include "include/beammeup/Variant.h"
+#include "include/beammeup/VariantCodec.h"
+
+namespace BeamMeUp {
+    static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+                  "Atomics in shared memory must be lock free to work across processes");
+
+    const size_t SharedMemoryRing::DEFAULT_CAPACITY = 1 << 20;
+
+    // Written by the creator once the header is initialized
+    static const unsigned int MAGIC = 0x42654d55;
+    static const unsigned int VERSION = 1;
+    static const size_t MIN_CAPACITY = 4096;
+    // How long to wait for another process to finish creating the segment
+    static const std::chrono::seconds CREATE_TIMEOUT(1);
+    // Marks the rest of the ring as unused, so a record doesn't have to wrap
+    static const unsigned int PADDING = 0xffffffff;
+
+    /**
+     * Precedes every message in the ring. Records are padded to a multiple of 8 bytes.
+     */
+    struct RecordHeader {
+        unsigned int length;
+        Signal signal;
+    };
+
+    static inline size_t recordSize(size_t length) {
+        return sizeof(RecordHeader) + ((length + 7) & ~static_cast<size_t>(7));
+    }
+
+    struct SharedMemoryRing::Side {
+        // For the producer, the number of bytes written; for the consumer, the number read
+        std::atomic<unsigned long long> position;
+        // The attached process, or 0
+        std::atomic<int> pid;
+        // When the process last showed signs of life, in steady_clock ticks (CLOCK_MONOTONIC, so shared by every
+        // process on the host)
+        std::atomic<long long> heartbeat;
+    };
+
+    struct SharedMemoryRing::Header {
+        std::atomic<unsigned int> magic;
+        unsigned int version;
+        unsigned long long capacity;
+        std::atomic<unsigned long long> dropped;
+        // On their own cache lines, as each is written by a different process
+        alignas(64) Side producer;
+        alignas(64) Side consumer;
+    };
+
+    // On its own cache line
+    const size_t SharedMemoryRing::DATA_OFFSET = (sizeof(Header) + 63) & ~static_cast<size_t>(63);
+
+    /**
+     * @param pid A process id
+     * @return true if the process is running
+     */
+    static bool isProcessAlive(int pid) {
+        return kill(pid, 0) == 0 || errno == EPERM;
+    }
+
+    SharedMemoryRing::SharedMemoryRing(const std::string &name, SharedMemoryRole role, size_t capacity) :
+            role(role), header(nullptr), data(nullptr), mask(0), mappedSize(0), pid(getpid()) {
+        int descriptor = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        bool created = descriptor != -1;
+        if (!created) {
+            if (errno != EEXIST) {
+                throw std::runtime_error("Can't create shared memory " + name + ": " + strerror(errno));
+            }
+            descriptor = shm_open(name.c_str(), O_RDWR, 0);
+            if (descriptor == -1) {
+                throw std::runtime_error("Can't open shared memory " + name + ": " + strerror(errno));
+            }
+        }
+
+        if (created) {
+            size_t rounded = MIN_CAPACITY;
+            while (rounded < capacity) {
+                rounded <<= 1;
+            }
+            capacity = rounded;
+            mappedSize = DATA_OFFSET + capacity;
+            if (ftruncate(descriptor, static_cast<off_t>(mappedSize)) == -1) {
+                int error = errno;
+                close(descriptor);
+                shm_unlink(name.c_str());
+                throw std::runtime_error("Can't size shared memory " + name + ": " + strerror(error));
+            }
+        } else {
+            // The creator may not have sized it yet
+            auto deadline = std::chrono::steady_clock::now() + CREATE_TIMEOUT;
+            struct stat status;
+            while (fstat(descriptor, &status) == 0 && static_cast<size_t>(status.st_size) < DATA_OFFSET &&
+                   std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (static_cast<size_t>(status.st_size) < DATA_OFFSET) {
+                close(descriptor);
+                throw std::runtime_error("Shared memory " + name + " was never initialized");
+            }
+            mappedSize = static_cast<size_t>(status.st_size);
+        }
+
+        void *mapping = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+        close(descriptor);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Can't map shared memory " + name + ": " + strerror(errno));
+        }
+        header = static_cast<Header *>(mapping);
+        data = static_cast<char *>(mapping) + DATA_OFFSET;
+
+        if (created) {
+            // The segment starts zeroed, which is what the atomics want
+            header->version = VERSION;
+            header->capacity = capacity;
+            header->magic.store(MAGIC, std::memory_order_release);
+        } else {
+            auto deadline = std::chrono::steady_clock::now() + CREATE_TIMEOUT;
+            while (header->magic.load(std::memory_order_acquire) != MAGIC &&
+                   std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (header->magic.load(std::memory_order_acquire) != MAGIC || header->version != VERSION ||
+                DATA_OFFSET + header->capacity != mappedSize) {
+                munmap(mapping, mappedSize);
+                throw std::runtime_error("Shared memory " + name + " isn't a compatible ring");
+            }
+        }
+        mask = static_cast<size_t>(header->capacity) - 1;
+
+        // Take over the role if the process that had it has died. Not even this process may attach twice.
+        Side &own = getSide(role);
+        int previous = own.pid.load();
+        do {
+            if (previous != 0 && isProcessAlive(previous)) {
+                munmap(mapping, mappedSize);
+                throw std::runtime_error("Another process is attached to " + name + " in the same role");
+            }
+        } while (!own.pid.compare_exchange_weak(previous, pid));
+        heartbeat();
+    }
+
+    SharedMemoryRing::~SharedMemoryRing() {
+        int attached = pid;
+        getSide(role).pid.compare_exchange_strong(attached, 0);
+        munmap(header, mappedSize);
+    }
+
+    bool SharedMemoryRing::unlink(const std::string &name) {
+        return shm_unlink(name.c_str()) == 0;
+    }
+
+    bool SharedMemoryRing::write(Signal signal, const Variant &message) {
+        size_t capacity = mask + 1;
+        size_t length = VariantCodec::size(message);
+        size_t size = recordSize(length);
+        if (size > capacity / 2) {
+            header->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        unsigned long long head = header->producer.position.load(std::memory_order_relaxed);
+        unsigned long long tail = header->consumer.position.load(std::memory_order_acquire);
+        size_t offset = static_cast<size_t>(head) & mask;
+        size_t contiguous = capacity - offset;
+        size_t needed = size > contiguous ? contiguous + size : size;
+        if (head + needed - tail > capacity) {
+            header->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (size > contiguous) {
+            reinterpret_cast<RecordHeader *>(data + offset)->length = PADDING;
+            head += contiguous;
+            offset = 0;
+        }
+        auto record = reinterpret_cast<RecordHeader *>(data + offset);
+        record->length = static_cast<unsigned int>(length);
+        record->signal = signal;
+        VariantCodec::encode(message, data + offset + sizeof(RecordHeader));
+
+        header->producer.position.store(head + size, std::memory_order_release);
+        heartbeat();
+        return true;
+    }
+
+    bool SharedMemoryRing::read(Signal &signal, Variant &message) {
+        size_t capacity = mask + 1;
+        unsigned long long tail = header->consumer.position.load(std::memory_order_relaxed);
+        unsigned long long head = header->producer.position.load(std::memory_order_acquire);
+
+        while (tail != head) {
+            size_t offset = static_cast<size_t>(tail) & mask;
+            auto record = reinterpret_cast<const RecordHeader *>(data + offset);
+            unsigned int length = record->length;
+            if (length == PADDING) {
+                tail += capacity - offset;
+                continue;
+            }
+            if (length > capacity - offset - sizeof(RecordHeader)) {
+                // Corrupt. There's no telling where the next record starts, so give up on what's there.
+                tail = head;
+                break;
+            }
+
+            const char *position = data + offset + sizeof(RecordHeader);
+            const char *end = position + length;
+            bool decoded = VariantCodec::decode(position, end, message) && position == end;
+            signal = record->signal;
+            tail += recordSize(length);
+            if (decoded) {
+                header->consumer.position.store(tail, std::memory_order_release);
+                heartbeat();
+                return true;
+            }
+        }
+
+        header->consumer.position.store(tail, std::memory_order_release);
+        return false;
+    }
+
+    bool SharedMemoryRing::empty() const {
+        return header->consumer.position.load(std::memory_order_acquire) ==
+               header->producer.position.load(std::memory_order_acquire);
+    }
+
+    size_t SharedMemoryRing::getCapacity() const {
+        return mask + 1;
+    }
+
+    unsigned long long SharedMemoryRing::getDropped() const {
+        return header->dropped.load(std::memory_order_relaxed);
+    }
+
+    bool SharedMemoryRing::isPeerAlive(std::chrono::steady_clock::duration timeout) const {
+        Side &peer = getSide(role == SM_PRODUCER ? SM_CONSUMER : SM_PRODUCER);
+        int peerPid = peer.pid.load();
+        if (peerPid == 0 || !isProcessAlive(peerPid)) {
+            return false;
+        }
+
+        if (timeout != std::chrono::steady_clock::duration::zero()) {
+            auto last = std::chrono::steady_clock::time_point(
+                    std::chrono::steady_clock::duration(peer.heartbeat.load(std::memory_order_relaxed)));
+            return std::chrono::steady_clock::now() - last <= timeout;
+        }
+        return true;
+    }
+
+    void SharedMemoryRing::heartbeat() {
+        getSide(role).heartbeat.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                                      std::memory_order_relaxed);
+    }
+
+    SharedMemoryRing::Side &SharedMemoryRing::getSide(SharedMemoryRole role) const {
+        return role == SM_PRODUCER ? header->producer : header->consumer;
+    }
+}
+#endif
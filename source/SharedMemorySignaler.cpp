@@ -0,0 +1,28 @@
+#ifndef _WIN32
+#include "include/beammeup/SharedMemorySignaler.h"
+
+namespace BeamMeUp {
+    SharedMemorySignaler::SharedMemorySignaler(Transporter *transporter, const std::string &name, size_t capacity) :
+            Signaler(transporter), ring(name, SM_CONSUMER, capacity) {
+    }
+
+    unsigned int SharedMemorySignaler::processMessages(unsigned int maxMessages) {
+        unsigned int count = 0;
+        Signal signal;
+        Variant message;
+        while ((maxMessages == 0 || count < maxMessages) && ring.read(signal, message)) {
+            notify(signal, message);
+            count++;
+        }
+        return count;
+    }
+
+    bool SharedMemorySignaler::isPeerAlive(std::chrono::steady_clock::duration timeout) const {
+        return ring.isPeerAlive(timeout);
+    }
+
+    SharedMemoryRing &SharedMemorySignaler::getRing() {
+        return ring;
+    }
+}
+#endif
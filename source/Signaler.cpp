@@ -1,79 +1,692 @@
+#include <algorithm>
+#include <stdexcept>
+#ifdef THREAD_SAFE
+#include <thread>
+#endif
+
+#include "include/beammeup/ConnectionFilter.h"
+#include "include/beammeup/Epoch.h"
+#include "include/beammeup/NamedSignal.h"
 #include "include/beammeup/Receiver.h"
 #include "include/beammeup/Signaler.h"
 #include "include/beammeup/Transporter.h"
 
 namespace BeamMeUp {
-    Signaler::Signaler(Transporter *transporter) : transporter(transporter) {
+#ifdef THREAD_SAFE
+    /**
+     * A receiver a broadcast is handed to a worker for
+     */
+    struct BroadcastTarget {
+        Receiver *receiver;
+        ReceiverHandle handle;
+        std::shared_ptr<ConnectionFilter> filter;
+    };
+
+    /**
+     * Progress of a broadcast, shared by the workers handling it
+     */
+    struct BroadcastState {
+        std::atomic<unsigned int> remaining;
+        std::promise<void> done;
+    };
+#endif
+
+    Signaler::Signaler(Transporter *transporter) : transporter(transporter), link(std::make_shared<SignalerLink>()) {
+        link->signaler = this;
+#ifdef THREAD_SAFE
+        link->users = 0;
+#endif
+        hasTimers = false;
+        hasRequests = false;
+    }
+
+    Signaler::~Signaler() {
+        // A transporter's own timers, requests and connections go with it
+        if (transporter != nullptr && static_cast<Signaler *>(transporter) != this) {
+            if (hasTimers) {
+                transporter->unscheduleTimers(this);
+            }
+            if (hasRequests) {
+                transporter->cancelRequests(this);
+            }
+            disconnectAll();
+        }
+
+        // Receivers being destroyed may be disconnecting from us. Wait for them, and keep any more from trying.
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(link->mutex);
+        link->released.wait(lock, [this]() {
+            return link->users == 0;
+        });
+#endif
+        link->signaler = nullptr;
     }
 
-    void Signaler::connect(Signal signal, Receiver *receiver) {
+    void Signaler::connect(Signal signal, Receiver *receiver, const ConnectionOptions &options) {
         if (receiver == nullptr) {
             // Abort if the receiver isn't valid
             return;
         }
 
+        Connection connection = makeConnection(receiver, options);
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(mutex);
+#endif
+        addConnection(signal, connection);
+    }
+
+    void Signaler::connect(const std::string &pattern, Receiver *receiver, const ConnectionOptions &options) {
+        if (!isTopicPattern(pattern)) {
+            connect(topicSignal(pattern), receiver, options);
+            return;
+        }
+
+        TopicTrie::validatePattern(pattern);
+        if (receiver == nullptr) {
+            return;
+        }
+
+        ReceiverHandle handle = receiver->transporter == transporter ? receiver->handle : 0;
+        TopicTrie::Subscription subscription = {receiver, handle, options};
 #ifdef THREAD_SAFE
-        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+        std::unique_lock<std::mutex> lock(mutex);
 #endif
-        connectedObjects.insert(std::pair<Signal, Receiver *>(signal, receiver));
+        topics.matchTopics(pattern, [this, receiver, handle, &options](const std::string &topic) {
+            // A topic matched by more than one of the receiver's patterns is only delivered once. The subscription
+            // that connected it first keeps its options.
+            if (topics.hasSubscription(topic, [receiver, handle](const TopicTrie::Subscription &other) {
+                return other.receiver == receiver && other.handle == handle;
+            })) {
+                return;
+            }
+            Connection connection = makeConnection(receiver, options);
+            connection.subscribed = true;
+            addConnection(topicSignal(topic), connection);
+        });
+        topics.addSubscription(pattern, subscription);
+        // So the subscription is removed when the receiver is destroyed, even if it never matches a topic
+        receiver->addIncoming(link, 0, true);
+    }
+
+    Signal Signaler::advertise(const std::string &topic) {
+        if (isTopicPattern(topic)) {
+            throw std::runtime_error("Topics can't contain wildcards");
+        }
+        Signal signal = SignalRegistry::add(topic);
+
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(mutex);
+#endif
+        if (!topics.addTopic(topic) || transporter == nullptr) {
+            return signal;
+        }
+
+        // Subscribers may have been destroyed since subscribing. Those whose handles are still valid can't be until
+        // we leave the guard.
+        Epoch::Guard guard;
+        bool stale = false;
+        std::vector<const Receiver *> connected;
+        topics.matchSubscriptions(topic, [this, signal, &stale, &connected](
+                const TopicTrie::Subscription &subscription) {
+            if (!transporter->handles.isValid(subscription.handle)) {
+                stale = true;
+                return;
+            }
+            // A receiver with several matching patterns gets the topic once
+            if (std::find(connected.begin(), connected.end(), subscription.receiver) != connected.end()) {
+                return;
+            }
+            connected.push_back(subscription.receiver);
+            Connection connection = makeConnection(subscription.receiver, subscription.options);
+            connection.subscribed = true;
+            addConnection(signal, connection);
+        });
+
+        if (stale) {
+            topics.removeSubscriptions([this](const TopicTrie::Subscription &subscription) {
+                return !transporter->handles.isValid(subscription.handle);
+            });
+        }
+
+        return signal;
     }
 
     void Signaler::disconnect(Signal signal) {
+        std::vector<Connection> removed;
+        {
 #ifdef THREAD_SAFE
-        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+            std::unique_lock<std::mutex> lock(mutex);
 #endif
-        connectedObjects.erase(signal);
+            connections.remove(signal, [](const Connection &) {
+                return true;
+            }, removed);
+            forgetConnections(removed);
+        }
+
+        closeConnections(removed);
     }
 
     void Signaler::disconnect(const Receiver *receiver) {
+        if (receiver == nullptr) {
+            return;
+        }
+
+        std::vector<Connection> removed;
+        {
 #ifdef THREAD_SAFE
-        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+            std::unique_lock<std::mutex> lock(mutex);
 #endif
-        for (auto it = connectedObjects.begin(); it != connectedObjects.end(); ++it) {
-            if (it->second == receiver) {
-                it = connectedObjects.erase(it);
+            // The receiver's index holds every signal we've connected it to, so nothing else needs looking at
+            std::vector<Signal> signals = receiver->getIncoming(link.get());
+            std::sort(signals.begin(), signals.end());
+            signals.erase(std::unique(signals.begin(), signals.end()), signals.end());
+            for (Signal signal : signals) {
+                connections.remove(signal, [receiver](const Connection &connection) {
+                    return connection.receiver == receiver;
+                }, removed);
             }
+            unsubscribe([receiver](const TopicTrie::Subscription &subscription) {
+                return subscription.receiver == receiver;
+            });
+            forgetConnections(removed);
         }
+
+        closeConnections(removed);
     }
 
     void Signaler::disconnect(Signal signal, const Receiver *receiver) {
+        std::vector<Connection> removed;
+        {
 #ifdef THREAD_SAFE
-        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+            std::unique_lock<std::mutex> lock(mutex);
 #endif
-        auto range = connectedObjects.equal_range(signal);
+            connections.remove(signal, [receiver](const Connection &connection) {
+                return connection.receiver == receiver;
+            }, removed);
+            forgetConnections(removed);
+        }
 
-        for (auto it = range.first; it != range.second; ++it) {
-            if (it->second == receiver) {
-                connectedObjects.erase(it);
-            }
+        closeConnections(removed);
+    }
+
+    void Signaler::disconnect(const std::string &pattern, const Receiver *receiver) {
+        if (!isTopicPattern(pattern)) {
+            disconnect(topicSignal(pattern), receiver);
+            return;
         }
+
+        std::vector<Connection> removed;
+        {
+#ifdef THREAD_SAFE
+            std::unique_lock<std::mutex> lock(mutex);
+#endif
+            unsubscribe(pattern, [receiver](const TopicTrie::Subscription &subscription) {
+                return subscription.receiver == receiver;
+            });
+            ReceiverHandle handle = receiver->transporter == transporter ? receiver->handle : 0;
+            topics.matchTopics(pattern, [this, receiver, handle, &removed](const std::string &topic) {
+                // Topics still matched by another of the receiver's patterns stay connected
+                if (topics.hasSubscription(topic, [receiver, handle](const TopicTrie::Subscription &subscription) {
+                    return subscription.receiver == receiver && subscription.handle == handle;
+                })) {
+                    return;
+                }
+                connections.remove(topicSignal(topic), [receiver](const Connection &connection) {
+                    return connection.receiver == receiver && connection.subscribed;
+                }, removed);
+            });
+            forgetConnections(removed);
+        }
+
+        closeConnections(removed);
     }
 
     void Signaler::disconnectAll() {
+        std::vector<Connection> removed;
+        {
 #ifdef THREAD_SAFE
-        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+            std::unique_lock<std::mutex> lock(mutex);
 #endif
-        connectedObjects.clear();
+            connections.removeAll([](const Connection &) {
+                return true;
+            }, removed);
+            unsubscribe([](const TopicTrie::Subscription &) {
+                return true;
+            });
+            forgetConnections(removed);
+        }
+
+        closeConnections(removed);
     }
 
     std::multimap<Signal, Receiver *> Signaler::getConnectedObjects() {
-        return connectedObjects;
+        std::multimap<Signal, Receiver *> objects;
+
+        Epoch::Guard guard;
+        connections.forEach([&objects](Signal signal, const Connection &connection) {
+            objects.insert(std::pair<Signal, Receiver *>(signal, connection.receiver));
+        });
+
+        return objects;
     };
 
+    size_t Signaler::getSubscriptionCount() {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(mutex);
+#endif
+        return topics.getSubscriptionCount();
+    }
+
     void Signaler::notify(Signal signal, const Variant &message) {
+        if (transporter == nullptr) {
+            return;
+        }
+
+        // Receivers claimed for inline delivery. They're delivered to once we've left the guard, so their handlers
+        // can't hold up other threads; being claimed keeps them from being destroyed meanwhile.
+        std::vector<DirectDelivery> direct;
+        {
+            // Find all of the connections for this signal. No lock: connect and disconnect publish new lists rather
+            // than changing this one.
+            Epoch::Guard guard;
+            const ConnectionTable::List *list = connections.find(signal);
+            if (list == nullptr) {
+                return;
+            }
+
+            // Add to queue(s)
+            size_t count = list->size();
+            for (size_t i = 0; i < count; ++i) {
+                const Connection &connection = (*list)[i];
+                if (transporter->handles.isValid(connection.handle)) {
+                    if (connection.filter != nullptr && !connection.filter->accept(signal, message)) {
+                        continue;
+                    }
+                    if (connection.direct && isDirectThread(connection) && connection.receiver->claimDirect()) {
+                        direct.push_back({connection.receiver, nullptr});
+                        continue;
+                    }
+#ifdef THREAD_SAFE
+                    if (connection.channel != nullptr) {
+                        if (!connection.channel->isClosed()) {
+                            connection.channel->push(signal, message);
+                        }
+                        continue;
+                    }
+#endif
+                    connection.receiver->receiveMessage(signal, message);
+                }
+            }
+        }
+
+        deliverDirect(direct, signal, &message, 1);
+    }
+
+    void Signaler::notifyBatch(Signal signal, const VariantVector &messages) {
+        if (messages.empty() || transporter == nullptr) {
+            return;
+        }
+
+        // As in notify, inline deliveries are made outside the guard
+        std::vector<DirectDelivery> direct;
+        {
+            Epoch::Guard guard;
+            const ConnectionTable::List *list = connections.find(signal);
+            if (list == nullptr) {
+                return;
+            }
+
+            size_t count = list->size();
+            for (size_t i = 0; i < count; ++i) {
+                const Connection &connection = (*list)[i];
+                if (!transporter->handles.isValid(connection.handle)) {
+                    continue;
+                }
+
+                // Claimed receivers get every message inline, so the batch stays in order. Filtered connections run
+                // their filter on each message as it is delivered.
+                if (connection.direct && isDirectThread(connection) && connection.receiver->claimDirect()) {
+                    direct.push_back({connection.receiver, connection.filter});
+                    continue;
+                }
+
+                if (connection.filter != nullptr) {
+                    // Filtered connections get the messages one at a time, so rejected ones are never copied
+                    for (const Variant &message : messages) {
+                        if (!connection.filter->accept(signal, message)) {
+                            continue;
+                        }
 #ifdef THREAD_SAFE
-        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+                        if (connection.channel != nullptr) {
+                            if (!connection.channel->isClosed()) {
+                                connection.channel->push(signal, message);
+                            }
+                            continue;
+                        }
 #endif
-        // Find all of the connected functions matching this id
-        auto range = connectedObjects.equal_range(signal);
+                        connection.receiver->receiveMessage(signal, message);
+                    }
+                    continue;
+                }
+#ifdef THREAD_SAFE
+                if (connection.channel != nullptr) {
+                    if (!connection.channel->isClosed()) {
+                        connection.channel->pushBatch(signal, messages);
+                    }
+                    continue;
+                }
+#endif
+                connection.receiver->receiveMessages(signal, messages);
+            }
+        }
+
+        deliverDirect(direct, signal, messages.data(), messages.size());
+    }
+
+    void Signaler::deliverDirect(const std::vector<DirectDelivery> &direct, Signal signal, const Variant *messages,
+                                 size_t count) {
+        for (size_t i = 0; i < direct.size(); ++i) {
+            const DirectDelivery &delivery = direct[i];
+            try {
+                for (size_t j = 0; j < count; ++j) {
+                    if (delivery.filter == nullptr || delivery.filter->accept(signal, messages[j])) {
+                        delivery.receiver->processDirect(signal, messages[j]);
+                    }
+                }
+            } catch (...) {
+                // The rest are still claimed
+                for (size_t j = i; j < direct.size(); ++j) {
+                    direct[j].receiver->release();
+                }
+                throw;
+            }
+            delivery.receiver->release();
+        }
+    }
+
+#ifdef THREAD_SAFE
+    std::future<void> Signaler::broadcast(Signal signal, const Variant &message, FanOutPool &pool) {
+        auto state = std::make_shared<BroadcastState>();
+        std::future<void> future = state->done.get_future();
+        unsigned int threads = pool.getThreads();
+        std::vector<std::vector<BroadcastTarget>> shares(threads);
 
-        // Add to queue(s)
         if (transporter != nullptr) {
-            for (auto it = range.first; it != range.second; ++it) {
-                if (transporter->isObjectRegistered(it->second)) {
-                    it->second->receiveMessage(signal, message);
+            // The list can be retired as soon as we leave the guard, so the workers get their own copies of the
+            // receivers. That's far cheaper than copying the message for each one.
+            Epoch::Guard guard;
+            const ConnectionTable::List *list = connections.find(signal);
+            size_t count = list == nullptr ? 0 : list->size();
+            for (auto &share : shares) {
+                share.reserve(count / threads + 1);
+            }
+            for (size_t i = 0; i < count; ++i) {
+                const Connection &connection = (*list)[i];
+                if (connection.handle != 0) {
+                    // The low half of a handle is its slot, which is stable for the receiver's lifetime
+                    shares[static_cast<unsigned int>(connection.handle) % threads].push_back(
+                            {connection.receiver, connection.handle, connection.filter});
                 }
             }
         }
+
+        unsigned int busy = 0;
+        for (auto &share : shares) {
+            busy += share.empty() ? 0 : 1;
+        }
+        if (busy == 0) {
+            state->done.set_value();
+            return future;
+        }
+
+        state->remaining = busy;
+        auto shared = std::make_shared<const Variant>(message);
+        Transporter *transporter = this->transporter;
+        for (unsigned int i = 0; i < threads; ++i) {
+            if (shares[i].empty()) {
+                continue;
+            }
+
+            auto targets = std::make_shared<std::vector<BroadcastTarget>>(std::move(shares[i]));
+            pool.submit(i, [transporter, signal, shared, targets, state]() {
+                {
+                    Epoch::Guard guard;
+                    for (auto &target : *targets) {
+                        if (!transporter->handles.isValid(target.handle)) {
+                            continue;
+                        }
+                        if (target.filter != nullptr && !target.filter->accept(signal, *shared)) {
+                            continue;
+                        }
+                        target.receiver->receiveShared(signal, shared);
+                    }
+                }
+
+                if (--state->remaining == 0) {
+                    state->done.set_value();
+                }
+            });
+        }
+
+        return future;
+    }
+#endif
+
+    TimerId Signaler::notifyAfter(Signal signal, const Variant &message, std::chrono::steady_clock::duration delay) {
+        return notifyAt(signal, message, std::chrono::steady_clock::now() + delay);
+    }
+
+    TimerId Signaler::notifyAt(Signal signal, const Variant &message, std::chrono::steady_clock::time_point time) {
+        if (transporter == nullptr) {
+            return 0;
+        }
+
+        hasTimers = true;
+        return transporter->scheduleTimer(this, signal, message, time, std::chrono::steady_clock::duration::zero());
+    }
+
+    TimerId Signaler::notifyEvery(Signal signal, const Variant &message, std::chrono::steady_clock::duration interval) {
+        if (transporter == nullptr) {
+            return 0;
+        }
+
+        hasTimers = true;
+        return transporter->scheduleTimer(this, signal, message, std::chrono::steady_clock::now() + interval,
+                                          interval);
+    }
+
+    bool Signaler::cancelTimer(TimerId id) {
+        if (transporter == nullptr) {
+            return false;
+        }
+
+        return transporter->unscheduleTimer(id);
+    }
+
+    RequestId Signaler::request(Signal signal, const Variant &message, const ReplyCallback &callback,
+                                std::chrono::steady_clock::duration timeout) {
+        if (transporter == nullptr) {
+            return 0;
+        }
+
+        hasRequests = true;
+#ifdef THREAD_SAFE
+        RequestId id = transporter->startRequest(this, callback, nullptr, timeout);
+#else
+        RequestId id = transporter->startRequest(this, callback, timeout);
+#endif
+        if (!sendRequest(signal, message, id)) {
+            transporter->completeRequest(id, RS_NO_RECEIVER, Variant());
+        }
+
+        return id;
     }
+
+#ifdef THREAD_SAFE
+    std::future<Variant> Signaler::request(Signal signal, const Variant &message,
+                                           std::chrono::steady_clock::duration timeout) {
+        auto promise = std::make_shared<std::promise<Variant>>();
+        auto future = promise->get_future();
+        if (transporter == nullptr) {
+            promise->set_exception(std::make_exception_ptr(std::runtime_error("No transporter for request")));
+            return future;
+        }
+
+        hasRequests = true;
+        RequestId id = transporter->startRequest(this, nullptr, promise, timeout);
+        if (!sendRequest(signal, message, id)) {
+            transporter->completeRequest(id, RS_NO_RECEIVER, Variant());
+        }
+
+        return future;
+    }
+#endif
+
+    bool Signaler::cancelRequest(RequestId id) {
+        if (transporter == nullptr) {
+            return false;
+        }
+
+        return transporter->completeRequest(id, RS_CANCELLED, Variant());
+    }
+
+    bool Signaler::isDirectThread(const Connection &connection) {
+#ifdef THREAD_SAFE
+        return connection.thread == std::this_thread::get_id();
+#else
+        // There's only one thread
+        (void)connection;
+        return true;
+#endif
+    }
+
+    void Signaler::addConnection(Signal signal, Connection connection) {
+        connection.signal = signal;
+        connections.add(signal, connection);
+        connection.receiver->addIncoming(link, signal);
+    }
+
+    Connection Signaler::makeConnection(Receiver *receiver, const ConnectionOptions &options) {
+        Connection connection;
+        connection.receiver = receiver;
+        // Receivers registered elsewhere never get messages from us
+        connection.handle = receiver->transporter == transporter ? receiver->handle : 0;
+        connection.filter = options.filter;
+        connection.direct = options.type == C_DIRECT;
+        connection.subscribed = false;
+#ifdef THREAD_SAFE
+        connection.thread = std::this_thread::get_id();
+        if (options.type == C_SPSC) {
+            connection.channel = std::make_shared<Channel>(receiver->transporter, options.capacity, receiver);
+            receiver->addChannel(connection.channel);
+        }
+#endif
+
+        return connection;
+    }
+
+    bool Signaler::sendRequest(Signal signal, const Variant &message, RequestId id) {
+        Epoch::Guard guard;
+        const ConnectionTable::List *list = connections.find(signal);
+        if (list == nullptr) {
+            return false;
+        }
+
+        bool sent = false;
+        size_t count = list->size();
+        for (size_t i = 0; i < count; ++i) {
+            // Requests always go through the mailbox, even on C_SPSC connections
+            const Connection &connection = (*list)[i];
+            if (transporter->handles.isValid(connection.handle) &&
+                (connection.filter == nullptr || connection.filter->accept(signal, message))) {
+                connection.receiver->receiveRequest(signal, message, id);
+                sent = true;
+            }
+        }
+
+        return sent;
+    }
+
+    void Signaler::closeConnections(const std::vector<Connection> &removed) {
+#ifdef THREAD_SAFE
+        bool hasChannels = false;
+        for (auto &connection : removed) {
+            hasChannels = hasChannels || connection.channel != nullptr;
+        }
+        if (!hasChannels) {
+            return;
+        }
+
+        // A notify that found the connections before they were removed could still push to their channels. Once it
+        // is done, nothing can, and the receivers can be told to drop them.
+        Epoch::synchronize();
+
+        // closeConnection touches the receivers, which mustn't be destroyed under us
+        Epoch::Guard guard;
+        for (auto &connection : removed) {
+            closeConnection(connection);
+        }
+#else
+        // Channels only exist in the thread safe build
+        (void)removed;
+#endif
+    }
+
+    void Signaler::forgetConnections(const std::vector<Connection> &removed) {
+        for (auto &connection : removed) {
+            connection.receiver->removeIncoming(link.get(), connection.signal);
+        }
+    }
+
+    void Signaler::unsubscribe(const TopicTrie::SubscriptionMatcher &matcher) {
+        std::vector<Receiver *> receivers;
+        topics.removeSubscriptions([&matcher, &receivers](const TopicTrie::Subscription &subscription) {
+            if (!matcher(subscription)) {
+                return false;
+            }
+            receivers.push_back(subscription.receiver);
+            return true;
+        });
+        for (Receiver *receiver : receivers) {
+            receiver->removeIncoming(link.get(), 0, true);
+        }
+    }
+
+    void Signaler::unsubscribe(const std::string &pattern, const TopicTrie::SubscriptionMatcher &matcher) {
+        std::vector<Receiver *> receivers;
+        topics.removeSubscriptions(pattern, [&matcher, &receivers](const TopicTrie::Subscription &subscription) {
+            if (!matcher(subscription)) {
+                return false;
+            }
+            receivers.push_back(subscription.receiver);
+            return true;
+        });
+        for (Receiver *receiver : receivers) {
+            receiver->removeIncoming(link.get(), 0, true);
+        }
+    }
+
+    void Signaler::removeSubscriber(const Receiver *receiver) {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(mutex);
+#endif
+        topics.removeSubscriptions([receiver](const TopicTrie::Subscription &subscription) {
+            return subscription.receiver == receiver;
+        });
+    }
+
+#ifdef THREAD_SAFE
+    void Signaler::closeConnection(const Connection &connection) {
+        if (connection.channel == nullptr) {
+            return;
+        }
+
+        connection.channel->close();
+        // Let the receiver drop the channel once it has drained it. One whose handle is still valid can't finish
+        // being destroyed until our caller's guard is released.
+        if (transporter != nullptr && transporter->handles.isValid(connection.handle)) {
+            connection.receiver->channelsChanged = true;
+        }
+    }
+#endif
 }
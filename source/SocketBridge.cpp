@@ -0,0 +1,414 @@
+#ifndef _WIN32
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "include/beammeup/SocketBridge.h"
+#include "include/beammeup/Variant.h"
+#include "include/beammeup/VariantCodec.h"
+
+namespace BeamMeUp {
+    const size_t SocketBridge::DEFAULT_WINDOW = 256 * 1024;
+    const size_t SocketBridge::DEFAULT_LIMIT = 4 * 1024 * 1024;
+
+    // The largest batch of messages, so batches are written while the next is filled
+    static const size_t MAX_BATCH_SIZE = 64 * 1024;
+    // The most buffers passed to one writev
+    static const int MAX_VECTORS = 64;
+    // Set in a frame's length for a grant of credit, which has no payload
+    static const unsigned int CONTROL = 0x80000000;
+    // Also set in the first grant, which is the sender's whole window
+    static const unsigned int WINDOW = 0x40000000;
+
+    /**
+     * Precedes every frame on the socket. For a message, value is its signal and length the size of the encoded
+     * message that follows; for a grant, value is the number of bytes granted.
+     */
+    struct FrameHeader {
+        unsigned int length;
+        unsigned int value;
+    };
+
+    /**
+     * Writes several buffers with one call, like writev, without raising SIGPIPE if the peer has gone
+     * @param descriptor The socket
+     * @param vectors The buffers
+     * @param count The number of buffers
+     * @return The number of bytes written, or -1 with errno set
+     */
+    static ssize_t gatherWrite(int descriptor, iovec *vectors, int count) {
+#ifdef MSG_NOSIGNAL
+        msghdr header = {};
+        header.msg_iov = vectors;
+        header.msg_iovlen = static_cast<size_t>(count);
+        return sendmsg(descriptor, &header, MSG_NOSIGNAL);
+#else
+        return writev(descriptor, vectors, count);
+#endif
+    }
+
+    /**
+     * Fills in the address of a Unix domain socket
+     * @param path The socket's path
+     * @param address Receives the address
+     */
+    static void makeAddress(const std::string &path, sockaddr_un &address) {
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Socket path is too long: " + path);
+        }
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    }
+
+    SocketBridge::SocketBridge(Transporter *transporter, int descriptor, size_t window, size_t limit) :
+            Signaler(transporter), Receiver(transporter), descriptor(descriptor), window(window), limit(limit),
+            batchSize(std::min(MAX_BATCH_SIZE, window / 4)), peerWindow(0), open(true), dropped(0), readyOffset(0),
+            credit(0), buffered(0), inbound(MAX_BATCH_SIZE), inboundHead(0), inboundTail(0), consumed(0) {
+        if (descriptor < 0 || fcntl(descriptor, F_SETFL, fcntl(descriptor, F_GETFL) | O_NONBLOCK) == -1) {
+            throw std::runtime_error("SocketBridge needs a connected socket");
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        grant(window, true);
+        write();
+    }
+
+    SocketBridge::~SocketBridge() {
+        // processMessage sends, so deliveries must stop before the buffers go
+        detach();
+        {
+            // Stops send touching the descriptor, which may be reused once closed
+            std::lock_guard<std::mutex> lock(mutex);
+            open = false;
+        }
+        close(descriptor);
+    }
+
+    int SocketBridge::openListener(const std::string &path) {
+        sockaddr_un address;
+        makeAddress(path, address);
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener == -1) {
+            throw std::runtime_error(std::string("Can't create socket: ") + strerror(errno));
+        }
+        ::unlink(path.c_str());
+        if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == -1 ||
+            ::listen(listener, SOMAXCONN) == -1) {
+            int error = errno;
+            close(listener);
+            throw std::runtime_error("Can't listen on " + path + ": " + strerror(error));
+        }
+        return listener;
+    }
+
+    int SocketBridge::acceptConnection(int listener) {
+        int connection;
+        do {
+            connection = ::accept(listener, nullptr, nullptr);
+        } while (connection == -1 && errno == EINTR);
+        if (connection == -1) {
+            throw std::runtime_error(std::string("Can't accept connection: ") + strerror(errno));
+        }
+        return connection;
+    }
+
+    int SocketBridge::openConnection(const std::string &path) {
+        sockaddr_un address;
+        makeAddress(path, address);
+        int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connection == -1) {
+            throw std::runtime_error(std::string("Can't create socket: ") + strerror(errno));
+        }
+        if (::connect(connection, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == -1) {
+            int error = errno;
+            close(connection);
+            throw std::runtime_error("Can't connect to " + path + ": " + strerror(error));
+        }
+        return connection;
+    }
+
+    bool SocketBridge::send(Signal signal, const Variant &message) {
+        size_t length = VariantCodec::size(message);
+        size_t size = sizeof(FrameHeader) + length;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        // Until the peer's window is known only the limit applies, and resize drops anything too large for it
+        if (!open || (peerWindow > 0 && size > peerWindow / 2) || buffered + size > limit) {
+            dropped++;
+            return false;
+        }
+
+        std::string &batch = batchFor(size);
+        FrameHeader header = {static_cast<unsigned int>(length), signal};
+        batch.append(reinterpret_cast<const char *>(&header), sizeof(header));
+        size_t start = batch.size();
+        batch.resize(start + length);
+        VariantCodec::encode(message, &batch[start]);
+        buffered += size;
+
+        // Write once a batch has filled, leaving smaller bursts for flush
+        if (waiting.size() > 1 || batch.size() >= batchSize) {
+            admit();
+            write();
+        }
+        return true;
+    }
+
+    bool SocketBridge::flush() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!open) {
+            return false;
+        }
+        admit();
+        write();
+        return waiting.empty() && ready.empty();
+    }
+
+    unsigned int SocketBridge::processSocket(unsigned int maxMessages) {
+        if (!open) {
+            return 0;
+        }
+
+        // Read everything that has arrived. The peer can't send more than its credit, so this is bounded.
+        char extra[MAX_BATCH_SIZE];
+        for (;;) {
+            if (inboundHead > 0 && inboundHead == inboundTail) {
+                inboundHead = inboundTail = 0;
+            } else if (inboundHead > inbound.size() / 2) {
+                std::copy(inbound.begin() + inboundHead, inbound.begin() + inboundTail, inbound.begin());
+                inboundTail -= inboundHead;
+                inboundHead = 0;
+            }
+
+            size_t space = inbound.size() - inboundTail;
+            iovec vectors[2] = {{inbound.data() + inboundTail, space}, {extra, sizeof(extra)}};
+            ssize_t count = readv(descriptor, vectors, 2);
+            if (count > 0) {
+                size_t received = static_cast<size_t>(count);
+                if (received <= space) {
+                    inboundTail += received;
+                } else {
+                    inbound.insert(inbound.end(), extra, extra + received - space);
+                    inboundTail = inbound.size();
+                    inbound.resize(inbound.capacity());
+                }
+                if (received < space + sizeof(extra)) {
+                    break;
+                }
+            } else if (count == 0) {
+                fail();
+                break;
+            } else if (errno != EINTR) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    fail();
+                }
+                break;
+            }
+        }
+
+        unsigned int notified = 0;
+        while (maxMessages == 0 || notified < maxMessages) {
+            size_t available = inboundTail - inboundHead;
+            if (available < sizeof(FrameHeader)) {
+                break;
+            }
+            FrameHeader header;
+            memcpy(&header, inbound.data() + inboundHead, sizeof(header));
+            if (header.length & CONTROL) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (header.length & WINDOW) {
+                    resize(header.value);
+                }
+                credit += header.value;
+                inboundHead += sizeof(header);
+                continue;
+            }
+
+            size_t size = sizeof(header) + header.length;
+            if (size > window / 2) {
+                // The peer ignored our window, so the stream can't be trusted
+                fail();
+                break;
+            }
+            if (available < size) {
+                break;
+            }
+
+            const char *data = inbound.data() + inboundHead + sizeof(header);
+            const char *end = data + header.length;
+            Variant message;
+            inboundHead += size;
+            consumed += size;
+            // Undecodable messages are skipped, but still count towards credit
+            if (VariantCodec::decode(data, end, message) && data == end) {
+                notify(header.value, message);
+                notified++;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (consumed >= window / 4) {
+            grant(consumed);
+            consumed = 0;
+        }
+        if (open) {
+            admit();
+            write();
+        }
+        return notified;
+    }
+
+    bool SocketBridge::waitForSocket(std::chrono::milliseconds timeout) {
+        if (hasBuffered()) {
+            return true;
+        }
+        pollfd events = {descriptor, static_cast<short>(POLLIN | (wantsWrite() ? POLLOUT : 0)), 0};
+        int result;
+        do {
+            result = poll(&events, 1, static_cast<int>(timeout.count()));
+        } while (result == -1 && errno == EINTR);
+        return result > 0;
+    }
+
+    bool SocketBridge::hasBuffered() const {
+        size_t available = inboundTail - inboundHead;
+        if (!open || available < sizeof(FrameHeader)) {
+            return false;
+        }
+        FrameHeader header;
+        memcpy(&header, inbound.data() + inboundHead, sizeof(header));
+        // Control frames are only a header. One too large for our window is something to do too, as it fails the
+        // connection.
+        size_t size = sizeof(header) + header.length;
+        return (header.length & CONTROL) || size > window / 2 || available >= size;
+    }
+
+    int SocketBridge::getDescriptor() const {
+        return descriptor;
+    }
+
+    bool SocketBridge::wantsWrite() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return open && (!ready.empty() || (!waiting.empty() && waiting.front().size() <= credit));
+    }
+
+    bool SocketBridge::isOpen() const {
+        return open;
+    }
+
+    size_t SocketBridge::getCredit() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return credit;
+    }
+
+    size_t SocketBridge::getBuffered() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return buffered;
+    }
+
+    unsigned long long SocketBridge::getDropped() const {
+        return dropped;
+    }
+
+    void SocketBridge::processMessage(const Signal signal, const Variant &message) {
+        send(signal, message);
+    }
+
+    std::string &SocketBridge::batchFor(size_t size) {
+        if (waiting.empty() || waiting.back().size() + size > batchSize) {
+            waiting.emplace_back();
+            waiting.back().reserve(std::max(batchSize, size));
+        }
+        return waiting.back();
+    }
+
+    void SocketBridge::resize(size_t window) {
+        peerWindow = window;
+        batchSize = std::min(MAX_BATCH_SIZE, window / 4);
+
+        // Batches made before the peer's window was known may not fit it, so they are made again
+        std::deque<std::string> batches;
+        batches.swap(waiting);
+        for (const std::string &batch : batches) {
+            size_t offset = 0;
+            while (offset < batch.size()) {
+                FrameHeader header;
+                memcpy(&header, batch.data() + offset, sizeof(header));
+                size_t size = sizeof(header) + header.length;
+                if (size > peerWindow / 2) {
+                    buffered -= size;
+                    dropped++;
+                } else {
+                    batchFor(size).append(batch, offset, size);
+                }
+                offset += size;
+            }
+        }
+    }
+
+    void SocketBridge::admit() {
+        while (!waiting.empty() && waiting.front().size() <= credit) {
+            credit -= waiting.front().size();
+            ready.push_back(std::move(waiting.front()));
+            waiting.pop_front();
+        }
+    }
+
+    bool SocketBridge::write() {
+        while (!ready.empty()) {
+            iovec vectors[MAX_VECTORS];
+            int count = 0;
+            size_t offset = readyOffset;
+            for (auto it = ready.begin(); it != ready.end() && count < MAX_VECTORS; ++it) {
+                vectors[count].iov_base = &(*it)[offset];
+                vectors[count].iov_len = it->size() - offset;
+                offset = 0;
+                count++;
+            }
+
+            ssize_t written = gatherWrite(descriptor, vectors, count);
+            if (written == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return true;
+                }
+                fail();
+                return false;
+            }
+
+            size_t remaining = static_cast<size_t>(written);
+            buffered -= remaining;
+            while (remaining > 0) {
+                size_t left = ready.front().size() - readyOffset;
+                if (remaining < left) {
+                    readyOffset += remaining;
+                    break;
+                }
+                remaining -= left;
+                ready.pop_front();
+                readyOffset = 0;
+            }
+        }
+        return true;
+    }
+
+    void SocketBridge::grant(size_t bytes, bool initial) {
+        FrameHeader header = {initial ? CONTROL | WINDOW : CONTROL, static_cast<unsigned int>(bytes)};
+        ready.emplace_back(reinterpret_cast<const char *>(&header), sizeof(header));
+        buffered += sizeof(header);
+    }
+
+    void SocketBridge::fail() {
+        open = false;
+    }
+}
+#endif
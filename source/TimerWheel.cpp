@@ -0,0 +1,254 @@
+#include <algorithm>
+
+#include "include/beammeup/TimerWheel.h"
+
+namespace BeamMeUp {
+    TimerWheel::Timer::Timer() : id(0), tick(0), interval(0), firing(false), cancelled(false), level(0), slot(0),
+                                 previous(nullptr), next(nullptr) {
+    }
+
+    TimerId TimerWheel::Timer::getId() const {
+        return id;
+    }
+
+    bool TimerWheel::Timer::isCancelled() const {
+        return cancelled;
+    }
+
+    TimerWheel::Timer::~Timer() {
+    }
+
+    TimerWheel::TimerWheel(Clock::duration resolution, Clock::time_point origin) :
+            resolution(resolution), origin(origin), current(0), nextId(1) {
+        std::fill(&slots[0][0], &slots[0][0] + (LEVELS + 1) * SLOTS, nullptr);
+        std::fill(counts, counts + LEVELS + 1, 0);
+    }
+
+    TimerId TimerWheel::add(Timer *timer, Clock::time_point due, Clock::duration interval) {
+        // Round up so timers never fire early
+        if (due <= origin) {
+            timer->tick = 0;
+        } else {
+            timer->tick = static_cast<unsigned long long>((due - origin + resolution - Clock::duration(1)) / resolution);
+        }
+        if (interval > Clock::duration::zero()) {
+            timer->interval = std::max<unsigned long long>(
+                    1, static_cast<unsigned long long>((interval + resolution - Clock::duration(1)) / resolution));
+        } else {
+            timer->interval = 0;
+        }
+
+        timer->id = nextId++;
+        timer->firing = false;
+        timer->cancelled = false;
+        timers[timer->id] = timer;
+        insert(timer);
+
+        return timer->id;
+    }
+
+    bool TimerWheel::cancel(TimerId id) {
+        auto it = timers.find(id);
+        if (it == timers.end()) {
+            return false;
+        }
+
+        Timer *timer = it->second;
+        if (timer->firing) {
+            timer->cancelled = true;
+        } else {
+            unlink(timer);
+            timers.erase(it);
+            delete timer;
+        }
+
+        return true;
+    }
+
+    void TimerWheel::cancel(const std::function<bool(Timer *)> &matches) {
+        std::vector<TimerId> ids;
+        for (auto &entry : timers) {
+            if (matches(entry.second)) {
+                ids.push_back(entry.first);
+            }
+        }
+
+        for (auto id : ids) {
+            cancel(id);
+        }
+    }
+
+    void TimerWheel::advance(Clock::time_point now, std::vector<Timer *> &expired) {
+        unsigned long long target = now <= origin ? 0 :
+                                    static_cast<unsigned long long>((now - origin) / resolution);
+
+        expireSlot(LEVELS, 0, expired);
+
+        while (current < target) {
+            size_t scheduled = 0;
+            for (int level = 0; level < LEVELS; ++level) {
+                scheduled += counts[level];
+            }
+            if (scheduled == 0) {
+                current = target;
+                break;
+            }
+
+            // Skip straight over empty level 0 slots, stopping short of the next cascade
+            if (counts[0] == 0 && (current | SLOT_MASK) > current) {
+                current = std::min(target, current | SLOT_MASK);
+                continue;
+            }
+
+            step(expired);
+        }
+    }
+
+    void TimerWheel::finish(Timer *timer) {
+        timer->firing = false;
+
+        if (timer->interval == 0 || timer->cancelled) {
+            timers.erase(timer->id);
+            delete timer;
+            return;
+        }
+
+        // Periodic timers keep their phase, but if we've fallen behind we skip the missed expiries rather than
+        // firing them all at once
+        timer->tick += timer->interval;
+        if (timer->tick <= current) {
+            timer->tick = current + timer->interval;
+        }
+        insert(timer);
+    }
+
+    TimerWheel::Clock::time_point TimerWheel::nextExpiry() const {
+        if (counts[LEVELS] != 0) {
+            return timeOf(current);
+        }
+
+        size_t scheduled = 0;
+        for (int level = 0; level < LEVELS; ++level) {
+            scheduled += counts[level];
+        }
+        if (scheduled == 0) {
+            return Clock::time_point::max();
+        }
+
+        // Timers in the upper levels can't expire before the next cascade, but may expire at it
+        unsigned long long cascade = ((current >> LEVEL_BITS) + 1) << LEVEL_BITS;
+        if (counts[0] != 0) {
+            for (unsigned long long tick = current + 1; tick <= current + SLOTS; ++tick) {
+                if (slots[0][tick & SLOT_MASK] != nullptr) {
+                    return timeOf(scheduled == counts[0] ? tick : std::min(tick, cascade));
+                }
+            }
+        }
+
+        return timeOf(cascade);
+    }
+
+    size_t TimerWheel::size() const {
+        return timers.size();
+    }
+
+    TimerWheel::~TimerWheel() {
+        for (auto &entry : timers) {
+            delete entry.second;
+        }
+    }
+
+    void TimerWheel::insert(Timer *timer) {
+        int level;
+        size_t slot;
+
+        if (timer->tick <= current) {
+            level = LEVELS;
+            slot = 0;
+        } else {
+            unsigned long long delta = timer->tick - current;
+            unsigned long long tick = timer->tick;
+
+            level = 0;
+            while (level < LEVELS - 1 && delta >= (1ULL << (LEVEL_BITS * (level + 1)))) {
+                level++;
+            }
+            if (delta >= (1ULL << (LEVEL_BITS * LEVELS))) {
+                // Too far out for the wheel. Park it in the furthest slot; it'll be re-filed when that cascades.
+                tick = current + (1ULL << (LEVEL_BITS * LEVELS)) - 1;
+            }
+            slot = (tick >> (LEVEL_BITS * level)) & SLOT_MASK;
+        }
+
+        timer->level = level;
+        timer->slot = slot;
+        timer->previous = nullptr;
+        timer->next = slots[level][slot];
+        if (timer->next != nullptr) {
+            timer->next->previous = timer;
+        }
+        slots[level][slot] = timer;
+        counts[level]++;
+    }
+
+    void TimerWheel::unlink(Timer *timer) {
+        if (timer->previous != nullptr) {
+            timer->previous->next = timer->next;
+        } else {
+            slots[timer->level][timer->slot] = timer->next;
+        }
+        if (timer->next != nullptr) {
+            timer->next->previous = timer->previous;
+        }
+        timer->previous = nullptr;
+        timer->next = nullptr;
+        counts[timer->level]--;
+    }
+
+    void TimerWheel::step(std::vector<Timer *> &expired) {
+        current++;
+
+        // Cascade each level whose slot has just come round, lowest first
+        for (int level = 1; level < LEVELS; ++level) {
+            if ((current & ((1ULL << (LEVEL_BITS * level)) - 1)) != 0) {
+                break;
+            }
+
+            size_t slot = (current >> (LEVEL_BITS * level)) & SLOT_MASK;
+            Timer *timer = slots[level][slot];
+            slots[level][slot] = nullptr;
+            while (timer != nullptr) {
+                Timer *next = timer->next;
+                counts[level]--;
+                insert(timer);
+                timer = next;
+            }
+        }
+
+        expireSlot(0, current & SLOT_MASK, expired);
+        // A cascaded timer due exactly now lands in the overdue list
+        expireSlot(LEVELS, 0, expired);
+    }
+
+    void TimerWheel::expireSlot(int level, size_t slot, std::vector<Timer *> &expired) {
+        Timer *timer = slots[level][slot];
+        slots[level][slot] = nullptr;
+
+        // Slots are built by pushing to the front, so collect in reverse to expire in the order added
+        size_t first = expired.size();
+        while (timer != nullptr) {
+            Timer *next = timer->next;
+            counts[level]--;
+            timer->previous = nullptr;
+            timer->next = nullptr;
+            timer->firing = true;
+            expired.push_back(timer);
+            timer = next;
+        }
+        std::reverse(expired.begin() + first, expired.end());
+    }
+
+    TimerWheel::Clock::time_point TimerWheel::timeOf(unsigned long long tick) const {
+        return origin + resolution * static_cast<Clock::rep>(tick);
+    }
+}
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "include/beammeup/NamedSignal.h"
+#include "include/beammeup/Topic.h"
+
+namespace BeamMeUp {
+    static const char SEPARATOR = '.';
+    static const char *ANY_LEVEL = "*";
+    static const char *ANY_LEVELS = "#";
+
+    /**
+     * @param topic The topic or pattern
+     * @return Its levels
+     */
+    static std::vector<std::string> split(const std::string &topic) {
+        std::vector<std::string> levels;
+        size_t start = 0;
+        while (true) {
+            size_t end = topic.find(SEPARATOR, start);
+            if (end == std::string::npos) {
+                levels.push_back(topic.substr(start));
+                return levels;
+            }
+            levels.push_back(topic.substr(start, end - start));
+            start = end + 1;
+        }
+    }
+
+    Signal topicSignal(const std::string &topic) {
+        return signalHash(topic.data(), topic.size());
+    }
+
+    bool isTopicPattern(const std::string &topic) {
+        for (const std::string &level : split(topic)) {
+            if (level == ANY_LEVEL || level == ANY_LEVELS) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    TopicTrie::TopicTrie() : subscriptionCount(0) {
+    }
+
+    bool TopicTrie::addTopic(const std::string &topic) {
+        if (isTopicPattern(topic)) {
+            throw std::runtime_error("Topics can't contain wildcards");
+        }
+
+        Node *node = insert(topic);
+        if (node->isTopic) {
+            return false;
+        }
+
+        node->isTopic = true;
+        return true;
+    }
+
+    void TopicTrie::addSubscription(const std::string &pattern, const Subscription &subscription) {
+        validatePattern(pattern);
+        insert(pattern)->subscriptions.push_back(subscription);
+        subscriptionCount++;
+    }
+
+    size_t TopicTrie::removeSubscriptions(const std::string &pattern, const SubscriptionMatcher &matcher) {
+        std::vector<std::string> levels = split(pattern);
+        std::vector<Node *> path = {&root};
+        for (const std::string &level : levels) {
+            auto child = path.back()->children.find(level);
+            if (child == path.back()->children.end()) {
+                return 0;
+            }
+            path.push_back(child->second.get());
+        }
+
+        Node *node = path.back();
+        size_t before = node->subscriptions.size();
+        node->subscriptions.erase(std::remove_if(node->subscriptions.begin(), node->subscriptions.end(), matcher),
+                                  node->subscriptions.end());
+        size_t removed = before - node->subscriptions.size();
+        subscriptionCount -= removed;
+
+        // Drop the pattern's nodes once nothing is left in them, so patterns that come and go don't pile up
+        for (size_t i = levels.size(); i > 0 && path[i]->isEmpty(); --i) {
+            path[i - 1]->children.erase(levels[i - 1]);
+        }
+        return removed;
+    }
+
+    size_t TopicTrie::removeSubscriptions(const SubscriptionMatcher &matcher) {
+        size_t removed = removeSubscriptions(&root, matcher);
+        subscriptionCount -= removed;
+        return removed;
+    }
+
+    size_t TopicTrie::getSubscriptionCount() const {
+        return subscriptionCount;
+    }
+
+    void TopicTrie::matchSubscriptions(const std::string &topic,
+                                       const std::function<void(const Subscription &subscription)> &visitor) const {
+        matchSubscriptions(&root, split(topic), 0, visitor);
+    }
+
+    bool TopicTrie::hasSubscription(const std::string &topic, const SubscriptionMatcher &matcher) const {
+        bool found = false;
+        matchSubscriptions(topic, [&matcher, &found](const Subscription &subscription) {
+            found = found || matcher(subscription);
+        });
+        return found;
+    }
+
+    void TopicTrie::matchTopics(const std::string &pattern,
+                                const std::function<void(const std::string &topic)> &visitor) const {
+        std::string path;
+        matchTopics(&root, split(pattern), 0, path, visitor);
+    }
+
+    void TopicTrie::validatePattern(const std::string &pattern) {
+        std::vector<std::string> levels = split(pattern);
+        for (size_t i = 0; i + 1 < levels.size(); ++i) {
+            if (levels[i] == ANY_LEVELS) {
+                throw std::runtime_error("'#' must be the last level of a topic pattern");
+            }
+        }
+    }
+
+    TopicTrie::Node *TopicTrie::insert(const std::string &topic) {
+        Node *node = &root;
+        for (const std::string &level : split(topic)) {
+            std::unique_ptr<Node> &child = node->children[level];
+            if (child == nullptr) {
+                child.reset(new Node());
+            }
+            node = child.get();
+        }
+
+        return node;
+    }
+
+    void TopicTrie::matchSubscriptions(const Node *node, const std::vector<std::string> &levels, size_t level,
+                                       const std::function<void(const Subscription &subscription)> &visitor) {
+        // "#" matches whatever is left, including nothing
+        auto child = node->children.find(ANY_LEVELS);
+        if (child != node->children.end()) {
+            for (const Subscription &subscription : child->second->subscriptions) {
+                visitor(subscription);
+            }
+        }
+
+        if (level == levels.size()) {
+            for (const Subscription &subscription : node->subscriptions) {
+                visitor(subscription);
+            }
+            return;
+        }
+
+        child = node->children.find(levels[level]);
+        if (child != node->children.end()) {
+            matchSubscriptions(child->second.get(), levels, level + 1, visitor);
+        }
+        child = node->children.find(ANY_LEVEL);
+        if (child != node->children.end()) {
+            matchSubscriptions(child->second.get(), levels, level + 1, visitor);
+        }
+    }
+
+    void TopicTrie::matchTopics(const Node *node, const std::vector<std::string> &levels, size_t level,
+                                std::string &path, const std::function<void(const std::string &topic)> &visitor) {
+        if (level == levels.size()) {
+            if (node->isTopic) {
+                visitor(path);
+            }
+            return;
+        }
+
+        if (levels[level] == ANY_LEVELS) {
+            visitTopics(node, level, path, visitor);
+            return;
+        }
+
+        size_t length = path.size();
+        for (auto &child : node->children) {
+            if (levels[level] != ANY_LEVEL && child.first != levels[level]) {
+                continue;
+            }
+            if (level > 0) {
+                path += SEPARATOR;
+            }
+            path += child.first;
+            matchTopics(child.second.get(), levels, level + 1, path, visitor);
+            path.resize(length);
+        }
+    }
+
+    void TopicTrie::visitTopics(const Node *node, size_t depth, std::string &path,
+                                const std::function<void(const std::string &topic)> &visitor) {
+        if (node->isTopic) {
+            visitor(path);
+        }
+
+        size_t length = path.size();
+        for (auto &child : node->children) {
+            if (depth > 0) {
+                path += SEPARATOR;
+            }
+            path += child.first;
+            visitTopics(child.second.get(), depth + 1, path, visitor);
+            path.resize(length);
+        }
+    }
+
+    size_t TopicTrie::removeSubscriptions(Node *node, const SubscriptionMatcher &matcher) {
+        size_t before = node->subscriptions.size();
+        node->subscriptions.erase(std::remove_if(node->subscriptions.begin(), node->subscriptions.end(), matcher),
+                                  node->subscriptions.end());
+        size_t removed = before - node->subscriptions.size();
+        for (auto child = node->children.begin(); child != node->children.end();) {
+            removed += removeSubscriptions(child->second.get(), matcher);
+            if (child->second->isEmpty()) {
+                child = node->children.erase(child);
+            } else {
+                ++child;
+            }
+        }
+
+        return removed;
+    }
+}
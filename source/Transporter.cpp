@@ -1,56 +1,824 @@
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "include/beammeup/Epoch.h"
 #include "include/beammeup/Receiver.h"
 #include "include/beammeup/Signaler.h"
 #include "include/beammeup/Transporter.h"
 
 namespace BeamMeUp {
-    Transporter::Transporter() : Signaler(this) {
+#ifdef THREAD_SAFE
+    const unsigned int Transporter::MIN_SPIN = 16;
+    const unsigned int Transporter::MAX_SPIN = 16384;
+#endif
+
+    // Taken entries are erased from the front of the ready list once there are at least this many
+    static const size_t READY_COMPACT_SIZE = 1024;
+#ifdef THREAD_SAFE
+
+    /**
+     * Tells the CPU we're in a spin loop so it can back off and free resources for the sibling hyperthread
+     */
+    static inline void spinPause() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+#endif
+
+    /**
+     * Timer that notifies from a signaler when it expires
+     */
+    class SignalTimer : public TimerWheel::Timer {
+    public:
+        SignalTimer(Signaler *signaler, Signal signal, const Variant &message) :
+                signaler(signaler), signal(signal), message(message) {
+        }
+
+        void expire() override {
+            signaler->notify(signal, message);
+        }
+
+        Signaler *signaler;
+        Signal signal;
+        Variant message;
+    };
+
+    /**
+     * Timer that times out a request when it expires
+     */
+    class RequestTimer : public TimerWheel::Timer {
+    public:
+        RequestTimer(Transporter *transporter, RequestId request) : transporter(transporter), request(request) {
+        }
+
+        void expire() override;
+
+        Transporter *transporter;
+        RequestId request;
+    };
+
+    Transporter::Transporter() : Signaler(this), pendingMessages(0), eventDescriptor(-1), eventWriteDescriptor(-1) {
+        readyHead = 0;
+        nextTimerExpiry = std::chrono::steady_clock::time_point::max().time_since_epoch().count();
+        nextRequestId = 1;
+        hasCompletedRequests = false;
+        quiesced = false;
+#ifdef THREAD_SAFE
+        processors = 0;
+        waiters = 0;
+        spinLimit = MIN_SPIN;
+        wakeRequested = false;
+        wakeGeneration = 0;
+#endif
+    }
+
+    Transporter::~Transporter() {
+#ifndef _WIN32
+        if (eventDescriptor != -1) {
+            close(eventDescriptor);
+            if (eventWriteDescriptor != eventDescriptor) {
+                close(eventWriteDescriptor);
+            }
+        }
+#endif
     }
 
+    /**
+     * Counts a processMessages call as under way for as long as it is in scope, unless the transporter is quiesced
+     */
+    class Transporter::ProcessingScope {
+    public:
+        ProcessingScope(Transporter *transporter) : transporter(transporter) {
+#ifdef THREAD_SAFE
+            // Counted before checking, so quiesce either sees us or we see it
+            transporter->processors++;
+            started = !transporter->quiesced;
+            if (!started) {
+                transporter->processors--;
+            } else {
+                active.push_back(transporter);
+            }
+#else
+            started = !transporter->quiesced;
+#endif
+        }
+
+        ~ProcessingScope() {
+#ifdef THREAD_SAFE
+            if (started) {
+                active.pop_back();
+                transporter->processors--;
+            }
+#endif
+        }
+
+#ifdef THREAD_SAFE
+        /**
+         * @param transporter A transporter
+         * @return The number of processMessages calls under way for it on this thread, so quiesce called from a
+         * handler doesn't wait for itself
+         */
+        static unsigned int countOnThisThread(const Transporter *transporter) {
+            return static_cast<unsigned int>(std::count(active.begin(), active.end(), transporter));
+        }
+#endif
+
+        Transporter *transporter;
+        bool started;
+#ifdef THREAD_SAFE
+        // The transporters with a processMessages call under way on this thread, innermost last
+        static thread_local std::vector<const Transporter *> active;
+#endif
+    };
+
+#ifdef THREAD_SAFE
+    thread_local std::vector<const Transporter *> Transporter::ProcessingScope::active;
+#endif
+
     void Transporter::processMessages() {
-        ObjectSet *workingObjects;
+        ProcessingScope scope(this);
+        if (!scope.started) {
+            return;
+        }
+
+        fireTimers();
+
+        // Only the receivers that were ready when we started, so ones that keep getting messages can't hold us here
+        size_t count = getReadyCount();
+        for (size_t i = 0; i < count; ++i) {
+            ReadyReceiver ready;
+            if (!popReady(ready)) {
+                break;
+            }
+            processReady(ready, 0, std::chrono::steady_clock::time_point::max());
+        }
+
+        processReplies();
+    }
+
+    bool Transporter::processMessages(unsigned int maxMessages, std::chrono::steady_clock::duration timeLimit) {
+        ProcessingScope scope(this);
+        if (!scope.started) {
+            return hasPendingMessages();
+        }
+
+        auto deadline = std::chrono::steady_clock::time_point::max();
+        if (timeLimit > std::chrono::steady_clock::duration::zero()) {
+            deadline = std::chrono::steady_clock::now() + timeLimit;
+        }
+
+        fireTimers();
+
+        unsigned int processed = 0;
+        // Number of consecutive visits that found nothing to do. Once every ready receiver has been visited without
+        // doing any work, the rest are being processed by other threads.
+        size_t idleVisits = 0;
+
+        ReadyReceiver ready;
+        while (popReady(ready)) {
+            // Each visit processes one message and puts the receiver back at the end if it has more
+            int count = processReady(ready, 1, deadline);
+            if (count == 0) {
+                if (++idleVisits > getReadyCount()) {
+                    break;
+                }
+                continue;
+            }
+
+            // The budget is only checked after doing some work so that every call makes progress
+            processed += count;
+            idleVisits = 0;
+            if ((maxMessages != 0 && processed >= maxMessages) ||
+                (deadline != std::chrono::steady_clock::time_point::max() &&
+                 std::chrono::steady_clock::now() >= deadline)) {
+                break;
+            }
+        }
+
+        processReplies();
+
+        return hasPendingMessages();
+    }
+
+    bool Transporter::hasPendingMessages() {
+        return pendingMessages != 0;
+    }
 
+    size_t Transporter::getReadyCount() {
 #ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(readyMutex);
+#endif
+        return readyReceivers.size() - readyHead;
+    }
+
+    bool Transporter::waitForMessages(std::chrono::steady_clock::duration timeout) {
+        if (isWorkReady()) {
+            return true;
+        }
+
+        auto deadline = std::chrono::steady_clock::time_point::max();
+        if (timeout != std::chrono::steady_clock::duration::max()) {
+            deadline = std::chrono::steady_clock::now() + timeout;
+        }
+
+#ifdef THREAD_SAFE
+        // Spin first: if a message turns up within a few microseconds this is much cheaper than sleeping. Grow the
+        // spin when it succeeds and shrink it when it doesn't, so idle loops quickly settle on sleeping.
+        unsigned int spins = spinLimit;
+        for (unsigned int i = 0; i < spins; ++i) {
+            if (hasPendingMessages()) {
+                spinLimit = std::min(spins * 2, MAX_SPIN);
+                return true;
+            }
+            spinPause();
+        }
+        spinLimit = std::max(spins / 2, MIN_SPIN);
+
+        std::unique_lock<std::mutex> lock(waitMutex);
+        // Producers only take waitMutex when they see a waiter, so the count has to be raised before the final check
+        // of pendingMessages
+        ++waiters;
+        // A wakeUp that arrives before we park is kept in wakeRequested; one that arrives while others are parked
+        // too bumps the generation, so every waiter leaves even though only one consumes the request
+        unsigned long generation = wakeGeneration;
+        while (!isWorkReady() && !wakeRequested && generation == wakeGeneration) {
+            // Wake for the next timer too. Scheduling an earlier one wakes us so we can shorten the wait.
+            auto wake = std::min(deadline, getNextTimerExpiry());
+            if (wake == std::chrono::steady_clock::time_point::max()) {
+                waitCondition.wait(lock);
+            } else if (waitCondition.wait_until(lock, wake) == std::cv_status::timeout &&
+                       std::chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+        }
+        --waiters;
+        wakeRequested = false;
+#else
+        auto wake = std::min(deadline, getNextTimerExpiry());
+        if (wake != std::chrono::steady_clock::time_point::max()) {
+            std::this_thread::sleep_until(wake);
+        }
+#endif
+        return isWorkReady();
+    }
+
+    void Transporter::quiesce() {
+        quiesced = true;
+#ifdef THREAD_SAFE
+        unsigned int own = ProcessingScope::countOnThisThread(this);
+        while (processors != own) {
+            std::this_thread::yield();
+        }
+#endif
+    }
+
+    void Transporter::resume() {
+        quiesced = false;
+    }
+
+    bool Transporter::isQuiesced() const {
+        return quiesced;
+    }
+
+    void Transporter::wakeUp() {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(waitMutex);
+        // Sticky, so a thread that has checked for work but not yet parked still sees it
+        wakeRequested = true;
+        ++wakeGeneration;
+        waitCondition.notify_all();
+#endif
+    }
+
+    int Transporter::openEventDescriptor() {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(waitMutex);
+#endif
+        if (eventDescriptor != -1) {
+            return eventDescriptor;
+        }
+
+#if defined(__linux__)
+        int descriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (descriptor == -1) {
+            return -1;
+        }
+        eventWriteDescriptor = descriptor;
+#elif !defined(_WIN32)
+        int descriptors[2];
+        if (pipe(descriptors) == -1) {
+            return -1;
+        }
+        for (auto descriptor : descriptors) {
+            fcntl(descriptor, F_SETFL, fcntl(descriptor, F_GETFL) | O_NONBLOCK);
+            fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+        }
+        int descriptor = descriptors[0];
+        eventWriteDescriptor = descriptors[1];
+#else
+        int descriptor = -1;
+#endif
+        eventDescriptor = descriptor;
+
+        // Messages may already be waiting
+        if (hasPendingMessages()) {
+            setEventDescriptor();
+        }
+
+        return descriptor;
+    }
+
+    std::chrono::steady_clock::time_point Transporter::getNextTimerExpiry() {
+        return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(nextTimerExpiry));
+    }
+
+    TimerId Transporter::scheduleTimer(Signaler *signaler, Signal signal, const Variant &message,
+                                       std::chrono::steady_clock::time_point due,
+                                       std::chrono::steady_clock::duration interval) {
+        return addTimer(new SignalTimer(signaler, signal, message), due, interval);
+    }
+
+    TimerId Transporter::addTimer(TimerWheel::Timer *timer, std::chrono::steady_clock::time_point due,
+                                  std::chrono::steady_clock::duration interval) {
+        TimerId id;
+        bool earlier;
         {
-            std::shared_lock<std::shared_timed_mutex> lock(mutex);
-            workingObjects = new ObjectSet(objects);
+#ifdef THREAD_SAFE
+            std::unique_lock<std::mutex> lock(timerMutex);
+#endif
+            id = timers.add(timer, due, interval);
+            earlier = due.time_since_epoch().count() < nextTimerExpiry;
+            if (earlier) {
+                nextTimerExpiry = due.time_since_epoch().count();
+            }
         }
-        bool checkRegistered = true;
+
+#ifdef THREAD_SAFE
+        // Waiters may be sleeping until a later timer
+        if (earlier && waiters != 0) {
+            std::unique_lock<std::mutex> lock(waitMutex);
+            waitCondition.notify_all();
+        }
+#endif
+
+        return id;
+    }
+
+    bool Transporter::unscheduleTimer(TimerId id) {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(timerMutex);
+#endif
+        bool cancelled = timers.cancel(id);
+        updateNextTimerExpiry();
+        return cancelled;
+    }
+
+    void Transporter::unscheduleTimers(Signaler *signaler) {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(timerMutex);
+#endif
+        auto matches = [signaler](TimerWheel::Timer *timer) {
+            auto signalTimer = dynamic_cast<SignalTimer *>(timer);
+            return signalTimer != nullptr && signalTimer->signaler == signaler;
+        };
+        timers.cancel(matches);
+        updateNextTimerExpiry();
+
+#ifdef THREAD_SAFE
+        // Cancelling only flags a timer that is expiring, so wait until none of ours is still notifying on another
+        // thread. One expiring on this thread is what is destroying the signaler, and has nothing left to do with it.
+        auto self = std::this_thread::get_id();
+        timerCondition.wait(lock, [this, &matches, self]() {
+            for (auto &expiring : expiringTimers) {
+                if (expiring.second != self && matches(expiring.first)) {
+                    return false;
+                }
+            }
+            return true;
+        });
+#endif
+    }
+
+#ifdef THREAD_SAFE
+    RequestId Transporter::startRequest(Signaler *requester, const ReplyCallback &callback,
+                                        const std::shared_ptr<std::promise<Variant>> &promise,
+                                        std::chrono::steady_clock::duration timeout) {
 #else
-        workingObjects = &objects;
-        bool checkRegistered = false;
+    RequestId Transporter::startRequest(Signaler *requester, const ReplyCallback &callback,
+                                        std::chrono::steady_clock::duration timeout) {
+#endif
+        RequestId id = nextRequestId++;
+
+        PendingRequest request;
+        request.requester = requester;
+        request.callback = callback;
+#ifdef THREAD_SAFE
+        request.promise = promise;
+#endif
+        request.timer = 0;
+        {
+#ifdef THREAD_SAFE
+            std::unique_lock<std::mutex> lock(requestMutex);
+#endif
+            requests[id] = request;
+        }
+
+        if (timeout > std::chrono::steady_clock::duration::zero()) {
+            // The timer is added without holding requestMutex, so the request may complete before we record it
+            TimerId timer = addTimer(new RequestTimer(this, id), std::chrono::steady_clock::now() + timeout,
+                                     std::chrono::steady_clock::duration::zero());
+            bool pending;
+            {
+#ifdef THREAD_SAFE
+                std::unique_lock<std::mutex> lock(requestMutex);
+#endif
+                auto it = requests.find(id);
+                pending = it != requests.end();
+                if (pending) {
+                    it->second.timer = timer;
+                }
+            }
+            if (!pending) {
+                unscheduleTimer(timer);
+            }
+        }
+
+        return id;
+    }
+
+    bool Transporter::completeRequest(RequestId id, ReplyStatus status, const Variant &reply) {
+        PendingRequest request;
+        {
+#ifdef THREAD_SAFE
+            std::unique_lock<std::mutex> lock(requestMutex);
+#endif
+            auto it = requests.find(id);
+            if (it == requests.end()) {
+                return false;
+            }
+            request = it->second;
+            requests.erase(it);
+        }
+
+        // An expiring timer is removed by the wheel once it has fired
+        if (request.timer != 0 && status != RS_TIMEOUT) {
+            unscheduleTimer(request.timer);
+        }
+
+#ifdef THREAD_SAFE
+        if (request.promise != nullptr) {
+            switch (status) {
+                case RS_OK:
+                    request.promise->set_value(reply);
+                    break;
+                case RS_TIMEOUT:
+                    request.promise->set_exception(std::make_exception_ptr(std::runtime_error("Request timed out")));
+                    break;
+                case RS_CANCELLED:
+                    request.promise->set_exception(std::make_exception_ptr(std::runtime_error("Request cancelled")));
+                    break;
+                case RS_NO_RECEIVER:
+                    request.promise->set_exception(
+                            std::make_exception_ptr(std::runtime_error("No receiver for request")));
+                    break;
+            }
+        }
+#endif
+
+        if (request.callback) {
+            CompletedRequest completed;
+            completed.requester = request.requester;
+            completed.callback = request.callback;
+            completed.status = status;
+            completed.reply = reply;
+            {
+#ifdef THREAD_SAFE
+                std::unique_lock<std::mutex> lock(requestMutex);
 #endif
+                completedRequests.push_back(completed);
+                hasCompletedRequests = true;
+            }
+            // Counted as pending so that waitForMessages and the event descriptor see it
+            messagesQueued(1);
+        }
+
+        return true;
+    }
+
+    void Transporter::cancelRequests(Signaler *requester) {
+        std::vector<TimerId> requestTimers;
+        size_t discarded = 0;
+        {
+#ifdef THREAD_SAFE
+            std::unique_lock<std::mutex> lock(requestMutex);
+#endif
+            for (auto it = requests.begin(); it != requests.end();) {
+                if (it->second.requester == requester) {
+#ifdef THREAD_SAFE
+                    if (it->second.promise != nullptr) {
+                        it->second.promise->set_exception(
+                                std::make_exception_ptr(std::runtime_error("Request cancelled")));
+                    }
+#endif
+                    if (it->second.timer != 0) {
+                        requestTimers.push_back(it->second.timer);
+                    }
+                    it = requests.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            // The callbacks of completed requests may refer to the requester, so they can't be called now either
+            for (auto it = completedRequests.begin(); it != completedRequests.end();) {
+                if (it->requester == requester) {
+                    it = completedRequests.erase(it);
+                    discarded++;
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        for (auto timer : requestTimers) {
+            unscheduleTimer(timer);
+        }
+        if (discarded != 0) {
+            messagesDequeued(discarded);
+        }
+    }
+
+    void Transporter::processReplies() {
+        if (!hasCompletedRequests) {
+            return;
+        }
+
+        std::deque<CompletedRequest> completed;
+        {
+#ifdef THREAD_SAFE
+            std::unique_lock<std::mutex> lock(requestMutex);
+#endif
+            completed.swap(completedRequests);
+            hasCompletedRequests = false;
+        }
+
+        for (auto &request : completed) {
+            messagesDequeued(1);
+            request.callback(request.status, request.reply);
+        }
+    }
+
+    void RequestTimer::expire() {
+        transporter->completeRequest(request, RS_TIMEOUT, Variant());
+    }
+
+    void Transporter::fireTimers() {
+        if (nextTimerExpiry == std::chrono::steady_clock::time_point::max().time_since_epoch().count()) {
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now.time_since_epoch().count() < nextTimerExpiry) {
+            return;
+        }
+
+        std::vector<TimerWheel::Timer *> expired;
+        {
+#ifdef THREAD_SAFE
+            std::unique_lock<std::mutex> lock(timerMutex);
+#endif
+            timers.advance(now, expired);
+            if (expired.empty()) {
+                updateNextTimerExpiry();
+                return;
+            }
+        }
 
-        for (auto object : *workingObjects) {
-            // Verify the object is still registered. It could have been deleted and
-            // then this would crash.
-            if (!checkRegistered || isObjectRegistered(object)) {
-                object->processMessages();
+        // Expire outside of the lock. The timers can't be deleted from under us: cancelling a timer that is
+        // expiring only flags it. An earlier timer in the batch may destroy the target of a later one, which cancels
+        // it, so check each one just before expiring it. A timer is listed as expiring from that check until it
+        // returns, so that destroying its signaler on another thread waits for it.
+        for (auto timer : expired) {
+            {
+#ifdef THREAD_SAFE
+                std::unique_lock<std::mutex> lock(timerMutex);
+#endif
+                if (timer->isCancelled()) {
+                    continue;
+                }
+#ifdef THREAD_SAFE
+                expiringTimers.emplace_back(timer, std::this_thread::get_id());
+#endif
             }
+#ifdef THREAD_SAFE
+            try {
+                timer->expire();
+            } catch (...) {
+                endExpiry(timer);
+                throw;
+            }
+            endExpiry(timer);
+#else
+            timer->expire();
+#endif
         }
 
 #ifdef THREAD_SAFE
-        delete workingObjects;
+        std::unique_lock<std::mutex> lock(timerMutex);
+#endif
+        for (auto timer : expired) {
+            timers.finish(timer);
+        }
+        updateNextTimerExpiry();
+    }
+
+#ifdef THREAD_SAFE
+    void Transporter::endExpiry(TimerWheel::Timer *timer) {
+        std::unique_lock<std::mutex> lock(timerMutex);
+        for (auto it = expiringTimers.begin(); it != expiringTimers.end(); ++it) {
+            if (it->first == timer) {
+                expiringTimers.erase(it);
+                break;
+            }
+        }
+        timerCondition.notify_all();
+    }
+#endif
+
+    void Transporter::updateNextTimerExpiry() {
+        nextTimerExpiry = timers.nextExpiry().time_since_epoch().count();
+    }
+
+    bool Transporter::isWorkReady() {
+        return hasPendingMessages() ||
+               std::chrono::steady_clock::now().time_since_epoch().count() >= nextTimerExpiry;
+    }
+
+    void Transporter::setEventDescriptor() {
+#if defined(__linux__)
+        eventfd_write(eventWriteDescriptor, 1);
+#elif !defined(_WIN32)
+        char byte = 0;
+        // A full pipe is already readable so a failed write doesn't matter
+        ssize_t ignored = write(eventWriteDescriptor, &byte, sizeof(byte));
+        (void)ignored;
+#endif
+    }
+
+    void Transporter::resetEventDescriptor() {
+#if defined(__linux__)
+        eventfd_t value;
+        eventfd_read(eventDescriptor, &value);
+#elif !defined(_WIN32)
+        char buffer[64];
+        while (read(eventDescriptor, buffer, sizeof(buffer)) > 0) {
+        }
 #endif
+        // A message may have been queued between the count reaching zero and the reset above, in which case its
+        // wake up was just swallowed
+        if (hasPendingMessages()) {
+            setEventDescriptor();
+        }
     }
 
     void Transporter::registerObject(Receiver *object) {
 #ifdef THREAD_SAFE
         std::unique_lock<std::shared_timed_mutex> lock(mutex);
 #endif
-        objects.insert(object);
+        if (objects.insert(object).second) {
+            object->handle = handles.add(object);
+        }
     }
 
     void Transporter::unregisterObject(Receiver *object) {
 #ifdef THREAD_SAFE
         std::unique_lock<std::shared_timed_mutex> lock(mutex);
 #endif
-        objects.erase(object);
+        // Any entry it has on the ready list is skipped once the handle is removed
+        if (objects.erase(object) != 0) {
+            handles.remove(object->handle);
+        }
     }
 
     bool Transporter::isObjectRegistered(Receiver *object) {
 #ifdef THREAD_SAFE
         std::shared_lock<std::shared_timed_mutex> lock(mutex);
 #endif
-    return objects.find(object) != objects.end();
+        return objects.find(object) != objects.end();
+    }
+
+    void Transporter::receiverReady(Receiver *receiver) {
+        pushReady({receiver, receiver->handle});
+    }
+
+    bool Transporter::popReady(ReadyReceiver &ready) {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(readyMutex);
+#endif
+        if (readyHead == readyReceivers.size()) {
+            return false;
+        }
+
+        ready = readyReceivers[readyHead++];
+        if (readyHead == readyReceivers.size()) {
+            readyReceivers.clear();
+            readyHead = 0;
+        } else if (readyHead >= READY_COMPACT_SIZE && readyHead * 2 >= readyReceivers.size()) {
+            readyReceivers.erase(readyReceivers.begin(), readyReceivers.begin() + readyHead);
+            readyHead = 0;
+        }
+        return true;
+    }
+
+    void Transporter::pushReady(const ReadyReceiver &ready) {
+#ifdef THREAD_SAFE
+        std::unique_lock<std::mutex> lock(readyMutex);
+#endif
+        readyReceivers.push_back(ready);
+    }
+
+    int Transporter::processReady(const ReadyReceiver &ready, unsigned int maxMessages,
+                                  const std::chrono::steady_clock::time_point &deadline) {
+        // Verify the receiver is still registered and claim it. It could have been deleted and then this would
+        // crash. The guard keeps it from being destroyed until it is claimed; after that its destructor waits for the
+        // claim to be released, so the guard needn't be held while its handlers run.
+        {
+            Epoch::Guard guard;
+            if (!handles.isValid(ready.handle)) {
+                return 0;
+            }
+            if (!ready.receiver->claim()) {
+                // Another thread is processing it. Make sure it isn't left off the list with messages waiting.
+                if (ready.receiver->rearm()) {
+                    pushReady(ready);
+                }
+                return 0;
+            }
+        }
+
+        int count;
+        try {
+            count = ready.receiver->processClaimed(maxMessages, deadline);
+        } catch (...) {
+            // Put it back on the list if messages are left, or nothing would ever process them
+            bool again = ready.receiver->rearm();
+            ready.receiver->release();
+            if (again) {
+                pushReady(ready);
+            }
+            throw;
+        }
+        // Rearmed before releasing, as the receiver may be destroyed as soon as it is released
+        bool again = ready.receiver->rearm();
+        ready.receiver->release();
+        if (again) {
+            pushReady(ready);
+        }
+        return count;
+    }
+
+    void Transporter::messagesQueued(size_t count) {
+#ifdef THREAD_SAFE
+        size_t previous = pendingMessages.fetch_add(count);
+#else
+        size_t previous = pendingMessages;
+        pendingMessages += count;
+#endif
+        if (previous == 0 && eventDescriptor != -1) {
+            setEventDescriptor();
+        }
+
+#ifdef THREAD_SAFE
+        if (waiters != 0) {
+            std::unique_lock<std::mutex> lock(waitMutex);
+            waitCondition.notify_all();
+        }
+#endif
+    }
+
+    void Transporter::messagesDequeued(size_t count) {
+        if (count == 0) {
+            return;
+        }
+
+#ifdef THREAD_SAFE
+        size_t previous = pendingMessages.fetch_sub(count);
+#else
+        size_t previous = pendingMessages;
+        pendingMessages -= count;
+#endif
+        if (previous == count && eventDescriptor != -1) {
+            resetEventDescriptor();
+        }
     }
 }
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cmath>
 #include <sstream>
+#include <utility>
 
 #include "include/beammeup/ArbitraryPointer.h"
 #include "include/beammeup/Variant.h"
@@ -315,6 +316,16 @@ namespace BeamMeUp {
         return data == "true" || numericCast<bool>();
     }
 
+    const Variant *Variant::find(const std::string &key) const {
+        if (type != D_VARIANTMAP || data == nullptr) {
+            return nullptr;
+        }
+
+        const VariantMap *map = static_cast<const VariantMap *>(data);
+        auto it = map->find(key);
+        return it == map->end() ? nullptr : &it->second;
+    }
+
     const bool Variant::isNull() const {
         return type == D_NULL || data == nullptr;
     }
@@ -578,6 +589,12 @@ namespace BeamMeUp {
         return (*this == value || (*this) < value);
     }
 
+    void Variant::swap(Variant &value) {
+        std::swap(data, value.data);
+        std::swap(deleteData, value.deleteData);
+        std::swap(type, value.type);
+    }
+
     const DataType Variant::getType() const {
         return type;
     }
@@ -0,0 +1,374 @@
+#include <cstring>
+
+#include "include/beammeup/Variant.h"
+#include "include/beammeup/VariantCodec.h"
+#include "include/beammeup/VariantMap.h"
+#include "include/beammeup/VariantVector.h"
+
+namespace BeamMeUp {
+    // Containers nested deeper than this are rejected when decoding, so malformed input can't exhaust the stack
+    static const unsigned int MAX_DEPTH = 64;
+
+    static inline unsigned long long zigzag(long long value) {
+        return (static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63);
+    }
+
+    static inline long long unzigzag(unsigned long long value) {
+        return static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+    }
+
+    static inline size_t stringSize(const std::string &value) {
+        return VariantCodec::varintSize(value.size()) + value.size();
+    }
+
+    static inline char *encodeString(const std::string &value, char *out) {
+        out = VariantCodec::encodeVarint(value.size(), out);
+        memcpy(out, value.data(), value.size());
+        return out + value.size();
+    }
+
+    static bool decodeString(const char *&data, const char *end, std::string &value) {
+        unsigned long long length;
+        if (!VariantCodec::decodeVarint(data, end, length) || length > static_cast<unsigned long long>(end - data)) {
+            return false;
+        }
+        value.assign(data, static_cast<size_t>(length));
+        data += length;
+        return true;
+    }
+
+    /**
+     * Reads a container's element count, rejecting counts that couldn't possibly fit in the remaining data (each
+     * element takes at least a byte), so a corrupt count can't trigger a huge allocation
+     */
+    static bool decodeCount(const char *&data, const char *end, size_t &count) {
+        unsigned long long value;
+        if (!VariantCodec::decodeVarint(data, end, value) || value > static_cast<unsigned long long>(end - data)) {
+            return false;
+        }
+        count = static_cast<size_t>(value);
+        return true;
+    }
+
+    template<typename T>
+    static inline char *encodeRaw(T value, char *out) {
+        memcpy(out, &value, sizeof(T));
+        return out + sizeof(T);
+    }
+
+    template<typename T>
+    static inline bool decodeRaw(const char *&data, const char *end, T &value) {
+        if (static_cast<size_t>(end - data) < sizeof(T)) {
+            return false;
+        }
+        memcpy(&value, data, sizeof(T));
+        data += sizeof(T);
+        return true;
+    }
+
+    size_t VariantCodec::size(const Variant &value) {
+        switch (value.type) {
+            case D_NULL:
+            case D_POINTER:
+                return 1;
+            case D_STRING:
+                return 1 + stringSize(*static_cast<std::string *>(value.data));
+            case D_STRINGVECTOR: {
+                auto &strings = *static_cast<std::vector<std::string> *>(value.data);
+                size_t size = 1 + varintSize(strings.size());
+                for (auto &string : strings) {
+                    size += stringSize(string);
+                }
+                return size;
+            }
+            case D_VARIANTVECTOR: {
+                auto &vector = *static_cast<VariantVector *>(value.data);
+                size_t size = 1 + varintSize(vector.size());
+                for (auto &element : vector) {
+                    size += VariantCodec::size(element);
+                }
+                return size;
+            }
+            case D_VARIANTMAP: {
+                auto &map = *static_cast<VariantMap *>(value.data);
+                size_t size = 1 + varintSize(map.size());
+                for (auto &entry : map) {
+                    size += stringSize(entry.first) + VariantCodec::size(entry.second);
+                }
+                return size;
+            }
+            case D_ULONG:
+                return 1 + varintSize(*static_cast<unsigned long *>(value.data));
+            case D_ULONGLONG:
+                return 1 + varintSize(*static_cast<unsigned long long *>(value.data));
+            case D_LONG:
+                return 1 + varintSize(zigzag(*static_cast<long *>(value.data)));
+            case D_LONGLONG:
+                return 1 + varintSize(zigzag(*static_cast<long long *>(value.data)));
+            case D_UINT:
+                return 1 + varintSize(*static_cast<unsigned int *>(value.data));
+            case D_INT:
+                return 1 + varintSize(zigzag(*static_cast<int *>(value.data)));
+            case D_USHORT:
+                return 1 + varintSize(*static_cast<unsigned short *>(value.data));
+            case D_SHORT:
+                return 1 + varintSize(zigzag(*static_cast<short *>(value.data)));
+            case D_FLOAT:
+                return 1 + sizeof(float);
+            case D_DOUBLE:
+                return 1 + sizeof(double);
+            case D_BOOLEAN:
+                return 2;
+        }
+
+        return 1;
+    }
+
+    char *VariantCodec::encode(const Variant &value, char *out) {
+        *out++ = static_cast<char>(value.type == D_POINTER ? D_NULL : value.type);
+        switch (value.type) {
+            case D_NULL:
+            case D_POINTER:
+                return out;
+            case D_STRING:
+                return encodeString(*static_cast<std::string *>(value.data), out);
+            case D_STRINGVECTOR: {
+                auto &strings = *static_cast<std::vector<std::string> *>(value.data);
+                out = encodeVarint(strings.size(), out);
+                for (auto &string : strings) {
+                    out = encodeString(string, out);
+                }
+                return out;
+            }
+            case D_VARIANTVECTOR: {
+                auto &vector = *static_cast<VariantVector *>(value.data);
+                out = encodeVarint(vector.size(), out);
+                for (auto &element : vector) {
+                    out = encode(element, out);
+                }
+                return out;
+            }
+            case D_VARIANTMAP: {
+                auto &map = *static_cast<VariantMap *>(value.data);
+                out = encodeVarint(map.size(), out);
+                for (auto &entry : map) {
+                    out = encodeString(entry.first, out);
+                    out = encode(entry.second, out);
+                }
+                return out;
+            }
+            case D_ULONG:
+                return encodeVarint(*static_cast<unsigned long *>(value.data), out);
+            case D_ULONGLONG:
+                return encodeVarint(*static_cast<unsigned long long *>(value.data), out);
+            case D_LONG:
+                return encodeVarint(zigzag(*static_cast<long *>(value.data)), out);
+            case D_LONGLONG:
+                return encodeVarint(zigzag(*static_cast<long long *>(value.data)), out);
+            case D_UINT:
+                return encodeVarint(*static_cast<unsigned int *>(value.data), out);
+            case D_INT:
+                return encodeVarint(zigzag(*static_cast<int *>(value.data)), out);
+            case D_USHORT:
+                return encodeVarint(*static_cast<unsigned short *>(value.data), out);
+            case D_SHORT:
+                return encodeVarint(zigzag(*static_cast<short *>(value.data)), out);
+            case D_FLOAT:
+                return encodeRaw(*static_cast<float *>(value.data), out);
+            case D_DOUBLE:
+                return encodeRaw(*static_cast<double *>(value.data), out);
+            case D_BOOLEAN:
+                *out++ = *static_cast<bool *>(value.data) ? 1 : 0;
+                return out;
+        }
+
+        return out;
+    }
+
+    void VariantCodec::encode(const Variant &value, std::string &out) {
+        size_t offset = out.size();
+        out.resize(offset + size(value));
+        encode(value, &out[offset]);
+    }
+
+    bool VariantCodec::decode(const char *&data, const char *end, Variant &value) {
+        const char *position = data;
+        if (!decodeValue(position, end, value, 0)) {
+            return false;
+        }
+        data = position;
+        return true;
+    }
+
+    template<typename T>
+    static bool decodeUnsigned(const char *&data, const char *end, Variant &value) {
+        unsigned long long raw;
+        if (!VariantCodec::decodeVarint(data, end, raw) || raw != static_cast<T>(raw)) {
+            return false;
+        }
+        Variant decoded(static_cast<T>(raw));
+        value.swap(decoded);
+        return true;
+    }
+
+    template<typename T>
+    static bool decodeSigned(const char *&data, const char *end, Variant &value) {
+        unsigned long long raw;
+        if (!VariantCodec::decodeVarint(data, end, raw)) {
+            return false;
+        }
+        long long number = unzigzag(raw);
+        if (number != static_cast<T>(number)) {
+            return false;
+        }
+        Variant decoded(static_cast<T>(number));
+        value.swap(decoded);
+        return true;
+    }
+
+    template<typename T>
+    static bool decodeFloating(const char *&data, const char *end, Variant &value) {
+        T number;
+        if (!decodeRaw(data, end, number)) {
+            return false;
+        }
+        Variant decoded(number);
+        value.swap(decoded);
+        return true;
+    }
+
+    bool VariantCodec::decodeValue(const char *&data, const char *end, Variant &value, unsigned int depth) {
+        if (data == end || depth > MAX_DEPTH) {
+            return false;
+        }
+
+        auto type = static_cast<DataType>(static_cast<unsigned char>(*data++));
+        switch (type) {
+            case D_NULL: {
+                Variant decoded;
+                value.swap(decoded);
+                return true;
+            }
+            case D_STRING: {
+                std::string string;
+                if (!decodeString(data, end, string)) {
+                    return false;
+                }
+                Variant decoded(std::string{});
+                static_cast<std::string *>(decoded.data)->swap(string);
+                value.swap(decoded);
+                return true;
+            }
+            case D_STRINGVECTOR: {
+                size_t count;
+                if (!decodeCount(data, end, count)) {
+                    return false;
+                }
+                Variant decoded(std::vector<std::string>{});
+                auto &strings = *static_cast<std::vector<std::string> *>(decoded.data);
+                strings.resize(count);
+                for (auto &string : strings) {
+                    if (!decodeString(data, end, string)) {
+                        return false;
+                    }
+                }
+                value.swap(decoded);
+                return true;
+            }
+            case D_VARIANTVECTOR: {
+                size_t count;
+                if (!decodeCount(data, end, count)) {
+                    return false;
+                }
+                Variant decoded(VariantVector{});
+                auto &vector = *static_cast<VariantVector *>(decoded.data);
+                vector.resize(count);
+                for (auto &element : vector) {
+                    if (!decodeValue(data, end, element, depth + 1)) {
+                        return false;
+                    }
+                }
+                value.swap(decoded);
+                return true;
+            }
+            case D_VARIANTMAP: {
+                size_t count;
+                if (!decodeCount(data, end, count)) {
+                    return false;
+                }
+                Variant decoded(VariantMap{});
+                auto &map = *static_cast<VariantMap *>(decoded.data);
+                for (size_t i = 0; i < count; ++i) {
+                    std::string key;
+                    if (!decodeString(data, end, key) || !decodeValue(data, end, map[key], depth + 1)) {
+                        return false;
+                    }
+                }
+                value.swap(decoded);
+                return true;
+            }
+            case D_ULONG:
+                return decodeUnsigned<unsigned long>(data, end, value);
+            case D_ULONGLONG:
+                return decodeUnsigned<unsigned long long>(data, end, value);
+            case D_LONG:
+                return decodeSigned<long>(data, end, value);
+            case D_LONGLONG:
+                return decodeSigned<long long>(data, end, value);
+            case D_UINT:
+                return decodeUnsigned<unsigned int>(data, end, value);
+            case D_INT:
+                return decodeSigned<int>(data, end, value);
+            case D_USHORT:
+                return decodeUnsigned<unsigned short>(data, end, value);
+            case D_SHORT:
+                return decodeSigned<short>(data, end, value);
+            case D_FLOAT:
+                return decodeFloating<float>(data, end, value);
+            case D_DOUBLE:
+                return decodeFloating<double>(data, end, value);
+            case D_BOOLEAN: {
+                if (data == end) {
+                    return false;
+                }
+                Variant decoded(*data++ != 0);
+                value.swap(decoded);
+                return true;
+            }
+            case D_POINTER:
+                break;
+        }
+
+        return false;
+    }
+
+    size_t VariantCodec::varintSize(unsigned long long value) {
+        size_t size = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    char *VariantCodec::encodeVarint(unsigned long long value, char *out) {
+        while (value >= 0x80) {
+            *out++ = static_cast<char>((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<char>(value);
+        return out;
+    }
+
+    bool VariantCodec::decodeVarint(const char *&data, const char *end, unsigned long long &value) {
+        value = 0;
+        for (unsigned int shift = 0; shift < 64 && data != end; shift += 7) {
+            auto byte = static_cast<unsigned char>(*data++);
+            value |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
@@ -0,0 +1,57 @@
+#include <cstring>
+#ifdef THREAD_SAFE
+#include <thread>
+#endif
+
+#include "include/beammeup/Affinity.h"
+#include "include/beammeup/MessageQueue.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    TEST(TestAffinity, CpuCount) {
+        ASSERT_GE(Affinity::getCpuCount(), 1);
+    }
+
+#if defined(__linux__)
+    TEST(TestAffinity, PinCurrentThread) {
+        ASSERT_TRUE(Affinity::pinCurrentThread(0));
+        ASSERT_EQ(0, Affinity::getCurrentCpu());
+        ASSERT_TRUE(Affinity::unpinCurrentThread());
+
+        ASSERT_FALSE(Affinity::pinCurrentThread(-1));
+    }
+
+    TEST(TestAffinity, Node) {
+        ASSERT_GE(Affinity::getNode(0), 0);
+        ASSERT_EQ(-1, Affinity::getNode(-1));
+    }
+#endif
+
+    TEST(TestAffinity, Allocate) {
+        for (int node : {-1, 0}) {
+            auto memory = static_cast<char *>(Affinity::allocate(4096, node));
+            ASSERT_NE(nullptr, memory);
+            memset(memory, 1, 4096);
+            Affinity::deallocate(memory, 4096, node);
+        }
+    }
+
+    TEST(TestAffinity, MessageQueueNode) {
+        MessageQueue queue;
+        ASSERT_EQ(-1, queue.getNode());
+        queue.setNode(0);
+        ASSERT_EQ(0, queue.getNode());
+
+        queue.reserve(100);
+        for (int i = 0; i < 200; ++i) {
+            queue.push(1, i);
+        }
+        Signal signal;
+        Variant message;
+        for (int i = 0; i < 200; ++i) {
+            ASSERT_TRUE(queue.pop(signal, message));
+            ASSERT_EQ(i, message.toInt());
+        }
+    }
+}
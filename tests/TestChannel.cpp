@@ -0,0 +1,136 @@
+#include <thread>
+
+#include "include/beammeup/Channel.h"
+#include "include/beammeup/RingBuffer.h"
+#include "include/beammeup/Transporter.h"
+#include "include/beammeup/VariantVector.h"
+#include "tests/stubs/StubRecordingReceiver.h"
+#include "tests/stubs/StubSmartObject.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    TEST(TestChannel, RingBufferFullAndEmpty) {
+        RingBuffer ring(3);
+        ASSERT_EQ(4, ring.capacity());
+        ASSERT_TRUE(ring.empty());
+
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_TRUE(ring.push(1, i));
+        }
+        ASSERT_FALSE(ring.push(1, 4));
+        ASSERT_EQ(4, ring.size());
+
+        Signal signal;
+        Variant message;
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_TRUE(ring.pop(signal, message));
+            ASSERT_EQ(i, message.toInt());
+        }
+        ASSERT_FALSE(ring.pop(signal, message));
+        ASSERT_TRUE(ring.empty());
+    }
+
+    TEST(TestChannel, OverflowKeepsOrder) {
+        Channel channel(nullptr, 4);
+
+        for (int i = 0; i < 10; ++i) {
+            channel.push(1, i);
+        }
+        ASSERT_EQ(10, channel.size());
+
+        Signal signal;
+        Variant message;
+        for (int i = 0; i < 5; ++i) {
+            ASSERT_TRUE(channel.pop(signal, message));
+            ASSERT_EQ(i, message.toInt());
+        }
+
+        // Still overflowed, so this can't jump ahead of 5..9
+        channel.push(1, 10);
+        for (int i = 5; i < 11; ++i) {
+            ASSERT_TRUE(channel.pop(signal, message));
+            ASSERT_EQ(i, message.toInt());
+        }
+        ASSERT_FALSE(channel.pop(signal, message));
+        ASSERT_TRUE(channel.empty());
+    }
+
+    TEST(TestChannel, SpscConnection) {
+        const int count = 100000;
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubRecordingReceiver receiver(&transporter);
+        emitter.connect(1, &receiver, ConnectionOptions(C_SPSC, 64));
+
+        std::thread producer([&emitter, count]() {
+            for (int i = 0; i < count; ++i) {
+                emitter.notify(1, i);
+            }
+        });
+
+        while (receiver.messages.size() < count) {
+            transporter.waitForMessages(std::chrono::milliseconds(10));
+            transporter.processMessages();
+        }
+        producer.join();
+
+        for (int i = 0; i < count; ++i) {
+            ASSERT_EQ(i, receiver.messages[i].toInt());
+        }
+        ASSERT_FALSE(transporter.hasPendingMessages());
+    }
+
+    TEST(TestChannel, DisconnectDeliversRemaining) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubRecordingReceiver receiver(&transporter);
+        emitter.connect(1, &receiver, ConnectionOptions(C_SPSC));
+
+        emitter.notify(1, 1);
+        emitter.notify(1, 2);
+        emitter.disconnect(1, &receiver);
+        emitter.notify(1, 3);
+
+        ASSERT_TRUE(receiver.hasMessages());
+        ASSERT_EQ(2, receiver.processMessages());
+        ASSERT_EQ(2, receiver.messages.size());
+        ASSERT_EQ(2, receiver.messages[1].toInt());
+        ASSERT_FALSE(receiver.hasMessages());
+    }
+
+    TEST(TestChannel, DestroyedReceiverDiscardsMessages) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        auto receiver = new StubRecordingReceiver(&transporter);
+        emitter.connect(1, receiver, ConnectionOptions(C_SPSC));
+
+        emitter.notify(1, 1);
+        ASSERT_TRUE(transporter.hasPendingMessages());
+        delete receiver;
+        ASSERT_FALSE(transporter.hasPendingMessages());
+
+        // The receiver is gone, so nothing is delivered
+        emitter.notify(1, 2);
+        ASSERT_FALSE(transporter.hasPendingMessages());
+    }
+
+    TEST(TestChannel, SpscBatch) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubRecordingReceiver receiver(&transporter);
+        emitter.connect(1, &receiver, ConnectionOptions(C_SPSC, 4));
+
+        VariantVector batch;
+        for (int i = 0; i < 10; ++i) {
+            batch << i;
+        }
+        emitter.notifyBatch(1, batch);
+
+        ASSERT_EQ(10, receiver.processMessages());
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_EQ(i, receiver.messages[i].toInt());
+        }
+        ASSERT_FALSE(transporter.hasPendingMessages());
+    }
+}
@@ -0,0 +1,272 @@
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#ifdef THREAD_SAFE
+#include <atomic>
+#include <thread>
+#endif
+#include <vector>
+
+#include "include/beammeup/Checkpoint.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Transporter.h"
+#include "include/beammeup/VariantVector.h"
+#include "tests/stubs/StubRecordingReceiver.h"
+#include "tests/stubs/StubTempName.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    /**
+     * @param test A name for the test
+     * @return A snapshot path no other test run will use
+     */
+    static std::string snapshotPath(const std::string &test) {
+        return "/tmp/" + stubTempName("checkpoint", test);
+    }
+
+    TEST(TestCheckpoint, SaveAndRestore) {
+        std::string path = snapshotPath("restore");
+        {
+            Transporter transporter;
+            Signaler signaler(&transporter);
+            StubRecordingReceiver first(&transporter);
+            StubRecordingReceiver second(&transporter);
+            StubRecordingReceiver unnamed(&transporter);
+            signaler.connect(1, &first);
+            signaler.connect(2, &second);
+            signaler.connect(2, &unnamed);
+            for (int i = 0; i < 100; i++) {
+                signaler.notify(i % 2 + 1, Variant(i));
+            }
+            VariantVector list;
+            list.push_back(Variant("nested"));
+            signaler.notify(1, Variant(list));
+
+            Checkpoint checkpoint(&transporter);
+            checkpoint.add("first", &first);
+            checkpoint.add("second", &second);
+            checkpoint.add("signaler", &signaler);
+            EXPECT_EQ(101u, checkpoint.save(path));
+
+            // Saving leaves the messages queued and the transporter running
+            EXPECT_FALSE(transporter.isQuiesced());
+            transporter.processMessages();
+            EXPECT_EQ(51u, first.messages.size());
+        }
+
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        StubRecordingReceiver first(&transporter);
+        StubRecordingReceiver second(&transporter);
+        Checkpoint checkpoint(&transporter);
+        checkpoint.add("first", &first);
+        checkpoint.add("second", &second);
+        checkpoint.add("signaler", &signaler);
+        EXPECT_EQ(101u, checkpoint.restore(path));
+
+        auto connected = signaler.getConnectedObjects();
+        ASSERT_EQ(2u, connected.size());
+        EXPECT_EQ(&first, connected.find(1)->second);
+        EXPECT_EQ(&second, connected.find(2)->second);
+
+        transporter.processMessages();
+        ASSERT_EQ(51u, first.messages.size());
+        ASSERT_EQ(50u, second.messages.size());
+        for (int i = 0; i < 50; i++) {
+            EXPECT_EQ(1u, first.signals[i]);
+            EXPECT_EQ(i * 2, first.messages[i].toInt());
+            EXPECT_EQ(i * 2 + 1, second.messages[i].toInt());
+        }
+        EXPECT_EQ("nested", first.messages[50].toVariantVector()[0].toString());
+
+        // Restoring again doesn't duplicate connections, but does queue the messages again
+        EXPECT_EQ(101u, checkpoint.restore(path));
+        EXPECT_EQ(2u, signaler.getConnectedObjects().size());
+        remove(path.c_str());
+    }
+
+    TEST(TestCheckpoint, Quiesce) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        StubRecordingReceiver receiver(&transporter);
+        signaler.connect(1, &receiver);
+
+        transporter.quiesce();
+        EXPECT_TRUE(transporter.isQuiesced());
+        signaler.notify(1, Variant(1));
+        transporter.processMessages();
+        EXPECT_TRUE(transporter.processMessages(10));
+        EXPECT_TRUE(receiver.messages.empty());
+
+        transporter.resume();
+        transporter.processMessages();
+        EXPECT_EQ(1u, receiver.messages.size());
+    }
+
+#ifdef THREAD_SAFE
+    TEST(TestCheckpoint, QuiesceWaitsForProcessing) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        std::atomic<int> inside(0);
+        std::atomic<int> processed(0);
+        class SlowReceiver : public Receiver {
+        public:
+            SlowReceiver(Transporter *transporter, std::atomic<int> &inside, std::atomic<int> &processed) :
+                    Receiver(transporter), inside(inside), processed(processed) {
+            }
+
+            void processMessage(const Signal, const Variant &) override {
+                inside++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                processed++;
+                inside--;
+            }
+
+            std::atomic<int> &inside;
+            std::atomic<int> &processed;
+        } receiver(&transporter, inside, processed);
+        signaler.connect(1, &receiver);
+
+        std::atomic_bool stop(false);
+        std::thread thread([&]() {
+            while (!stop) {
+                transporter.processMessages();
+            }
+        });
+        for (int i = 0; i < 50; i++) {
+            signaler.notify(1, Variant(i));
+        }
+        while (processed == 0) {
+            std::this_thread::yield();
+        }
+
+        transporter.quiesce();
+        EXPECT_EQ(0, inside.load());
+        int settled = processed;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        EXPECT_EQ(settled, processed.load());
+
+        transporter.resume();
+        while (processed < 50) {
+            std::this_thread::yield();
+        }
+        stop = true;
+        thread.join();
+    }
+
+    TEST(TestCheckpoint, SaveFromHandler) {
+        std::string path = snapshotPath("handler");
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        Checkpoint checkpoint(&transporter);
+        class SavingReceiver : public Receiver {
+        public:
+            SavingReceiver(Transporter *transporter, Checkpoint &checkpoint, const std::string &path) :
+                    Receiver(transporter), checkpoint(checkpoint), path(path), saved(0) {
+            }
+
+            void processMessage(const Signal, const Variant &) override {
+                saved = checkpoint.save(path);
+            }
+
+            Checkpoint &checkpoint;
+            std::string path;
+            std::atomic<size_t> saved;
+        } receiver(&transporter, checkpoint, path);
+        StubRecordingReceiver other(&transporter);
+        checkpoint.add("other", &other);
+        signaler.connect(1, &receiver);
+        signaler.connect(2, &other);
+        signaler.notify(1, Variant(1));
+        signaler.notify(2, Variant(2));
+
+        // The save would hang if quiesce waited for the processMessages call it is made from
+        std::atomic_bool stop(false);
+        std::thread thread([&]() {
+            while (!stop) {
+                transporter.processMessages();
+            }
+        });
+        while (receiver.saved == 0) {
+            std::this_thread::yield();
+        }
+        stop = true;
+        thread.join();
+        EXPECT_EQ(1u, receiver.saved.load());
+        EXPECT_FALSE(transporter.isQuiesced());
+        remove(path.c_str());
+    }
+
+    TEST(TestCheckpoint, IncludesChannels) {
+        std::string path = snapshotPath("channels");
+        {
+            Transporter transporter;
+            Signaler signaler(&transporter);
+            StubRecordingReceiver receiver(&transporter);
+            signaler.connect(1, &receiver, ConnectionOptions(C_SPSC, 16));
+            for (int i = 0; i < 40; i++) {
+                signaler.notify(1, Variant(i));
+            }
+            Checkpoint checkpoint(&transporter);
+            checkpoint.add("receiver", &receiver);
+            checkpoint.add("signaler", &signaler);
+            EXPECT_EQ(40u, checkpoint.save(path));
+        }
+
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        StubRecordingReceiver receiver(&transporter);
+        Checkpoint checkpoint(&transporter);
+        checkpoint.add("receiver", &receiver);
+        checkpoint.add("signaler", &signaler);
+        EXPECT_EQ(40u, checkpoint.restore(path));
+        transporter.processMessages();
+        ASSERT_EQ(40u, receiver.messages.size());
+        for (int i = 0; i < 40; i++) {
+            EXPECT_EQ(i, receiver.messages[i].toInt());
+        }
+
+        // New messages still get through the restored connection
+        signaler.notify(1, Variant(40));
+        transporter.processMessages();
+        ASSERT_EQ(41u, receiver.messages.size());
+        remove(path.c_str());
+    }
+#endif
+
+    TEST(TestCheckpoint, Damaged) {
+        std::string path = snapshotPath("damaged");
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        StubRecordingReceiver receiver(&transporter);
+        signaler.connect(1, &receiver);
+        for (int i = 0; i < 10; i++) {
+            signaler.notify(1, Variant(std::string(100, 'x')));
+        }
+        Checkpoint checkpoint(&transporter);
+        checkpoint.add("receiver", &receiver);
+        checkpoint.add("signaler", &signaler);
+        checkpoint.save(path);
+
+        std::string contents;
+        {
+            std::ifstream in(path, std::ios::binary);
+            contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(contents.data(), static_cast<std::streamsize>(contents.size() - 50));
+        }
+        EXPECT_THROW(checkpoint.restore(path), std::runtime_error);
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out << "not a checkpoint, but long enough to have a header";
+        }
+        EXPECT_THROW(checkpoint.restore(path), std::runtime_error);
+        EXPECT_THROW(checkpoint.restore(path + "-missing"), std::runtime_error);
+        remove(path.c_str());
+    }
+}
@@ -0,0 +1,88 @@
+#include <memory>
+
+#include "include/beammeup/ConnectionFilter.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Transporter.h"
+#include "include/beammeup/VariantMap.h"
+#include "include/beammeup/VariantVector.h"
+
+#include "tests/stubs/StubSmartObject.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    static Variant quote(const std::string &venue, double price) {
+        VariantMap map;
+        map["venue"] = venue;
+        map["price"] = price;
+        return Variant(map);
+    }
+
+    TEST(TestConnectionFilter, FieldExpression) {
+        ConnectionFilter venue("venue", F_EQUAL, "X");
+        ASSERT_TRUE(venue.accept(1, quote("X", 1.0)));
+        ASSERT_FALSE(venue.accept(1, quote("Y", 1.0)));
+        ASSERT_FALSE(venue.accept(1, "X"));
+        ASSERT_EQ(1, venue.getHits());
+        ASSERT_EQ(2, venue.getMisses());
+
+        ConnectionFilter price("price", F_GREATER_EQUAL, 10.0);
+        ASSERT_TRUE(price.accept(1, quote("X", 10.0)));
+        ASSERT_FALSE(price.accept(1, quote("X", 9.5)));
+
+        ConnectionFilter whole("", F_LESS, 5);
+        ASSERT_TRUE(whole.accept(1, 4));
+        ASSERT_FALSE(whole.accept(1, 5));
+
+        Variant map = quote("X", 1.0);
+        ASSERT_EQ(nullptr, map.find("size"));
+        ASSERT_EQ(Variant("X"), *map.find("venue"));
+    }
+
+    TEST(TestConnectionFilter, Notify) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        auto filter = std::make_shared<ConnectionFilter>([](Signal, const Variant &message) {
+            return message.toInt() % 2 == 0;
+        });
+        emitter.connect(1, &receiver, filter);
+
+        emitter.notify(1, 1);
+        ASSERT_FALSE(transporter.hasPendingMessages());
+        emitter.notify(1, 2);
+        ASSERT_TRUE(transporter.hasPendingMessages());
+
+        VariantVector batch;
+        batch.push_back(3);
+        batch.push_back(4);
+        batch.push_back(5);
+        emitter.notifyBatch(1, batch);
+        transporter.processMessages();
+
+        ASSERT_EQ(4, receiver.data[1].toInt());
+        ASSERT_EQ(2, filter->getHits());
+        ASSERT_EQ(3, filter->getMisses());
+        StubSmartObject::reset();
+    }
+
+#ifdef THREAD_SAFE
+    TEST(TestConnectionFilter, Channel) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        ConnectionOptions options(C_SPSC);
+        options.filter = std::make_shared<ConnectionFilter>("venue", F_NOT_EQUAL, "Y");
+        emitter.connect(1, &receiver, options);
+
+        emitter.notify(1, quote("X", 1.0));
+        emitter.notify(1, quote("Y", 2.0));
+        transporter.processMessages();
+
+        ASSERT_EQ(1.0, receiver.data[1].find("price")->toDouble());
+        ASSERT_EQ(1, options.filter->getHits());
+        ASSERT_EQ(1, options.filter->getMisses());
+        StubSmartObject::reset();
+    }
+#endif
+}
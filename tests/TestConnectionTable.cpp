@@ -0,0 +1,161 @@
+#ifdef THREAD_SAFE
+#include <atomic>
+#include <thread>
+#endif
+
+#include "include/beammeup/ConnectionTable.h"
+#include "include/beammeup/Epoch.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Transporter.h"
+
+#include "tests/stubs/StubSmartObject.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    /**
+     * @param index Which fake receiver
+     * @return A connection to a receiver that is never dereferenced
+     */
+    static Connection fakeConnection(size_t index) {
+        Connection connection;
+        connection.receiver = reinterpret_cast<Receiver *>(index * 16 + 16);
+        return connection;
+    }
+
+    static bool matchAll(const Connection &) {
+        return true;
+    }
+
+    TEST(TestConnectionTable, AddFindRemove) {
+        ConnectionTable table;
+        std::vector<Connection> removed;
+        ASSERT_EQ(nullptr, table.find(1));
+
+        table.add(1, fakeConnection(1));
+        table.add(1, fakeConnection(2));
+        table.add(2, fakeConnection(3));
+        ASSERT_EQ(2, table.find(1)->size());
+        ASSERT_EQ(fakeConnection(2).receiver, (*table.find(1))[1].receiver);
+        ASSERT_EQ(1, table.find(2)->size());
+
+        Receiver *first = fakeConnection(1).receiver;
+        table.remove(1, [first](const Connection &connection) {
+            return connection.receiver == first;
+        }, removed);
+        ASSERT_EQ(1, removed.size());
+        ASSERT_EQ(1, table.find(1)->size());
+        ASSERT_EQ(fakeConnection(2).receiver, (*table.find(1))[0].receiver);
+
+        table.removeAll(&matchAll, removed);
+        ASSERT_EQ(3, removed.size());
+        ASSERT_EQ(nullptr, table.find(1));
+        ASSERT_EQ(nullptr, table.find(2));
+
+        // Signals can come back after being emptied
+        table.add(2, fakeConnection(4));
+        ASSERT_EQ(1, table.find(2)->size());
+    }
+
+    TEST(TestConnectionTable, ManySignals) {
+        ConnectionTable table;
+        std::vector<Connection> removed;
+        const Signal signals = 10000;
+
+        for (Signal signal = 0; signal < signals; ++signal) {
+            table.add(signal, fakeConnection(signal));
+        }
+        for (Signal signal = 0; signal < signals; signal += 2) {
+            table.remove(signal, &matchAll, removed);
+        }
+        // Enough new signals to rebuild the index, dropping the emptied ones
+        for (Signal signal = signals; signal < 2 * signals; ++signal) {
+            table.add(signal, fakeConnection(signal));
+        }
+
+        size_t visited = 0;
+        table.forEach([&visited](Signal signal, const Connection &connection) {
+            ASSERT_EQ(fakeConnection(signal).receiver, connection.receiver);
+            visited++;
+        });
+        ASSERT_EQ(signals + signals / 2, visited);
+        for (Signal signal = 0; signal < 2 * signals; ++signal) {
+            ASSERT_EQ(signal < signals && signal % 2 == 0, table.find(signal) == nullptr);
+        }
+    }
+
+    TEST(TestConnectionTable, ReadersKeepTheirSnapshot) {
+        ConnectionTable table;
+        std::vector<Connection> removed;
+        for (size_t i = 0; i < 4; ++i) {
+            table.add(1, fakeConnection(i));
+        }
+
+        {
+            Epoch::Guard guard;
+            const ConnectionTable::List *list = table.find(1);
+
+            // Outgrowing the list and removing from it both replace it, but the old one stays readable
+            table.add(1, fakeConnection(4));
+            table.removeAll(&matchAll, removed);
+            ASSERT_EQ(nullptr, table.find(1));
+            ASSERT_EQ(4, list->size());
+            ASSERT_EQ(fakeConnection(3).receiver, (*list)[3].receiver);
+            ASSERT_NE(0, Epoch::pending());
+        }
+
+        Epoch::reclaim();
+        ASSERT_EQ(0, Epoch::pending());
+    }
+
+    TEST(TestConnectionTable, GetConnectedObjectsKeepsOrder) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver1(&transporter);
+        StubSmartObject receiver2(&transporter);
+        emitter.connect(2, &receiver2);
+        emitter.connect(1, &receiver1);
+        emitter.connect(2, &receiver1);
+
+        auto objects = emitter.getConnectedObjects();
+        typedef std::vector<std::pair<Signal, Receiver *>> Pairs;
+        Pairs expected = {{1, &receiver1}, {2, &receiver2}, {2, &receiver1}};
+        ASSERT_EQ(expected, Pairs(objects.begin(), objects.end()));
+        StubSmartObject::reset();
+    }
+
+#ifdef THREAD_SAFE
+    TEST(TestConnectionTable, ConcurrentNotify) {
+        Transporter transporter;
+        Signaler emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        std::atomic_bool done(false);
+
+        // Notify continuously while the connections churn underneath
+        std::thread notifier([&emitter, &done]() {
+            for (int round = 0; round < 2000; ++round) {
+                for (Signal signal = 0; signal < 64; ++signal) {
+                    emitter.notify(signal, static_cast<int>(signal));
+                }
+            }
+            done = true;
+        });
+        do {
+            for (Signal signal = 0; signal < 64; ++signal) {
+                emitter.connect(signal, &receiver, ConnectionOptions(signal % 2 == 0 ? C_QUEUED : C_SPSC, 16));
+            }
+            transporter.processMessages();
+            emitter.disconnectAll();
+            transporter.processMessages();
+        } while (!done);
+        notifier.join();
+
+        // Drained channels are dropped on the next pass
+        transporter.processMessages();
+        transporter.processMessages();
+        ASSERT_FALSE(transporter.hasPendingMessages());
+        ASSERT_TRUE(emitter.getConnectedObjects().empty());
+        StubSmartObject::reset();
+    }
+#endif
+}
@@ -0,0 +1,139 @@
+#ifdef BEAMMEUP_COROUTINES
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "include/beammeup/Transporter.h"
+#include "include/beammeup/Signaler.h"
+
+#include "tests/stubs/StubSmartObject.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    /**
+     * Waits for a login followed by a password, logging what it sees
+     */
+    Conversation login(Receiver &receiver, std::vector<std::string> &log) {
+        auto user = co_await receiver.next(1);
+        log.push_back("user " + user->toString());
+
+        auto password = co_await receiver.next(2, std::chrono::milliseconds(5));
+        log.push_back(password ? "password " + password->toString() : "timed out");
+    }
+
+    TEST(TestCoroutine, Sequence) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        emitter.connect(1, &receiver);
+        emitter.connect(2, &receiver);
+        emitter.connect(3, &receiver);
+
+        std::vector<std::string> log;
+        login(receiver, log);
+        ASSERT_TRUE(log.empty());
+
+        // Signals nobody is waiting for still go to processMessage
+        emitter.notify(2, "early");
+        emitter.notify(3, "other");
+        transporter.processMessages();
+        ASSERT_TRUE(log.empty());
+        ASSERT_EQ("early", receiver.data[2].toString());
+        ASSERT_EQ("other", receiver.data[3].toString());
+
+        emitter.notify(1, "kirk");
+        emitter.notify(2, "enterprise");
+        transporter.processMessages();
+        ASSERT_EQ(std::vector<std::string>({"user kirk", "password enterprise"}), log);
+        ASSERT_EQ("early", receiver.data[2].toString());
+    }
+
+    TEST(TestCoroutine, Timeout) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        emitter.connect(1, &receiver);
+
+        std::vector<std::string> log;
+        login(receiver, log);
+        emitter.notify(1, "spock");
+        transporter.processMessages();
+        ASSERT_EQ(1, log.size());
+
+        while (log.size() < 2) {
+            transporter.waitForMessages(std::chrono::seconds(10));
+            transporter.processMessages();
+        }
+        ASSERT_EQ("timed out", log[1]);
+    }
+
+    TEST(TestCoroutine, ReceiverDestroyed) {
+        Transporter transporter;
+        auto receiver = new StubSmartObject(&transporter);
+
+        std::vector<std::string> log;
+        login(*receiver, log);
+        delete receiver;
+        transporter.processMessages();
+        ASSERT_TRUE(log.empty());
+    }
+
+    /**
+     * Throws once it gets a message. The token's copy lives in the frame until the frame is freed.
+     */
+    Conversation refuse(Receiver &receiver, std::shared_ptr<int> token) {
+        co_await receiver.next(1);
+        throw std::runtime_error("refused");
+    }
+
+    TEST(TestCoroutine, ConversationThrows) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        emitter.connect(1, &receiver);
+
+        auto token = std::make_shared<int>(0);
+        refuse(receiver, token);
+        ASSERT_EQ(2, token.use_count());
+
+        // The exception comes out of processMessages, and the frame is freed on the way
+        emitter.notify(1, "go");
+        EXPECT_THROW(transporter.processMessages(), std::runtime_error);
+        EXPECT_EQ(1, token.use_count());
+
+        // The receiver keeps working
+        emitter.notify(1, "again");
+        transporter.processMessages();
+        EXPECT_EQ("again", receiver.data[1].toString());
+    }
+
+    TEST(TestCoroutine, ManyConversations) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        emitter.connect(1, &receiver);
+        emitter.connect(2, &receiver);
+
+        // Each waiting conversation is just a frame, so thousands are cheap. They are served in the order they
+        // started waiting.
+        const int conversations = 10000;
+        std::vector<std::string> log;
+        for (int i = 0; i < conversations; ++i) {
+            login(receiver, log);
+        }
+        for (int i = 0; i < conversations; ++i) {
+            emitter.notify(1, std::to_string(i));
+            emitter.notify(2, std::to_string(i));
+        }
+        transporter.processMessages();
+
+        ASSERT_EQ(2 * conversations, log.size());
+        ASSERT_EQ("user 0", log[0]);
+        ASSERT_EQ("password 0", log[1]);
+        ASSERT_EQ("password 9999", log.back());
+        ASSERT_EQ(std::chrono::steady_clock::time_point::max(), transporter.getNextTimerExpiry());
+    }
+}
+#endif
@@ -0,0 +1,433 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "include/beammeup/Dispatcher.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Transporter.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    /**
+     * Receiver that records its messages and fails if it is ever processed by two threads at once
+     */
+    class SerialReceiver : public Receiver {
+    public:
+        SerialReceiver(Transporter *transporter) : Receiver(transporter), inside(false), overlapped(false), count(0) {
+        }
+
+        void processMessage(const Signal, const Variant &message) override {
+            if (inside.exchange(true)) {
+                overlapped = true;
+            }
+            messages.push_back(message.toInt());
+            std::this_thread::yield();
+            inside = false;
+            count++;
+        }
+
+        std::atomic_bool inside;
+        std::atomic_bool overlapped;
+        std::atomic<size_t> count;
+        std::vector<int> messages;
+    };
+
+    /**
+     * Receiver that throws on its first message and counts the rest
+     */
+    class ThrowOnceReceiver : public Receiver {
+    public:
+        ThrowOnceReceiver(Transporter *transporter) : Receiver(transporter), thrown(false), count(0) {
+        }
+
+        void processMessage(const Signal, const Variant &) override {
+            if (!thrown.exchange(true)) {
+                throw std::runtime_error("handler failed");
+            }
+            count++;
+        }
+
+        std::atomic_bool thrown;
+        std::atomic<int> count;
+    };
+
+    /**
+     * Waits for a condition, giving up after a few seconds
+     * @param condition The condition
+     * @return true if the condition became true
+     */
+    template<typename Condition>
+    static bool waitFor(Condition condition) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    TEST(TestDispatcher, ProcessesInOrder) {
+        const int messages = 2000;
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        std::vector<std::unique_ptr<SerialReceiver>> receivers;
+        for (int i = 0; i < 8; ++i) {
+            receivers.emplace_back(new SerialReceiver(&transporter));
+            signaler.connect(1, receivers.back().get());
+        }
+
+        Dispatcher dispatcher(&transporter, 4);
+        dispatcher.start();
+        for (int i = 0; i < messages; ++i) {
+            signaler.notify(1, i);
+        }
+        ASSERT_TRUE(waitFor([&receivers, messages]() {
+            for (auto &receiver : receivers) {
+                if (receiver->count != static_cast<size_t>(messages)) {
+                    return false;
+                }
+            }
+            return true;
+        }));
+        dispatcher.stop();
+
+        for (auto &receiver : receivers) {
+            ASSERT_FALSE(receiver->overlapped);
+            ASSERT_EQ(static_cast<size_t>(messages), receiver->messages.size());
+            for (int i = 0; i < messages; ++i) {
+                ASSERT_EQ(i, receiver->messages[i]);
+            }
+        }
+        ASSERT_FALSE(transporter.hasPendingMessages());
+    }
+
+    TEST(TestDispatcher, HandlerThrows) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        ThrowOnceReceiver receiver(&transporter);
+        signaler.connect(1, &receiver);
+
+        Dispatcher dispatcher(&transporter, 2);
+        dispatcher.start();
+        EXPECT_FALSE(dispatcher.takeError());
+        for (int i = 0; i < 10; ++i) {
+            signaler.notify(1, i);
+        }
+
+        // The worker survives and the receiver's other messages are still processed
+        ASSERT_TRUE(waitFor([&receiver]() { return receiver.count == 9; }));
+        signaler.notify(1, 10);
+        ASSERT_TRUE(waitFor([&receiver]() { return receiver.count == 10; }));
+        dispatcher.stop();
+
+        EXPECT_EQ(1u, dispatcher.getErrorCount());
+        std::exception_ptr error = dispatcher.takeError();
+        ASSERT_TRUE(error);
+        EXPECT_THROW(std::rethrow_exception(error), std::runtime_error);
+        EXPECT_FALSE(dispatcher.takeError());
+    }
+
+    TEST(TestDispatcher, ConcurrentSenders) {
+        const int messages = 5000;
+        Transporter transporter;
+        Signaler first(&transporter);
+        Signaler second(&transporter);
+        SerialReceiver receiver(&transporter);
+        first.connect(1, &receiver);
+        second.connect(1, &receiver);
+
+        Dispatcher dispatcher(&transporter, 3);
+        dispatcher.start();
+        std::thread other([&second, messages]() {
+            for (int i = 0; i < messages; ++i) {
+                second.notify(1, i);
+            }
+        });
+        for (int i = 0; i < messages; ++i) {
+            first.notify(1, i);
+        }
+        other.join();
+        ASSERT_TRUE(waitFor([&receiver, messages]() { return receiver.count == 2 * static_cast<size_t>(messages); }));
+        dispatcher.stop();
+
+        ASSERT_FALSE(receiver.overlapped);
+    }
+
+    TEST(TestDispatcher, Timers) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        SerialReceiver receiver(&transporter);
+        signaler.connect(1, &receiver);
+
+        Dispatcher dispatcher(&transporter, 2);
+        dispatcher.start();
+        signaler.notifyAfter(1, 7, std::chrono::milliseconds(5));
+        ASSERT_TRUE(waitFor([&receiver]() { return receiver.count == 1; }));
+        dispatcher.stop();
+
+        ASSERT_EQ(std::vector<int>({7}), receiver.messages);
+    }
+
+    TEST(TestDispatcher, StopAndStart) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        SerialReceiver receiver(&transporter);
+        signaler.connect(1, &receiver);
+
+        Dispatcher dispatcher(&transporter, 2);
+        ASSERT_EQ(2u, dispatcher.getThreads());
+        dispatcher.start();
+        signaler.notify(1, 1);
+        ASSERT_TRUE(waitFor([&receiver]() { return receiver.count == 1; }));
+        dispatcher.stop();
+
+        // Nothing runs while stopped
+        signaler.notify(1, 2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ASSERT_EQ(1u, receiver.count);
+
+        dispatcher.start();
+        ASSERT_TRUE(waitFor([&receiver]() { return receiver.count == 2; }));
+        dispatcher.stop();
+        ASSERT_EQ(std::vector<int>({1, 2}), receiver.messages);
+    }
+
+    /**
+     * Receiver that records which threads process it
+     */
+    class ThreadRecordingReceiver : public Receiver {
+    public:
+        ThreadRecordingReceiver(Transporter *transporter) : Receiver(transporter), count(0) {
+        }
+
+        void processMessage(const Signal, const Variant &) override {
+            threads.insert(std::this_thread::get_id());
+            count++;
+        }
+
+        std::set<std::thread::id> threads;
+        std::atomic<size_t> count;
+    };
+
+    TEST(TestDispatcher, PinnedReceivers) {
+        const size_t messages = 500;
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        std::vector<std::unique_ptr<ThreadRecordingReceiver>> receivers;
+        Dispatcher dispatcher(&transporter, 3);
+        for (int i = 0; i < 6; ++i) {
+            receivers.emplace_back(new ThreadRecordingReceiver(&transporter));
+            signaler.connect(1, receivers.back().get());
+            // Pairs share a worker, and the last two float
+            if (i < 4) {
+                dispatcher.pin(receivers.back().get(), i / 2);
+            }
+        }
+        ASSERT_THROW(dispatcher.pin(receivers[0].get(), 3), std::runtime_error);
+        ASSERT_THROW(dispatcher.pinToCpu(receivers[0].get(), 0), std::runtime_error);
+
+        dispatcher.start();
+        for (size_t i = 0; i < messages; ++i) {
+            signaler.notify(1, static_cast<int>(i));
+        }
+        ASSERT_TRUE(waitFor([&receivers, messages]() {
+            for (auto &receiver : receivers) {
+                if (receiver->count != messages) {
+                    return false;
+                }
+            }
+            return true;
+        }));
+        dispatcher.stop();
+
+        // Each pinned receiver only ever ran on its worker, shared with its partner and no one else
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_EQ(1u, receivers[i]->threads.size());
+        }
+        ASSERT_EQ(receivers[0]->threads, receivers[1]->threads);
+        ASSERT_EQ(receivers[2]->threads, receivers[3]->threads);
+        ASSERT_NE(receivers[0]->threads, receivers[2]->threads);
+    }
+
+    TEST(TestDispatcher, PinnedWorkers) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        ThreadRecordingReceiver receiver(&transporter);
+        signaler.connect(1, &receiver);
+
+        ASSERT_THROW(Dispatcher(&transporter, std::vector<int>()), std::runtime_error);
+        Dispatcher dispatcher(&transporter, std::vector<int>({0}));
+        ASSERT_EQ(1u, dispatcher.getThreads());
+        ASSERT_EQ(0, dispatcher.getWorkerCpu(0));
+        ASSERT_EQ(-1, dispatcher.getWorkerCpu(1));
+        dispatcher.pinToCpu(&receiver, 0);
+
+        dispatcher.start();
+        signaler.notify(1, 1);
+        ASSERT_TRUE(waitFor([&receiver]() { return receiver.count == 1; }));
+        dispatcher.stop();
+
+        // Messages stay queued while stopped, and can be processed without the dispatcher
+        signaler.notify(1, 2);
+        transporter.processMessages();
+        ASSERT_EQ(2u, receiver.count);
+
+        dispatcher.unpin(&receiver);
+    }
+
+    TEST(TestDispatcher, Migrate) {
+        // Receivers moved back and forth while busy lose and reorder nothing
+        const int messages = 20000;
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        SerialReceiver receiver1(&transporter);
+        SerialReceiver receiver2(&transporter);
+        signaler.connect(1, &receiver1);
+        signaler.connect(1, &receiver2);
+
+        Dispatcher dispatcher(&transporter, 2);
+        dispatcher.pin(&receiver1, 0);
+        dispatcher.pin(&receiver2, 1);
+        dispatcher.start();
+        std::thread sender([&signaler, messages]() {
+            for (int i = 0; i < messages; ++i) {
+                signaler.notify(1, i);
+            }
+        });
+        for (unsigned int i = 0; receiver1.count < static_cast<size_t>(messages) && i < 100000; ++i) {
+            dispatcher.pin(&receiver1, i % 2);
+            dispatcher.pin(&receiver2, (i + 1) % 2);
+            std::this_thread::yield();
+        }
+        sender.join();
+        ASSERT_TRUE(waitFor([&receiver1, &receiver2, messages]() {
+            return receiver1.count == static_cast<size_t>(messages) && receiver2.count == static_cast<size_t>(messages);
+        }));
+        dispatcher.stop();
+
+        for (auto receiver : {&receiver1, &receiver2}) {
+            ASSERT_FALSE(receiver->overlapped);
+            for (int i = 0; i < messages; ++i) {
+                ASSERT_EQ(i, receiver->messages[i]);
+            }
+        }
+        ASSERT_EQ(1, dispatcher.getAffinity(&receiver1) + dispatcher.getAffinity(&receiver2));
+        dispatcher.unpin(&receiver1);
+        ASSERT_EQ(-1, dispatcher.getAffinity(&receiver1));
+    }
+
+    /**
+     * Receiver that burns some CPU for each message
+     */
+    class BusyReceiver : public Receiver {
+    public:
+        BusyReceiver(Transporter *transporter) : Receiver(transporter), count(0), total(0) {
+        }
+
+        void processMessage(const Signal, const Variant &) override {
+            for (int i = 0; i < 20000; ++i) {
+                total = total * 31 + static_cast<unsigned long long>(i);
+            }
+            count++;
+        }
+
+        std::atomic<size_t> count;
+        unsigned long long total;
+    };
+
+    TEST(TestDispatcher, Rebalance) {
+        const size_t messages = 100;
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        std::vector<std::unique_ptr<BusyReceiver>> receivers;
+        Dispatcher dispatcher(&transporter, 2);
+        for (int i = 0; i < 4; ++i) {
+            receivers.emplace_back(new BusyReceiver(&transporter));
+            signaler.connect(1, receivers.back().get());
+            dispatcher.pin(receivers.back().get(), 0);
+        }
+        // Nothing has been measured yet
+        ASSERT_EQ(0u, dispatcher.rebalance());
+
+        dispatcher.start();
+        for (size_t i = 0; i < messages; ++i) {
+            signaler.notify(1, static_cast<int>(i));
+        }
+        ASSERT_TRUE(waitFor([&receivers, messages]() {
+            for (auto &receiver : receivers) {
+                if (receiver->count != messages) {
+                    return false;
+                }
+            }
+            return true;
+        }));
+        dispatcher.stop();
+
+        // Everything was on worker 0, so something has to move to worker 1
+        ASSERT_GE(dispatcher.rebalance(), 1u);
+        size_t moved = 0;
+        for (auto &receiver : receivers) {
+            moved += dispatcher.getAffinity(receiver.get()) == 1 ? 1 : 0;
+        }
+        ASSERT_GE(moved, 1u);
+        ASSERT_LE(moved, 3u);
+    }
+
+    TEST(TestDispatcher, AutomaticRebalance) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        std::vector<std::unique_ptr<BusyReceiver>> receivers;
+        Dispatcher dispatcher(&transporter, 2);
+        for (int i = 0; i < 4; ++i) {
+            receivers.emplace_back(new BusyReceiver(&transporter));
+            signaler.connect(1, receivers.back().get());
+            dispatcher.pin(receivers.back().get(), 0);
+        }
+        dispatcher.setRebalanceInterval(std::chrono::milliseconds(5));
+
+        dispatcher.start();
+        std::atomic_bool sending(true);
+        std::thread sender([&signaler, &sending]() {
+            while (sending) {
+                signaler.notify(1, 0);
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        });
+        bool spread = waitFor([&dispatcher, &receivers]() {
+            for (auto &receiver : receivers) {
+                if (dispatcher.getAffinity(receiver.get()) == 1) {
+                    return true;
+                }
+            }
+            return false;
+        });
+        sending = false;
+        sender.join();
+        dispatcher.stop();
+
+        ASSERT_TRUE(spread);
+    }
+
+    TEST(TestDispatcher, ReceiverDestroyed) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        Dispatcher dispatcher(&transporter, 2);
+        dispatcher.start();
+        for (int i = 0; i < 50; ++i) {
+            std::unique_ptr<SerialReceiver> receiver(new SerialReceiver(&transporter));
+            signaler.connect(1, receiver.get());
+            for (int j = 0; j < 100; ++j) {
+                signaler.notify(1, j);
+            }
+        }
+        dispatcher.stop();
+        ASSERT_FALSE(transporter.hasPendingMessages());
+    }
+}
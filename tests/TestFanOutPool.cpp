@@ -0,0 +1,70 @@
+#include <memory>
+#include <vector>
+
+#include "include/beammeup/ConnectionFilter.h"
+#include "include/beammeup/FanOutPool.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Transporter.h"
+#include "tests/stubs/StubRecordingReceiver.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    TEST(TestFanOutPool, Broadcast) {
+        FanOutPool pool(4);
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        std::vector<std::unique_ptr<StubRecordingReceiver>> receivers;
+        for (int i = 0; i < 5000; ++i) {
+            receivers.emplace_back(new StubRecordingReceiver(&transporter));
+            signaler.connect(1, receivers.back().get());
+        }
+
+        std::future<void> last;
+        for (int i = 0; i < 10; ++i) {
+            last = signaler.broadcast(1, i, pool);
+        }
+        last.wait();
+        transporter.processMessages();
+
+        std::vector<int> expected({0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+        for (auto &receiver : receivers) {
+            ASSERT_EQ(expected, receiver->getInts());
+        }
+    }
+
+    TEST(TestFanOutPool, Filtered) {
+        FanOutPool pool(2);
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        StubRecordingReceiver odd(&transporter);
+        StubRecordingReceiver all(&transporter);
+        auto filter = std::make_shared<ConnectionFilter>([](Signal, const Variant &message) {
+            return message.toInt() % 2 == 1;
+        });
+        signaler.connect(1, &odd, filter);
+        signaler.connect(1, &all);
+
+        signaler.broadcast(1, 1, pool).wait();
+        signaler.broadcast(1, 2, pool).wait();
+        transporter.processMessages();
+
+        ASSERT_EQ(std::vector<int>({1}), odd.getInts());
+        ASSERT_EQ(std::vector<int>({1, 2}), all.getInts());
+        ASSERT_EQ(1, filter->getMisses());
+    }
+
+    TEST(TestFanOutPool, NoReceivers) {
+        FanOutPool pool(2);
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        auto receiver = new StubRecordingReceiver(&transporter);
+        signaler.connect(1, receiver);
+        delete receiver;
+
+        std::future<void> future = signaler.broadcast(2, 1, pool);
+        ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(0)));
+        signaler.broadcast(1, 1, pool).wait();
+        ASSERT_FALSE(transporter.hasPendingMessages());
+    }
+}
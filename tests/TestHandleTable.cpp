@@ -0,0 +1,104 @@
+#ifdef THREAD_SAFE
+#include <atomic>
+#include <thread>
+#endif
+#include <vector>
+
+#include "include/beammeup/HandleTable.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Transporter.h"
+
+#include "tests/stubs/StubSmartObject.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    static Receiver *fakeReceiver(size_t index) {
+        return reinterpret_cast<Receiver *>(index * 16 + 16);
+    }
+
+    TEST(TestHandleTable, Generations) {
+        HandleTable table;
+        ReceiverHandle first = table.add(fakeReceiver(1));
+        ASSERT_NE(0, first);
+        ASSERT_TRUE(table.isValid(first));
+        ASSERT_EQ(fakeReceiver(1), table.get(first));
+
+        table.remove(first);
+        ASSERT_FALSE(table.isValid(first));
+        ASSERT_EQ(nullptr, table.get(first));
+        table.remove(first);
+        ASSERT_EQ(0, table.size());
+
+        // The slot is reused, but the old handle stays invalid
+        ReceiverHandle second = table.add(fakeReceiver(2));
+        ASSERT_NE(first, second);
+        ASSERT_EQ(static_cast<unsigned int>(first), static_cast<unsigned int>(second));
+        ASSERT_FALSE(table.isValid(first));
+        ASSERT_TRUE(table.isValid(second));
+        ASSERT_EQ(fakeReceiver(2), table.get(second));
+
+        ASSERT_FALSE(table.isValid(0));
+        ASSERT_FALSE(table.isValid(0xFFFFFFFFULL));
+    }
+
+    TEST(TestHandleTable, ManyReceivers) {
+        HandleTable table;
+        std::vector<ReceiverHandle> handles;
+        for (size_t i = 0; i < 5000; ++i) {
+            handles.push_back(table.add(fakeReceiver(i)));
+        }
+        for (size_t i = 0; i < handles.size(); i += 2) {
+            table.remove(handles[i]);
+        }
+
+        ASSERT_EQ(2500, table.size());
+        for (size_t i = 0; i < handles.size(); ++i) {
+            ASSERT_EQ(i % 2 == 1, table.isValid(handles[i]));
+        }
+    }
+
+    TEST(TestHandleTable, DestroyedReceiverIsSkipped) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        auto receiver = new StubSmartObject(&transporter);
+        emitter.connect(1, receiver);
+
+        emitter.notify(1, "one");
+        ASSERT_TRUE(transporter.hasPendingMessages());
+        delete receiver;
+        ASSERT_FALSE(transporter.hasPendingMessages());
+
+        // Destruction disconnected it
+        emitter.notify(1, "two");
+        ASSERT_FALSE(transporter.hasPendingMessages());
+        ASSERT_TRUE(emitter.getConnectedObjects().empty());
+        StubSmartObject::reset();
+    }
+
+#ifdef THREAD_SAFE
+    TEST(TestHandleTable, DestroyWhileNotifying) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        std::atomic_bool done(false);
+
+        std::thread notifier([&emitter, &done]() {
+            while (!done) {
+                emitter.notify(1, 1);
+            }
+        });
+        for (int i = 0; i < 200; ++i) {
+            auto receiver = new StubSmartObject(&transporter);
+            emitter.connect(1, receiver);
+            transporter.processMessages();
+            // Destruction waits for the notifier to be done with the receiver
+            delete receiver;
+        }
+        done = true;
+        notifier.join();
+
+        ASSERT_FALSE(transporter.hasPendingMessages());
+        StubSmartObject::reset();
+    }
+#endif
+}
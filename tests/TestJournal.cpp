@@ -0,0 +1,219 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "include/beammeup/Journal.h"
+#include "include/beammeup/JournalReplayer.h"
+#include "include/beammeup/Transporter.h"
+#include "tests/stubs/StubRecordingReceiver.h"
+#include "tests/stubs/StubTempName.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    /**
+     * A journal directory that is removed at the end of the test
+     */
+    class JournalDirectory {
+    public:
+        JournalDirectory(const std::string &test) :
+                path("/tmp/" + stubTempName("journal", test)) {
+            clear();
+        }
+
+        ~JournalDirectory() {
+            clear();
+        }
+
+        void clear() {
+            for (auto &segment : Journal::listSegments(path)) {
+                unlink(segment.c_str());
+            }
+            rmdir(path.c_str());
+        }
+
+        std::string path;
+    };
+
+    TEST(TestJournal, RecordsSelectedSignals) {
+        JournalDirectory directory("selected");
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        {
+            Journal journal(&transporter, directory.path);
+            signaler.connect(1, &journal, ConnectionOptions(C_DIRECT));
+            signaler.connect(2, &journal);
+            for (int i = 0; i < 30; i++) {
+                signaler.notify(i % 3 + 1, Variant(i));
+            }
+            transporter.processMessages();
+            EXPECT_EQ(20u, journal.getRecorded());
+        }
+
+        JournalReplayer replayer(&transporter, directory.path);
+        Signal signal;
+        Variant message;
+        std::chrono::system_clock::time_point time;
+        std::chrono::system_clock::time_point last;
+        std::vector<int> direct;
+        std::vector<int> queued;
+        while (replayer.next(signal, message, time)) {
+            EXPECT_GE(time, last);
+            EXPECT_LE(time, std::chrono::system_clock::now());
+            last = time;
+            (signal == 1 ? direct : queued).push_back(message.toInt());
+        }
+        ASSERT_EQ(10u, direct.size());
+        ASSERT_EQ(10u, queued.size());
+        for (int i = 0; i < 10; i++) {
+            EXPECT_EQ(i * 3, direct[i]);
+            EXPECT_EQ(i * 3 + 1, queued[i]);
+        }
+        EXPECT_TRUE(replayer.isFinished());
+    }
+
+    TEST(TestJournal, RollsSegments) {
+        JournalDirectory directory("segments");
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        {
+            Journal journal(&transporter, directory.path, JS_INTERVAL, std::chrono::milliseconds(1), 4096);
+            signaler.connect(1, &journal, ConnectionOptions(C_DIRECT));
+            for (int i = 0; i < 1000; i++) {
+                signaler.notify(1, Variant(std::string(static_cast<size_t>(i % 50), 'x')));
+            }
+            signaler.notify(1, Variant(std::string(5000, 'x')));
+            EXPECT_EQ(1000u, journal.getRecorded());
+            EXPECT_EQ(1u, journal.getDropped());
+            EXPECT_GT(journal.getSegmentCount(), 5u);
+        }
+        EXPECT_GT(Journal::listSegments(directory.path).size(), 5u);
+
+        // A second journal on the same directory carries on after the first
+        {
+            Journal journal(&transporter, directory.path, JS_EVERY);
+            signaler.connect(1, &journal, ConnectionOptions(C_DIRECT));
+            signaler.notify(1, Variant("last"));
+        }
+
+        JournalReplayer replayer(&transporter, directory.path);
+        StubRecordingReceiver receiver(&transporter);
+        replayer.connect(1, &receiver);
+        EXPECT_EQ(1001u, replayer.replay());
+        transporter.processMessages();
+        ASSERT_EQ(1001u, receiver.messages.size());
+        for (int i = 0; i < 1000; i++) {
+            EXPECT_EQ(static_cast<size_t>(i % 50), receiver.messages[i].toString().size());
+        }
+        EXPECT_EQ("last", receiver.messages[1000].toString());
+    }
+
+    TEST(TestJournal, IntervalSyncAfterBurst) {
+        JournalDirectory directory("interval");
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        Journal journal(&transporter, directory.path, JS_INTERVAL, std::chrono::milliseconds(5));
+        signaler.connect(1, &journal, ConnectionOptions(C_DIRECT));
+        for (int i = 0; i < 10; i++) {
+            signaler.notify(1, Variant(i));
+        }
+        EXPECT_FALSE(journal.isSynced());
+
+        // Nothing more is recorded, so only the timer syncs the burst
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!journal.isSynced() && std::chrono::steady_clock::now() < deadline) {
+            transporter.waitForMessages(std::chrono::milliseconds(10));
+            transporter.processMessages();
+        }
+        EXPECT_TRUE(journal.isSynced());
+        EXPECT_EQ(10u, journal.getRecorded());
+    }
+
+#ifdef THREAD_SAFE
+    TEST(TestJournal, DestroyedWhileRecording) {
+        JournalDirectory directory("destroyed");
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        auto journal = new Journal(&transporter, directory.path, JS_INTERVAL, std::chrono::milliseconds(1), 4096);
+        std::atomic<int> sent(0);
+        std::atomic_bool stop(false);
+
+        // Connected on the notifying thread, so each message is appended there while the journal is destroyed here
+        std::thread thread([&]() {
+            signaler.connect(1, journal, ConnectionOptions(C_DIRECT));
+            while (!stop) {
+                signaler.notify(1, Variant(std::string(100, 'x')));
+                sent++;
+            }
+        });
+        while (sent < 1000) {
+            std::this_thread::yield();
+        }
+        delete journal;
+        stop = true;
+        thread.join();
+        EXPECT_GT(Journal::listSegments(directory.path).size(), 1u);
+    }
+#endif
+
+    TEST(TestJournal, OriginalPace) {
+        JournalDirectory directory("pace");
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        {
+            Journal journal(&transporter, directory.path);
+            signaler.connect(1, &journal, ConnectionOptions(C_DIRECT));
+            for (int i = 0; i < 3; i++) {
+                signaler.notify(1, Variant(i));
+                std::this_thread::sleep_for(std::chrono::milliseconds(i == 0 ? 50 : 0));
+            }
+        }
+
+        JournalReplayer replayer(&transporter, directory.path);
+        auto start = std::chrono::steady_clock::now();
+        EXPECT_EQ(1u, replayer.replay(JP_ORIGINAL));
+        auto due = replayer.getNextDue();
+        EXPECT_GE(due - start, std::chrono::milliseconds(45));
+        EXPECT_EQ(0u, replayer.replay(JP_ORIGINAL));
+        std::this_thread::sleep_until(due);
+        EXPECT_EQ(2u, replayer.replay(JP_ORIGINAL));
+        EXPECT_EQ(std::chrono::steady_clock::time_point::max(), replayer.getNextDue());
+        EXPECT_TRUE(replayer.isFinished());
+    }
+
+    TEST(TestJournal, DamagedSegment) {
+        JournalDirectory directory("damaged");
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        {
+            Journal journal(&transporter, directory.path);
+            signaler.connect(1, &journal, ConnectionOptions(C_DIRECT));
+            for (int i = 0; i < 10; i++) {
+                signaler.notify(1, Variant(i));
+            }
+        }
+
+        // Overwrite the last record's length with one running past the end, as a torn write might leave it
+        std::string segment = Journal::listSegments(directory.path).back();
+        int descriptor = open(segment.c_str(), O_WRONLY);
+        ASSERT_NE(-1, descriptor);
+        off_t size = lseek(descriptor, 0, SEEK_END);
+        unsigned int length = 1000000;
+        ASSERT_EQ(static_cast<ssize_t>(sizeof(length)),
+                  pwrite(descriptor, &length, sizeof(length), size - static_cast<off_t>(sizeof(Journal::RecordHeader) + 8)));
+        close(descriptor);
+
+        JournalReplayer replayer(&transporter, directory.path);
+        EXPECT_EQ(9u, replayer.replay());
+        EXPECT_TRUE(replayer.isFinished());
+
+        JournalReplayer empty(&transporter, directory.path + "-missing");
+        EXPECT_TRUE(empty.isFinished());
+        EXPECT_EQ(0u, empty.replay());
+    }
+}
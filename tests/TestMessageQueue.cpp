@@ -0,0 +1,109 @@
+#include <memory>
+
+#include "include/beammeup/MessageQueue.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    TEST(TestMessageQueue, FirstInFirstOut) {
+        MessageQueue queue;
+        ASSERT_TRUE(queue.empty());
+
+        queue.push(1, "a");
+        queue.push(2, 10);
+        queue.push(3, "c");
+        ASSERT_EQ(3, queue.size());
+
+        Signal signal;
+        Variant message;
+        ASSERT_TRUE(queue.pop(signal, message));
+        ASSERT_EQ(1, signal);
+        ASSERT_EQ("a", message.toString());
+
+        ASSERT_TRUE(queue.pop(signal, message));
+        ASSERT_EQ(2, signal);
+        ASSERT_EQ(10, message.toInt());
+
+        ASSERT_TRUE(queue.pop(signal, message));
+        ASSERT_EQ(3, signal);
+        ASSERT_EQ("c", message.toString());
+
+        ASSERT_FALSE(queue.pop(signal, message));
+        ASSERT_TRUE(queue.empty());
+        ASSERT_EQ(0, queue.size());
+    }
+
+    TEST(TestMessageQueue, NodesAreRecycled) {
+        MessageQueue queue;
+        Signal signal;
+
+        for (int i = 0; i < 100; ++i) {
+            queue.push(1, i);
+        }
+        size_t capacity = queue.capacity();
+        ASSERT_GE(capacity, 100);
+
+        // Repeated bursts no larger than the first don't allocate more nodes
+        for (int round = 0; round < 10; ++round) {
+            while (!queue.empty()) {
+                Variant message;
+                queue.pop(signal, message);
+            }
+            for (int i = 0; i < 100; ++i) {
+                queue.push(1, i);
+            }
+        }
+        ASSERT_EQ(capacity, queue.capacity());
+
+        for (int i = 0; i < 100; ++i) {
+            Variant message;
+            ASSERT_TRUE(queue.pop(signal, message));
+            ASSERT_EQ(i, message.toInt());
+        }
+    }
+
+    TEST(TestMessageQueue, Reserve) {
+        MessageQueue queue;
+        ASSERT_EQ(0, queue.capacity());
+
+        queue.reserve(500);
+        ASSERT_EQ(500, queue.capacity());
+
+        for (int i = 0; i < 500; ++i) {
+            queue.push(1, i);
+        }
+        ASSERT_EQ(500, queue.capacity());
+
+        // Reserving less than we have is a no-op
+        queue.reserve(10);
+        ASSERT_EQ(500, queue.capacity());
+    }
+
+    TEST(TestMessageQueue, Shared) {
+        MessageQueue queue;
+        auto shared = std::make_shared<const Variant>("payload");
+        queue.push(1, shared);
+        queue.push(2, "copy");
+        queue.push(3, shared);
+        ASSERT_EQ(3, shared.use_count());
+
+        Signal signal;
+        Variant message;
+        RequestId request;
+        std::shared_ptr<const Variant> popped;
+        ASSERT_TRUE(queue.pop(signal, message, request, popped));
+        ASSERT_EQ(1, signal);
+        ASSERT_EQ(shared, popped);
+
+        ASSERT_TRUE(queue.pop(signal, message, request, popped));
+        ASSERT_EQ(2, signal);
+        ASSERT_EQ(nullptr, popped);
+        ASSERT_EQ("copy", message.toString());
+
+        // Popping without asking for the shared payload copies it
+        ASSERT_TRUE(queue.pop(signal, message));
+        ASSERT_EQ(3, signal);
+        ASSERT_EQ("payload", message.toString());
+        ASSERT_EQ(1, shared.use_count());
+    }
+}
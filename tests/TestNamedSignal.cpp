@@ -0,0 +1,58 @@
+#include <stdexcept>
+
+#include "include/beammeup/NamedSignal.h"
+#include "include/beammeup/Signaler.h"
+#include "include/beammeup/Topic.h"
+#include "include/beammeup/Transporter.h"
+
+#include "tests/stubs/StubSmartObject.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    static constexpr NamedSignal PRICE("md.price");
+    static constexpr NamedSignal TRADE("md.trade");
+    static const SignalRegistration registerPrice(PRICE);
+
+    // Evaluated by the compiler
+    static_assert(PRICE == 0xc963ff1fu, "NamedSignal should hash at compile time");
+    static_assert("md.price"_signal == PRICE, "Literals and NamedSignals should agree");
+    static_assert(signalsDistinct({PRICE, TRADE}), "Distinct names should have distinct signals");
+    static_assert(!signalsDistinct({"costarring"_signal, "liquid"_signal}), "Collisions should be detected");
+
+    TEST(TestNamedSignal, Hash) {
+        ASSERT_EQ(topicSignal("md.price"), PRICE.getSignal());
+        ASSERT_STREQ("md.price", PRICE.getName());
+
+        // Usable anywhere a Signal is, for the same cost
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        emitter.connect(PRICE, &receiver);
+        emitter.notify(PRICE, 42);
+        transporter.processMessages();
+        ASSERT_EQ(42, receiver.data[PRICE].toInt());
+        StubSmartObject::reset();
+    }
+
+    TEST(TestNamedSignal, Registry) {
+        ASSERT_EQ("md.price", SignalRegistry::getName(PRICE));
+        ASSERT_EQ("", SignalRegistry::getName(TRADE));
+        ASSERT_EQ(std::to_string(TRADE), SignalRegistry::describe(TRADE));
+
+        ASSERT_EQ(TRADE, SignalRegistry::add(TRADE));
+        ASSERT_EQ(TRADE, SignalRegistry::add("md.trade"));
+        ASSERT_EQ("md.trade", SignalRegistry::describe(TRADE));
+
+        ASSERT_EQ("declinate"_signal, SignalRegistry::add("declinate"));
+        ASSERT_THROW(SignalRegistry::add("macallums"), std::runtime_error);
+        ASSERT_EQ("declinate", SignalRegistry::getName("macallums"_signal));
+    }
+
+    TEST(TestNamedSignal, TopicCollision) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        ASSERT_EQ("altarage"_signal, signaler.advertise("altarage"));
+        ASSERT_THROW(signaler.advertise("zinke"), std::runtime_error);
+    }
+}
@@ -0,0 +1,189 @@
+#ifdef THREAD_SAFE
+#include <thread>
+#endif
+
+#include "include/beammeup/Transporter.h"
+#include "include/beammeup/Signaler.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    /**
+     * Receiver that answers requests with the request's message, or holds on to them to answer later
+     */
+    class EchoReceiver : public Receiver {
+    public:
+        EchoReceiver(Transporter *transporter, bool defer = false) : Receiver(transporter), defer(defer) {
+        }
+
+        void processMessage(const Signal, const Variant &message) override {
+            if (defer) {
+                deferred.push_back(getRequest());
+            } else {
+                reply(message);
+            }
+        }
+
+        using Receiver::reply;
+
+        bool defer;
+        std::vector<RequestId> deferred;
+    };
+
+    /**
+     * Records the outcome of a request
+     */
+    struct ReplyRecorder {
+        ReplyRecorder() : calls(0), status(RS_OK) {
+        }
+
+        ReplyCallback callback() {
+            return [this](ReplyStatus status, const Variant &reply) {
+                calls++;
+                this->status = status;
+                this->reply = reply;
+            };
+        }
+
+        int calls;
+        ReplyStatus status;
+        Variant reply;
+    };
+
+    TEST(TestRequests, Reply) {
+        Transporter transporter;
+        Signaler requester(&transporter);
+        EchoReceiver receiver(&transporter);
+        requester.connect(1, &receiver);
+
+        ReplyRecorder recorder;
+        ASSERT_NE(0, requester.request(1, "ping", recorder.callback()));
+        ASSERT_EQ(0, recorder.calls);
+
+        transporter.processMessages();
+        ASSERT_EQ(1, recorder.calls);
+        ASSERT_EQ(RS_OK, recorder.status);
+        ASSERT_EQ("ping", recorder.reply.toString());
+        ASSERT_FALSE(transporter.hasPendingMessages());
+    }
+
+    TEST(TestRequests, FirstReplyWins) {
+        Transporter transporter;
+        Signaler requester(&transporter);
+        EchoReceiver first(&transporter, true);
+        EchoReceiver second(&transporter, true);
+        requester.connect(1, &first);
+        requester.connect(1, &second);
+
+        ReplyRecorder recorder;
+        requester.request(1, "ping", recorder.callback());
+        transporter.processMessages();
+        ASSERT_EQ(1, first.deferred.size());
+        ASSERT_EQ(first.deferred, second.deferred);
+
+        ASSERT_TRUE(second.reply(second.deferred[0], "second"));
+        ASSERT_FALSE(first.reply(first.deferred[0], "first"));
+        transporter.processMessages();
+        ASSERT_EQ(1, recorder.calls);
+        ASSERT_EQ("second", recorder.reply.toString());
+    }
+
+    TEST(TestRequests, NoReceiver) {
+        Transporter transporter;
+        Signaler requester(&transporter);
+
+        ReplyRecorder recorder;
+        requester.request(1, "ping", recorder.callback());
+        transporter.processMessages();
+        ASSERT_EQ(1, recorder.calls);
+        ASSERT_EQ(RS_NO_RECEIVER, recorder.status);
+    }
+
+    TEST(TestRequests, Timeout) {
+        Transporter transporter;
+        Signaler requester(&transporter);
+        EchoReceiver receiver(&transporter, true);
+        requester.connect(1, &receiver);
+
+        ReplyRecorder recorder;
+        requester.request(1, "ping", recorder.callback(), std::chrono::milliseconds(5));
+        while (recorder.calls == 0) {
+            transporter.waitForMessages(std::chrono::seconds(10));
+            transporter.processMessages();
+        }
+        ASSERT_EQ(RS_TIMEOUT, recorder.status);
+
+        // Too late
+        ASSERT_FALSE(receiver.reply(receiver.deferred[0], "pong"));
+        transporter.processMessages();
+        ASSERT_EQ(1, recorder.calls);
+    }
+
+    TEST(TestRequests, Cancel) {
+        Transporter transporter;
+        Signaler requester(&transporter);
+        EchoReceiver receiver(&transporter, true);
+        requester.connect(1, &receiver);
+
+        ReplyRecorder recorder;
+        RequestId id = requester.request(1, "ping", recorder.callback(), std::chrono::seconds(10));
+        ASSERT_TRUE(requester.cancelRequest(id));
+        ASSERT_FALSE(requester.cancelRequest(id));
+        transporter.processMessages();
+        ASSERT_EQ(1, recorder.calls);
+        ASSERT_EQ(RS_CANCELLED, recorder.status);
+
+        // The timeout went with the request
+        ASSERT_EQ(std::chrono::steady_clock::time_point::max(), transporter.getNextTimerExpiry());
+    }
+
+    TEST(TestRequests, RequesterDestroyed) {
+        Transporter transporter;
+        EchoReceiver receiver(&transporter);
+        auto requester = new Signaler(&transporter);
+        requester->connect(1, &receiver);
+
+        ReplyRecorder recorder;
+        requester->request(1, "ping", recorder.callback());
+        receiver.processMessages();
+        delete requester;
+
+        transporter.processMessages();
+        ASSERT_EQ(0, recorder.calls);
+        ASSERT_FALSE(transporter.hasPendingMessages());
+    }
+
+#ifdef THREAD_SAFE
+    TEST(TestRequests, Future) {
+        Transporter transporter;
+        Signaler requester(&transporter);
+        EchoReceiver receiver(&transporter);
+        requester.connect(1, &receiver);
+
+        std::thread thread([&transporter]() {
+            transporter.waitForMessages(std::chrono::seconds(10));
+            transporter.processMessages();
+        });
+        auto future = requester.request(1, "ping");
+        ASSERT_EQ("ping", future.get().toString());
+        thread.join();
+    }
+
+    TEST(TestRequests, FutureFailure) {
+        Transporter transporter;
+        Signaler requester(&transporter);
+        EchoReceiver receiver(&transporter, true);
+
+        auto unanswered = requester.request(1, "ping");
+        ASSERT_THROW(unanswered.get(), std::runtime_error);
+
+        requester.connect(1, &receiver);
+        auto timedOut = requester.request(1, "ping", std::chrono::milliseconds(5));
+        while (timedOut.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready) {
+            transporter.waitForMessages(std::chrono::seconds(10));
+            transporter.processMessages();
+        }
+        ASSERT_THROW(timedOut.get(), std::runtime_error);
+    }
+#endif
+}
@@ -0,0 +1,188 @@
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "include/beammeup/SharedMemoryReceiver.h"
+#include "include/beammeup/SharedMemoryRing.h"
+#include "include/beammeup/SharedMemorySignaler.h"
+#include "include/beammeup/Transporter.h"
+#include "include/beammeup/VariantVector.h"
+#include "tests/stubs/StubRecordingReceiver.h"
+#include "tests/stubs/StubTempName.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    /**
+     * @param test A name for the test
+     * @return A segment name no other test run will use, with any stale segment removed
+     */
+    static std::string segmentName(const std::string &test) {
+        std::string name = "/" + stubTempName("segment", test);
+        SharedMemoryRing::unlink(name);
+        return name;
+    }
+
+    TEST(TestSharedMemory, RoundTrip) {
+        std::string name = segmentName("round-trip");
+        SharedMemoryRing producer(name, SM_PRODUCER, 4096);
+        SharedMemoryRing consumer(name, SM_CONSUMER);
+        EXPECT_EQ(4096u, consumer.getCapacity());
+        EXPECT_TRUE(producer.isPeerAlive());
+        EXPECT_TRUE(consumer.isPeerAlive(std::chrono::seconds(10)));
+        EXPECT_TRUE(consumer.empty());
+
+        VariantVector list;
+        list.push_back(Variant(1));
+        list.push_back(Variant("two"));
+        EXPECT_TRUE(producer.write(5, Variant("hello")));
+        EXPECT_TRUE(producer.write(6, Variant(list)));
+        EXPECT_FALSE(consumer.empty());
+
+        Signal signal;
+        Variant message;
+        ASSERT_TRUE(consumer.read(signal, message));
+        EXPECT_EQ(5u, signal);
+        EXPECT_EQ("hello", message.toString());
+        ASSERT_TRUE(consumer.read(signal, message));
+        EXPECT_EQ(6u, signal);
+        ASSERT_EQ(2u, message.toVariantVector().size());
+        EXPECT_EQ("two", message.toVariantVector()[1].toString());
+        EXPECT_FALSE(consumer.read(signal, message));
+        EXPECT_TRUE(SharedMemoryRing::unlink(name));
+    }
+
+    TEST(TestSharedMemory, WrapsAround) {
+        std::string name = segmentName("wrap");
+        SharedMemoryRing producer(name, SM_PRODUCER, 4096);
+        SharedMemoryRing consumer(name, SM_CONSUMER);
+
+        // Odd sized messages, so records end up straddling the end of the ring and have to wrap
+        std::string text(100, 'x');
+        Signal signal;
+        Variant message;
+        for (int i = 0; i < 1000; i++) {
+            ASSERT_TRUE(producer.write(static_cast<Signal>(i), Variant(text.substr(0, i % 97))));
+            ASSERT_TRUE(consumer.read(signal, message));
+            EXPECT_EQ(static_cast<Signal>(i), signal);
+            EXPECT_EQ(static_cast<size_t>(i % 97), message.toString().size());
+        }
+        EXPECT_EQ(0u, producer.getDropped());
+        SharedMemoryRing::unlink(name);
+    }
+
+    TEST(TestSharedMemory, FullRingDrops) {
+        std::string name = segmentName("full");
+        SharedMemoryRing producer(name, SM_PRODUCER, 4096);
+        SharedMemoryRing consumer(name, SM_CONSUMER);
+
+        int written = 0;
+        while (producer.write(1, Variant(written))) {
+            written++;
+        }
+        EXPECT_GT(written, 100);
+        EXPECT_EQ(1u, producer.getDropped());
+
+        // Reading makes room again
+        Signal signal;
+        Variant message;
+        ASSERT_TRUE(consumer.read(signal, message));
+        EXPECT_EQ(0, message.toInt());
+        EXPECT_TRUE(producer.write(1, Variant(written)));
+
+        // Anything over half the ring never fits
+        EXPECT_FALSE(producer.write(1, Variant(std::string(3000, 'x'))));
+        EXPECT_EQ(2u, producer.getDropped());
+        SharedMemoryRing::unlink(name);
+    }
+
+    TEST(TestSharedMemory, OneProcessPerRole) {
+        std::string name = segmentName("roles");
+        SharedMemoryRing producer(name, SM_PRODUCER, 4096);
+        EXPECT_FALSE(producer.isPeerAlive());
+        EXPECT_THROW(SharedMemoryRing(name, SM_PRODUCER), std::runtime_error);
+        EXPECT_THROW(SharedMemoryRing("no-slash/allowed", SM_PRODUCER), std::runtime_error);
+        SharedMemoryRing::unlink(name);
+    }
+
+    TEST(TestSharedMemory, ReceiverToSignaler) {
+        std::string name = segmentName("proxy");
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        SharedMemoryReceiver proxy(&transporter, name, 4096);
+        SharedMemorySignaler remote(&transporter, name);
+        StubRecordingReceiver receiver(&transporter);
+        signaler.connect(1, &proxy, ConnectionOptions(C_DIRECT));
+        signaler.connect(2, &proxy);
+        remote.connect(1, &receiver);
+        remote.connect(2, &receiver);
+        EXPECT_TRUE(proxy.isPeerAlive());
+        EXPECT_TRUE(remote.isPeerAlive());
+
+        // Direct connections write straight to the ring, queued ones when the proxy is processed
+        signaler.notify(1, Variant("direct"));
+        signaler.notify(2, Variant("queued"));
+        EXPECT_EQ(1u, remote.processMessages());
+        transporter.processMessages();
+        EXPECT_EQ(1u, remote.processMessages());
+        transporter.processMessages();
+
+        ASSERT_EQ(2u, receiver.messages.size());
+        EXPECT_EQ(1u, receiver.signals[0]);
+        EXPECT_EQ("direct", receiver.messages[0].toString());
+        EXPECT_EQ(2u, receiver.signals[1]);
+        EXPECT_EQ("queued", receiver.messages[1].toString());
+        SharedMemoryRing::unlink(name);
+    }
+
+    TEST(TestSharedMemory, ProducerProcessDies) {
+        std::string name = segmentName("crash");
+        SharedMemoryRing consumer(name, SM_CONSUMER, 4096);
+
+        pid_t child = fork();
+        ASSERT_NE(-1, child);
+        if (child == 0) {
+            // Leaves without detaching, as a crash would
+            SharedMemoryRing producer(name, SM_PRODUCER);
+            for (int i = 0; i < 10; i++) {
+                producer.write(1, Variant(i));
+            }
+            _exit(0);
+        }
+        int status;
+        ASSERT_EQ(child, waitpid(child, &status, 0));
+
+        // What it wrote before dying is still there
+        Signal signal;
+        Variant message;
+        for (int i = 0; i < 10; i++) {
+            ASSERT_TRUE(consumer.read(signal, message));
+            EXPECT_EQ(i, message.toInt());
+        }
+        EXPECT_FALSE(consumer.isPeerAlive());
+
+        // A new producer takes over
+        SharedMemoryRing producer(name, SM_PRODUCER);
+        EXPECT_TRUE(consumer.isPeerAlive());
+        EXPECT_TRUE(producer.write(1, Variant(10)));
+        ASSERT_TRUE(consumer.read(signal, message));
+        EXPECT_EQ(10, message.toInt());
+        SharedMemoryRing::unlink(name);
+    }
+
+    TEST(TestSharedMemory, HeartbeatTimeout) {
+        std::string name = segmentName("heartbeat");
+        SharedMemoryRing producer(name, SM_PRODUCER, 4096);
+        SharedMemoryRing consumer(name, SM_CONSUMER);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_TRUE(consumer.isPeerAlive());
+        EXPECT_FALSE(consumer.isPeerAlive(std::chrono::milliseconds(10)));
+        producer.heartbeat();
+        EXPECT_TRUE(consumer.isPeerAlive(std::chrono::milliseconds(10)));
+        SharedMemoryRing::unlink(name);
+    }
+}
@@ -1,3 +1,8 @@
+#include <algorithm>
+#ifdef THREAD_SAFE
+#include <thread>
+#endif
+
 #include "include/beammeup/Transporter.h"
 #include "include/beammeup/Signaler.h"
 #include "include/beammeup/VariantVector.h"
@@ -10,6 +15,30 @@ using ::testing::Return;
 using ::testing::_;
 
 namespace BeamMeUp {
+    /**
+     * Receiver that notifies its own signal again while processing, through its own direct connection
+     */
+    class EchoingReceiver : public Signaler, public Receiver {
+    public:
+        EchoingReceiver(Transporter *transporter) : Signaler(transporter), Receiver(transporter), depth(0),
+                                                    maxDepth(0) {
+        }
+
+        void processMessage(const Signal signal, const Variant &message) override {
+            depth++;
+            maxDepth = std::max(maxDepth, depth);
+            received.push_back(message.toInt());
+            if (message.toInt() > 0) {
+                notify(signal, message.toInt() - 1);
+            }
+            depth--;
+        }
+
+        int depth;
+        int maxDepth;
+        std::vector<int> received;
+    };
+
     class TestSignals : public ::testing::Test {
     protected:
         void TearDown() {
@@ -155,7 +184,8 @@ namespace BeamMeUp {
         StubSmartObject receiver(&transporter);
         EXPECT_CALL(transporter, unregisterObject(&emitter)).Times(Exactly(1));
         EXPECT_CALL(transporter, unregisterObject(&receiver)).Times(Exactly(1));
-        EXPECT_CALL(transporter, isObjectRegistered(&receiver)).Times(Exactly(2)).WillRepeatedly(Return(true));
+        // Delivery checks the receiver's handle rather than asking the transporter
+        EXPECT_CALL(transporter, isObjectRegistered(_)).Times(Exactly(0));
 
         Signal queueNumber = 1;
 
@@ -177,4 +207,194 @@ namespace BeamMeUp {
         ASSERT_EQ("test 3", receiver.data[queueNumber].toVariantVector()[0].toString());
         ASSERT_EQ("test 4", receiver.data[queueNumber].toVariantVector()[1].toString());
     }
+
+    // Tests that a batch delivers every message in order
+    TEST_F(TestSignals, NotifyBatch) {
+        MockTransporter transporter;
+
+        EXPECT_CALL(transporter, registerObject(_)).Times(Exactly(3));
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver1(&transporter);
+        StubSmartObject receiver2(&transporter);
+        EXPECT_CALL(transporter, unregisterObject(&emitter)).Times(Exactly(1));
+        EXPECT_CALL(transporter, unregisterObject(&receiver1)).Times(Exactly(1));
+        EXPECT_CALL(transporter, unregisterObject(&receiver2)).Times(Exactly(1));
+        EXPECT_CALL(transporter, isObjectRegistered(_)).Times(Exactly(0));
+
+        emitter.connect(1, &receiver1);
+        emitter.connect(1, &receiver2);
+        emitter.notifyBatch(1, VariantVector() << "a" << "b" << "c");
+        emitter.notifyBatch(1, VariantVector());
+
+        ASSERT_EQ(3, receiver1.processMessages(2) + receiver1.processMessages());
+        ASSERT_EQ("c", receiver1.data[1].toString());
+        ASSERT_EQ(1, receiver2.processMessages(1));
+        ASSERT_EQ("a", receiver2.data[1].toString());
+        ASSERT_EQ(2, receiver2.processMessages());
+        ASSERT_EQ("c", receiver2.data[1].toString());
+    }
+
+    // Tests that direct connections call processMessage inline
+    TEST_F(TestSignals, DirectConnection) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        emitter.connect(1, &receiver, C_DIRECT);
+
+        emitter.notify(1, "a");
+        ASSERT_EQ("a", receiver.data[1].toString());
+        emitter.notifyBatch(1, VariantVector() << "b" << "c");
+        ASSERT_EQ("c", receiver.data[1].toString());
+        ASSERT_FALSE(transporter.hasPendingMessages());
+    }
+
+    // Tests that a receiver notifying itself through a direct connection gets the message queued
+    TEST_F(TestSignals, DirectConnectionReentry) {
+        Transporter transporter;
+        EchoingReceiver receiver(&transporter);
+        receiver.connect(1, &receiver, C_DIRECT);
+
+        receiver.notify(1, 2);
+        ASSERT_EQ(std::vector<int>({2}), receiver.received);
+        ASSERT_TRUE(transporter.hasPendingMessages());
+
+        transporter.processMessages();
+        ASSERT_EQ(std::vector<int>({2, 1, 0}), receiver.received);
+        ASSERT_EQ(1, receiver.maxDepth);
+    }
+
+#ifdef THREAD_SAFE
+    // Tests that direct connections queue messages notified from other threads
+    TEST_F(TestSignals, DirectConnectionOtherThread) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        emitter.connect(1, &receiver, C_DIRECT);
+
+        std::thread([&emitter]() {
+            emitter.notify(1, "a");
+        }).join();
+        ASSERT_TRUE(receiver.data.empty());
+        ASSERT_TRUE(transporter.hasPendingMessages());
+
+        transporter.processMessages();
+        ASSERT_EQ("a", receiver.data[1].toString());
+    }
+#endif
+
+    // Tests that destroying a receiver disconnects it from every signaler
+    TEST_F(TestSignals, ReceiverDestruction) {
+        Transporter transporter;
+        StubSmartObject emitter1(&transporter);
+        StubSmartObject emitter2(&transporter);
+        StubSmartObject other(&transporter);
+        auto receiver = new StubSmartObject(&transporter);
+        emitter1.connect(1, receiver);
+        emitter1.connect(2, receiver);
+        emitter1.connect(2, &other);
+        emitter2.connect(1, receiver, C_DIRECT);
+        emitter2.connect(1, receiver);
+
+        delete receiver;
+        ASSERT_EQ(1, emitter1.getConnectedObjects().size());
+        ASSERT_TRUE(emitter2.getConnectedObjects().empty());
+
+        emitter1.notify(2, "a");
+        transporter.processMessages();
+        ASSERT_EQ("a", other.data[2].toString());
+    }
+
+    // Tests that a receiver outliving its signalers doesn't touch them when destroyed
+    TEST_F(TestSignals, SignalerDestruction) {
+        Transporter transporter;
+        StubSmartObject receiver(&transporter);
+        auto emitter1 = new StubSmartObject(&transporter);
+        auto emitter2 = new StubSmartObject(&transporter);
+        emitter1->connect(1, &receiver);
+        emitter2->connect(1, &receiver);
+        emitter2->connect(1, emitter1);
+
+        delete emitter1;
+        ASSERT_TRUE(emitter2->getConnectedObjects().count(1) == 1);
+        delete emitter2;
+    }
+
+    // Tests that disconnecting a receiver only removes its own connections
+    TEST_F(TestSignals, DisconnectReceiverIndex) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver1(&transporter);
+        StubSmartObject receiver2(&transporter);
+        for (Signal signal = 0; signal < 100; ++signal) {
+            emitter.connect(signal, &receiver2);
+        }
+        emitter.connect(5, &receiver1);
+        emitter.connect(5, &receiver1);
+        emitter.connect(7, &receiver1);
+
+        emitter.disconnect(&receiver1);
+        ASSERT_EQ(100, emitter.getConnectedObjects().size());
+
+        // The index was cleared too, so reconnecting and disconnecting again works
+        emitter.connect(5, &receiver1);
+        emitter.disconnect(5, &receiver1);
+        emitter.disconnect(&receiver1);
+        ASSERT_EQ(100, emitter.getConnectedObjects().size());
+    }
+
+    // Tests that the index is kept for receivers registered with another transporter, or with none
+    TEST_F(TestSignals, UnregisteredReceiverIndex) {
+        Transporter transporter;
+        Transporter otherTransporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject other(&otherTransporter);
+        StubSmartObject unregistered(nullptr);
+
+        for (int round = 0; round < 10; ++round) {
+            emitter.connect(1, &other);
+            emitter.connect(1, &unregistered);
+            emitter.connect(2, &unregistered);
+            ASSERT_EQ(1u, other.getIncomingCount());
+            ASSERT_EQ(2u, unregistered.getIncomingCount());
+
+            emitter.disconnect(1, &other);
+            emitter.disconnect(&unregistered);
+            ASSERT_EQ(0u, other.getIncomingCount());
+            ASSERT_EQ(0u, unregistered.getIncomingCount());
+        }
+    }
+
+#ifdef THREAD_SAFE
+    // Tests destroying signalers and receivers connected to each other on different threads at the same time
+    TEST_F(TestSignals, ConcurrentDestruction) {
+        Transporter transporter;
+        for (int round = 0; round < 200; ++round) {
+            std::vector<Signaler *> emitters;
+            std::vector<EchoingReceiver *> receivers;
+            for (int i = 0; i < 8; ++i) {
+                emitters.push_back(new Signaler(&transporter));
+                receivers.push_back(new EchoingReceiver(&transporter));
+            }
+            for (auto emitter : emitters) {
+                for (auto receiver : receivers) {
+                    emitter->connect(1, receiver);
+                }
+            }
+
+            // Receivers are destroyed on one thread while the signalers notify and are destroyed on another
+            std::thread destroyer([&receivers]() {
+                for (auto receiver : receivers) {
+                    delete receiver;
+                }
+            });
+            for (auto emitter : emitters) {
+                emitter->notify(1, 0);
+                delete emitter;
+            }
+            destroyer.join();
+            transporter.processMessages();
+        }
+        ASSERT_FALSE(transporter.hasPendingMessages());
+    }
+#endif
 }
@@ -0,0 +1,252 @@
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "include/beammeup/SocketBridge.h"
+#include "include/beammeup/Transporter.h"
+#include "tests/stubs/StubRecordingReceiver.h"
+#include "tests/stubs/StubTempName.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    /**
+     * Passes messages between two bridges until a condition holds, giving up after a few seconds
+     * @param transporter The transporter both are registered with
+     * @param first One bridge
+     * @param second The other bridge
+     * @param condition The condition
+     * @return true if the condition became true
+     */
+    template<typename Condition>
+    static bool pump(Transporter &transporter, SocketBridge &first, SocketBridge &second, Condition condition) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            first.processSocket();
+            second.processSocket();
+            transporter.processMessages();
+        }
+        return true;
+    }
+
+    TEST(TestSocketBridge, ForwardsMessages) {
+        int sockets[2];
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        SocketBridge local(&transporter, sockets[0]);
+        SocketBridge remote(&transporter, sockets[1]);
+        StubRecordingReceiver receiver(&transporter);
+        signaler.connect(1, &local, ConnectionOptions(C_DIRECT));
+        signaler.connect(2, &local);
+        remote.connect(1, &receiver);
+        remote.connect(2, &receiver);
+
+        for (int i = 0; i < 1000; i++) {
+            signaler.notify(i % 2 + 1, Variant(i));
+        }
+        transporter.processMessages();
+        local.flush();
+        ASSERT_TRUE(pump(transporter, local, remote, [&]() { return receiver.messages.size() == 1000; }));
+
+        // Each connection keeps its order
+        int last[3] = {-1, -1, -1};
+        for (size_t i = 0; i < receiver.messages.size(); i++) {
+            int value = receiver.messages[i].toInt();
+            Signal signal = receiver.signals[i];
+            EXPECT_EQ(static_cast<Signal>(value % 2 + 1), signal);
+            EXPECT_GT(value, last[signal]);
+            last[signal] = value;
+        }
+        EXPECT_EQ(0u, local.getDropped());
+    }
+
+    TEST(TestSocketBridge, CreditLimitsInFlight) {
+        const size_t window = 4096;
+        const size_t limit = 16384;
+        int sockets[2];
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+        Transporter transporter;
+        SocketBridge local(&transporter, sockets[0], window, limit);
+        SocketBridge remote(&transporter, sockets[1], window, limit);
+        StubRecordingReceiver receiver(&transporter);
+        remote.connect(1, &receiver);
+
+        // Pick up the initial grant
+        ASSERT_TRUE(pump(transporter, local, remote, [&]() { return local.getCredit() == window; }));
+
+        // The remote side isn't reading, so only a window's worth is written and the rest is buffered up to the limit
+        std::string text(100, 'x');
+        int sent = 0;
+        while (local.send(1, Variant(text))) {
+            sent++;
+            local.flush();
+        }
+        EXPECT_EQ(1u, local.getDropped());
+        EXPECT_LT(local.getCredit(), 200u);
+        EXPECT_GT(local.getBuffered(), limit - window - 200);
+        EXPECT_LE(local.getBuffered(), limit);
+
+        // Reading grants credit back, so everything gets through
+        ASSERT_TRUE(pump(transporter, local, remote,
+                         [&]() { return receiver.messages.size() == static_cast<size_t>(sent); }));
+        EXPECT_TRUE(local.flush());
+        EXPECT_FALSE(local.send(1, Variant(std::string(window, 'x'))));
+    }
+
+    TEST(TestSocketBridge, MismatchedWindows) {
+        const size_t small = 8192;
+        const int messages = 200;
+        int sockets[2];
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+        Transporter transporter;
+        SocketBridge large(&transporter, sockets[0]);
+        SocketBridge tiny(&transporter, sockets[1], small);
+        StubRecordingReceiver toLarge(&transporter);
+        StubRecordingReceiver toTiny(&transporter);
+        large.connect(2, &toLarge);
+        tiny.connect(1, &toTiny);
+
+        // Sent before either window is known, so batched for our own window until the peer's arrives
+        for (int i = 0; i < messages; i++) {
+            EXPECT_TRUE(large.send(1, Variant(std::string(3000, 'a'))));
+        }
+        EXPECT_TRUE(large.send(1, Variant(std::string(small, 'a'))));
+        for (int i = 0; i < 20; i++) {
+            EXPECT_TRUE(tiny.send(2, Variant(std::string(60000, 'b'))));
+        }
+
+        ASSERT_TRUE(pump(transporter, large, tiny, [&]() {
+            return toTiny.messages.size() == static_cast<size_t>(messages) && toLarge.messages.size() == 20;
+        }));
+        EXPECT_TRUE(large.flush());
+        EXPECT_TRUE(tiny.flush());
+        // Only the message too large for the small window is dropped, once its window arrives
+        EXPECT_EQ(1u, large.getDropped());
+        EXPECT_EQ(0u, tiny.getDropped());
+        EXPECT_FALSE(large.send(1, Variant(std::string(small, 'a'))));
+        EXPECT_TRUE(tiny.send(2, Variant(std::string(small * 8, 'b'))));
+    }
+
+    TEST(TestSocketBridge, BetweenProcesses) {
+        const int messages = 5000;
+        std::string path = "/tmp/" + stubTempName("socket", "between-processes");
+        int listener = SocketBridge::openListener(path);
+
+        pid_t child = fork();
+        ASSERT_NE(-1, child);
+        if (child == 0) {
+            // Echoes every message back on the next signal until the parent hangs up
+            close(listener);
+            Transporter transporter;
+            SocketBridge bridge(&transporter, SocketBridge::openConnection(path));
+            class Echo : public Receiver {
+            public:
+                Echo(Transporter *transporter, SocketBridge *bridge) : Receiver(transporter), bridge(bridge) {
+                }
+
+                void processMessage(const Signal signal, const Variant &message) override {
+                    bridge->send(signal + 1, message);
+                }
+
+                SocketBridge *bridge;
+            } echo(&transporter, &bridge);
+            bridge.connect(1, &echo, ConnectionOptions(C_DIRECT));
+            while (bridge.isOpen()) {
+                bridge.waitForSocket(std::chrono::milliseconds(100));
+                bridge.processSocket();
+                bridge.flush();
+            }
+            _exit(bridge.getDropped() == 0 ? 0 : 1);
+        }
+
+        {
+            Transporter transporter;
+            SocketBridge bridge(&transporter, SocketBridge::acceptConnection(listener));
+            StubRecordingReceiver receiver(&transporter);
+            bridge.connect(2, &receiver);
+            for (int i = 0; i < messages; i++) {
+                while (!bridge.send(1, Variant(i))) {
+                    bridge.waitForSocket(std::chrono::milliseconds(100));
+                    bridge.processSocket();
+                    transporter.processMessages();
+                }
+            }
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (receiver.messages.size() < static_cast<size_t>(messages) &&
+                   std::chrono::steady_clock::now() < deadline) {
+                bridge.flush();
+                bridge.waitForSocket(std::chrono::milliseconds(100));
+                bridge.processSocket();
+                transporter.processMessages();
+            }
+            ASSERT_EQ(static_cast<size_t>(messages), receiver.messages.size());
+            for (int i = 0; i < messages; i++) {
+                EXPECT_EQ(2u, receiver.signals[i]);
+                EXPECT_EQ(i, receiver.messages[i].toInt());
+            }
+        }
+
+        int status;
+        ASSERT_EQ(child, waitpid(child, &status, 0));
+        EXPECT_TRUE(WIFEXITED(status));
+        EXPECT_EQ(0, WEXITSTATUS(status));
+        close(listener);
+        unlink(path.c_str());
+    }
+
+    TEST(TestSocketBridge, MessageLimitLeavesRestBuffered) {
+        int sockets[2];
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+        Transporter transporter;
+        SocketBridge local(&transporter, sockets[0]);
+        SocketBridge remote(&transporter, sockets[1]);
+        StubRecordingReceiver receiver(&transporter);
+        remote.connect(1, &receiver);
+
+        // Picks up the remote's grant, so the messages can be written in one go
+        ASSERT_TRUE(local.waitForSocket(std::chrono::seconds(1)));
+        local.processSocket();
+        for (int i = 0; i < 10; i++) {
+            ASSERT_TRUE(local.send(1, Variant(i)));
+        }
+        local.flush();
+
+        // All of them arrive in the first read. The rest are only buffered, so waiting must not block on the socket.
+        ASSERT_TRUE(remote.waitForSocket(std::chrono::seconds(1)));
+        ASSERT_EQ(1u, remote.processSocket(1));
+        for (int i = 1; i < 10; i++) {
+            ASSERT_TRUE(remote.hasBuffered());
+            ASSERT_TRUE(remote.waitForSocket(std::chrono::milliseconds(0)));
+            ASSERT_EQ(1u, remote.processSocket(1));
+        }
+        EXPECT_FALSE(remote.hasBuffered());
+        transporter.processMessages();
+        EXPECT_EQ(10u, receiver.messages.size());
+    }
+
+    TEST(TestSocketBridge, PeerCloses) {
+        int sockets[2];
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+        Transporter transporter;
+        SocketBridge local(&transporter, sockets[0]);
+        {
+            SocketBridge remote(&transporter, sockets[1]);
+        }
+        // The remote's grant arrives before the hang up, so this may take a couple of reads
+        for (int i = 0; i < 10 && local.isOpen(); i++) {
+            EXPECT_TRUE(local.waitForSocket(std::chrono::seconds(1)));
+            local.processSocket();
+        }
+        EXPECT_FALSE(local.isOpen());
+        EXPECT_FALSE(local.send(1, Variant(1)));
+        EXPECT_THROW(SocketBridge::openConnection("/tmp/beammeup-test-nobody-listening.sock"), std::runtime_error);
+    }
+}
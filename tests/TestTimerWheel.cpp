@@ -0,0 +1,143 @@
+#include "include/beammeup/TimerWheel.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    /**
+     * Timer that records its expiries in a shared log
+     */
+    class LoggingTimer : public TimerWheel::Timer {
+    public:
+        LoggingTimer(std::vector<int> &log, int value) : log(log), value(value) {
+        }
+
+        void expire() override {
+            log.push_back(value);
+        }
+
+        std::vector<int> &log;
+        int value;
+    };
+
+    class TestTimerWheel : public ::testing::Test {
+    protected:
+        TestTimerWheel() : origin(TimerWheel::Clock::now()), wheel(std::chrono::milliseconds(1), origin) {
+        }
+
+        /**
+         * Advances the wheel to origin + time and expires everything due
+         * @param time The time since origin
+         */
+        void advance(TimerWheel::Clock::duration time) {
+            std::vector<TimerWheel::Timer *> expired;
+            wheel.advance(origin + time, expired);
+            for (auto timer : expired) {
+                timer->expire();
+                wheel.finish(timer);
+            }
+        }
+
+        TimerWheel::Clock::time_point origin;
+        TimerWheel wheel;
+        std::vector<int> log;
+    };
+
+    TEST_F(TestTimerWheel, ExpiresInOrder) {
+        wheel.add(new LoggingTimer(log, 3), origin + std::chrono::milliseconds(300));
+        wheel.add(new LoggingTimer(log, 1), origin + std::chrono::milliseconds(5));
+        wheel.add(new LoggingTimer(log, 2), origin + std::chrono::milliseconds(5));
+        ASSERT_EQ(3, wheel.size());
+        ASSERT_EQ(origin + std::chrono::milliseconds(5), wheel.nextExpiry());
+
+        advance(std::chrono::milliseconds(4));
+        ASSERT_TRUE(log.empty());
+
+        advance(std::chrono::milliseconds(5));
+        ASSERT_EQ(std::vector<int>({1, 2}), log);
+
+        advance(std::chrono::milliseconds(299));
+        ASSERT_EQ(2, log.size());
+        advance(std::chrono::milliseconds(300));
+        ASSERT_EQ(std::vector<int>({1, 2, 3}), log);
+        ASSERT_EQ(0, wheel.size());
+        ASSERT_EQ(TimerWheel::Clock::time_point::max(), wheel.nextExpiry());
+    }
+
+    TEST_F(TestTimerWheel, CascadesFromUpperLevels) {
+        // One timer per level, plus one beyond the wheel's range
+        std::vector<unsigned long long> due = {200, 70000, 20000000, 5000000000ULL};
+        for (size_t i = 0; i < due.size(); ++i) {
+            wheel.add(new LoggingTimer(log, i), origin + std::chrono::milliseconds(due[i]));
+        }
+
+        for (size_t i = 0; i < due.size(); ++i) {
+            advance(std::chrono::milliseconds(due[i] - 1));
+            ASSERT_EQ(i, log.size());
+            ASSERT_LE(wheel.nextExpiry(), origin + std::chrono::milliseconds(due[i]));
+            advance(std::chrono::milliseconds(due[i]));
+            ASSERT_EQ(i + 1, log.size());
+        }
+    }
+
+    TEST_F(TestTimerWheel, NextExpiryIncludesCascade) {
+        // Filed in level 1, so it only reaches level 0 at the cascade at 256 ms
+        wheel.add(new LoggingTimer(log, 1), origin + std::chrono::milliseconds(300));
+        advance(std::chrono::milliseconds(150));
+
+        // Filed in level 0, but due after the cascade
+        wheel.add(new LoggingTimer(log, 2), origin + std::chrono::milliseconds(400));
+        ASSERT_EQ(origin + std::chrono::milliseconds(256), wheel.nextExpiry());
+
+        advance(std::chrono::milliseconds(256));
+        ASSERT_TRUE(log.empty());
+        ASSERT_EQ(origin + std::chrono::milliseconds(300), wheel.nextExpiry());
+
+        advance(std::chrono::milliseconds(300));
+        ASSERT_EQ(std::vector<int>({1}), log);
+        ASSERT_EQ(origin + std::chrono::milliseconds(400), wheel.nextExpiry());
+
+        advance(std::chrono::milliseconds(400));
+        ASSERT_EQ(std::vector<int>({1, 2}), log);
+    }
+
+    TEST_F(TestTimerWheel, Cancel) {
+        TimerId id = wheel.add(new LoggingTimer(log, 1), origin + std::chrono::milliseconds(10));
+        wheel.add(new LoggingTimer(log, 2), origin + std::chrono::milliseconds(10));
+
+        ASSERT_TRUE(wheel.cancel(id));
+        ASSERT_FALSE(wheel.cancel(id));
+        advance(std::chrono::milliseconds(10));
+        ASSERT_EQ(std::vector<int>({2}), log);
+    }
+
+    TEST_F(TestTimerWheel, Periodic) {
+        TimerId id = wheel.add(new LoggingTimer(log, 1), origin + std::chrono::milliseconds(10),
+                               std::chrono::milliseconds(10));
+
+        advance(std::chrono::milliseconds(10));
+        advance(std::chrono::milliseconds(20));
+        ASSERT_EQ(2, log.size());
+
+        // Falling behind skips missed expiries instead of bursting
+        advance(std::chrono::milliseconds(75));
+        ASSERT_EQ(3, log.size());
+        advance(std::chrono::milliseconds(84));
+        ASSERT_EQ(3, log.size());
+        advance(std::chrono::milliseconds(85));
+        ASSERT_EQ(4, log.size());
+
+        ASSERT_TRUE(wheel.cancel(id));
+        advance(std::chrono::milliseconds(200));
+        ASSERT_EQ(4, log.size());
+        ASSERT_EQ(0, wheel.size());
+    }
+
+    TEST_F(TestTimerWheel, AlreadyDue) {
+        advance(std::chrono::milliseconds(50));
+        wheel.add(new LoggingTimer(log, 1), origin + std::chrono::milliseconds(10));
+
+        // Fires on the next advance even though time hasn't moved
+        advance(std::chrono::milliseconds(50));
+        ASSERT_EQ(1, log.size());
+    }
+}
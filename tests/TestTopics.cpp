@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "include/beammeup/Topic.h"
+#include "include/beammeup/Transporter.h"
+#include "include/beammeup/Signaler.h"
+#include "tests/stubs/StubRecordingReceiver.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    static std::vector<std::string> matchTopics(const TopicTrie &trie, const std::string &pattern) {
+        std::vector<std::string> topics;
+        trie.matchTopics(pattern, [&topics](const std::string &topic) {
+            topics.push_back(topic);
+        });
+        std::sort(topics.begin(), topics.end());
+        return topics;
+    }
+
+    static size_t countSubscriptions(const TopicTrie &trie, const std::string &topic) {
+        size_t count = 0;
+        trie.matchSubscriptions(topic, [&count](const TopicTrie::Subscription &) {
+            count++;
+        });
+        return count;
+    }
+
+    TEST(TestTopics, Signal) {
+        // FNV-1a reference values
+        ASSERT_EQ(2166136261u, topicSignal(""));
+        ASSERT_EQ(0xe40c292cu, topicSignal("a"));
+        ASSERT_NE(topicSignal("md.venueX.bid"), topicSignal("md.venueX.ask"));
+
+        ASSERT_TRUE(isTopicPattern("md.*.bid"));
+        ASSERT_TRUE(isTopicPattern("md.#"));
+        ASSERT_FALSE(isTopicPattern("md.venue*.bid"));
+        ASSERT_FALSE(isTopicPattern("md.venueX.bid"));
+    }
+
+    TEST(TestTopics, MatchTopics) {
+        TopicTrie trie;
+        ASSERT_TRUE(trie.addTopic("md.venueX.bid"));
+        ASSERT_TRUE(trie.addTopic("md.venueX.ask"));
+        ASSERT_TRUE(trie.addTopic("md.venueY.bid"));
+        ASSERT_TRUE(trie.addTopic("md"));
+        ASSERT_FALSE(trie.addTopic("md.venueX.bid"));
+        ASSERT_THROW(trie.addTopic("md.*"), std::runtime_error);
+
+        ASSERT_EQ(std::vector<std::string>({"md.venueX.ask", "md.venueX.bid"}), matchTopics(trie, "md.venueX.*"));
+        ASSERT_EQ(std::vector<std::string>({"md.venueX.bid", "md.venueY.bid"}), matchTopics(trie, "md.*.bid"));
+        ASSERT_EQ(std::vector<std::string>({"md", "md.venueX.ask", "md.venueX.bid", "md.venueY.bid"}),
+                  matchTopics(trie, "md.#"));
+        ASSERT_EQ(std::vector<std::string>({"md"}), matchTopics(trie, "*"));
+        ASSERT_EQ(std::vector<std::string>(), matchTopics(trie, "md.venueZ.*"));
+        ASSERT_EQ(std::vector<std::string>({"md.venueY.bid"}), matchTopics(trie, "md.venueY.bid"));
+    }
+
+    TEST(TestTopics, MatchSubscriptions) {
+        TopicTrie trie;
+        TopicTrie::Subscription subscription = {nullptr, 0, ConnectionOptions()};
+        trie.addSubscription("md.venueX.*", subscription);
+        trie.addSubscription("md.*.bid", subscription);
+        trie.addSubscription("md.#", subscription);
+        trie.addSubscription("#", subscription);
+        ASSERT_THROW(trie.addSubscription("md.#.bid", subscription), std::runtime_error);
+
+        ASSERT_EQ(4, countSubscriptions(trie, "md.venueX.bid"));
+        ASSERT_EQ(3, countSubscriptions(trie, "md.venueX.ask"));
+        ASSERT_EQ(2, countSubscriptions(trie, "md"));
+        ASSERT_EQ(1, countSubscriptions(trie, "news"));
+
+        ASSERT_EQ(1, trie.removeSubscriptions("md.#", [](const TopicTrie::Subscription &) {
+            return true;
+        }));
+        ASSERT_EQ(1, countSubscriptions(trie, "md"));
+        ASSERT_EQ(3, trie.removeSubscriptions([](const TopicTrie::Subscription &) {
+            return true;
+        }));
+        ASSERT_EQ(0, countSubscriptions(trie, "md.venueX.bid"));
+    }
+
+    TEST(TestTopics, ConnectAfterAdvertise) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        StubRecordingReceiver receiver(&transporter);
+
+        Signal bid = signaler.advertise("md.venueX.bid");
+        Signal ask = signaler.advertise("md.venueX.ask");
+        Signal other = signaler.advertise("md.venueY.bid");
+        signaler.connect("md.venueX.*", &receiver);
+
+        signaler.notify(bid, 1);
+        signaler.notify(ask, 2);
+        signaler.notify(other, 3);
+        transporter.processMessages();
+        ASSERT_EQ(std::vector<Signal>({bid, ask}), receiver.signals);
+    }
+
+    TEST(TestTopics, AdvertiseAfterConnect) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        StubRecordingReceiver receiver(&transporter);
+        StubRecordingReceiver exact(&transporter);
+
+        signaler.connect("md.#", &receiver);
+        signaler.connect("md.venueX.bid", &exact);
+        Signal bid = signaler.advertise("md.venueX.bid");
+        ASSERT_EQ(bid, signaler.advertise("md.venueX.bid"));
+
+        signaler.notify(bid, 1);
+        transporter.processMessages();
+        ASSERT_EQ(std::vector<Signal>({bid}), receiver.signals);
+        ASSERT_EQ(std::vector<Signal>({bid}), exact.signals);
+    }
+
+    TEST(TestTopics, Disconnect) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        StubRecordingReceiver receiver(&transporter);
+
+        Signal bid = signaler.advertise("md.venueX.bid");
+        signaler.connect("md.*.bid", &receiver);
+        signaler.disconnect("md.*.bid", &receiver);
+        Signal other = signaler.advertise("md.venueY.bid");
+
+        signaler.notify(bid, 1);
+        signaler.notify(other, 2);
+        transporter.processMessages();
+        ASSERT_TRUE(receiver.signals.empty());
+
+        // Disconnecting the receiver drops its subscriptions too
+        signaler.connect("news.*", &receiver);
+        signaler.disconnect(&receiver);
+        signaler.notify(signaler.advertise("news.sport"), 3);
+        transporter.processMessages();
+        ASSERT_TRUE(receiver.signals.empty());
+    }
+
+    TEST(TestTopics, OverlappingPatterns) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        StubRecordingReceiver early(&transporter);
+        StubRecordingReceiver late(&transporter);
+
+        // Subscribed both before and after the topic is advertised
+        signaler.connect("md.#", &late);
+        signaler.connect("md.*", &late);
+        Signal venue = signaler.advertise("md.venueX");
+        signaler.connect("md.#", &early);
+        signaler.connect("md.*", &early);
+
+        // Each topic is delivered once however many patterns match it
+        signaler.notify(venue, 1);
+        transporter.processMessages();
+        ASSERT_EQ(std::vector<Signal>({venue}), early.signals);
+        ASSERT_EQ(std::vector<Signal>({venue}), late.signals);
+
+        // Still covered by "md.#"
+        signaler.disconnect("md.*", &early);
+        signaler.disconnect("md.*", &late);
+        signaler.notify(venue, 2);
+        transporter.processMessages();
+        ASSERT_EQ(2u, early.signals.size());
+        ASSERT_EQ(2u, late.signals.size());
+
+        signaler.disconnect("md.#", &early);
+        signaler.disconnect("md.#", &late);
+        signaler.notify(venue, 3);
+        transporter.processMessages();
+        ASSERT_EQ(2u, early.signals.size());
+        ASSERT_EQ(2u, late.signals.size());
+    }
+
+    TEST(TestTopics, DestroyedSubscriber) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        auto receiver = new StubRecordingReceiver(&transporter);
+        signaler.connect("md.#", receiver);
+        delete receiver;
+
+        signaler.notify(signaler.advertise("md.venueX.bid"), 1);
+        ASSERT_FALSE(transporter.hasPendingMessages());
+        ASSERT_TRUE(signaler.getConnectedObjects().empty());
+    }
+
+    TEST(TestTopics, SubscriberChurn) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        Signal bid = signaler.advertise("md.venueX.bid");
+
+        // Topics are never advertised again, so only the receivers' destructors can clear their subscriptions
+        for (int i = 0; i < 1000; i++) {
+            StubRecordingReceiver receiver(&transporter);
+            signaler.connect("md.*.bid", &receiver);
+            signaler.connect("news.#", &receiver);
+            signaler.connect("md.venue" + std::to_string(i) + ".*", &receiver);
+            ASSERT_EQ(3u, signaler.getSubscriptionCount());
+            ASSERT_EQ(4u, receiver.getIncomingCount());
+        }
+        EXPECT_EQ(0u, signaler.getSubscriptionCount());
+        EXPECT_TRUE(signaler.getConnectedObjects().empty());
+
+        // Explicit disconnects keep the receiver's index in step
+        StubRecordingReceiver receiver(&transporter);
+        signaler.connect("md.*.bid", &receiver);
+        signaler.connect("news.#", &receiver);
+        signaler.disconnect("news.#", &receiver);
+        EXPECT_EQ(2u, receiver.getIncomingCount());
+        signaler.disconnect(&receiver);
+        EXPECT_EQ(0u, receiver.getIncomingCount());
+        EXPECT_EQ(0u, signaler.getSubscriptionCount());
+        signaler.notify(bid, 1);
+        EXPECT_FALSE(transporter.hasPendingMessages());
+    }
+}
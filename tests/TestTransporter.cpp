@@ -1,3 +1,13 @@
+#ifndef _WIN32
+#include <poll.h>
+#endif
+#ifdef THREAD_SAFE
+#include <atomic>
+#include <thread>
+#endif
+#include <stdexcept>
+#include <vector>
+
 #include "include/beammeup/Transporter.h"
 #include "tests/mocks/MockMutex.h"
 #include "tests/stubs/StubSmartObject.h"
@@ -7,6 +17,22 @@ using ::testing::Exactly;
 using ::testing::Return;
 
 namespace BeamMeUp {
+    /**
+     * Receiver that deletes another object when it gets a message
+     */
+    class DeletingReceiver : public Receiver {
+    public:
+        DeletingReceiver(Transporter *transporter, StubSmartObject *victim) : Receiver(transporter), victim(victim) {
+        }
+
+        void processMessage(const Signal, const Variant &) override {
+            delete victim;
+            victim = nullptr;
+        }
+
+        StubSmartObject *victim;
+    };
+
     TEST(TestTransporter, ShutdownAfterChildren) {
         // Test that transporter dying after children doesn't crash
         auto transporter = new Transporter();
@@ -36,4 +62,443 @@ namespace BeamMeUp {
             ASSERT_EQ(emitter.data.end(), emitter.data.find(1));
         }
     }
+
+    TEST(TestTransporter, ProcessMessagesWithMessageBudget) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver1(&transporter);
+        StubSmartObject receiver2(&transporter);
+        emitter.connect(1, &receiver1);
+        emitter.connect(2, &receiver2);
+        emitter.notify(1, "a");
+        emitter.notify(1, "b");
+        emitter.notify(1, "c");
+        emitter.notify(2, "x");
+
+        // Both receivers get a turn even though receiver1 has more queued
+        ASSERT_TRUE(transporter.processMessages(2));
+        ASSERT_EQ("a", receiver1.data[1].toString());
+        ASSERT_EQ("x", receiver2.data[2].toString());
+
+        // The next call resumes where the last one stopped
+        ASSERT_TRUE(transporter.processMessages(1));
+        ASSERT_EQ("b", receiver1.data[1].toString());
+
+        ASSERT_FALSE(transporter.processMessages(10));
+        ASSERT_EQ("c", receiver1.data[1].toString());
+        ASSERT_FALSE(transporter.hasPendingMessages());
+    }
+
+    TEST(TestTransporter, ProcessMessagesWithTimeBudget) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        emitter.connect(1, &receiver);
+        emitter.notify(1, "a");
+        emitter.notify(1, "b");
+
+        // At least one message is always processed, and the deadline passes immediately after it
+        ASSERT_TRUE(transporter.processMessages(0, std::chrono::nanoseconds(1)));
+        ASSERT_EQ("a", receiver.data[1].toString());
+        ASSERT_TRUE(receiver.hasMessages());
+
+        ASSERT_FALSE(transporter.processMessages(0, std::chrono::seconds(10)));
+        ASSERT_EQ("b", receiver.data[1].toString());
+    }
+
+    TEST(TestTransporter, PendingMessagesDiscardedOnDestroy) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        auto receiver = new StubSmartObject(&transporter);
+        emitter.connect(1, receiver);
+        emitter.notify(1, "a");
+        ASSERT_TRUE(transporter.hasPendingMessages());
+
+        delete receiver;
+        ASSERT_FALSE(transporter.hasPendingMessages());
+    }
+
+    /**
+     * Receiver that throws on its first message and records the rest
+     */
+    class ThrowingReceiver : public Receiver {
+    public:
+        ThrowingReceiver(Transporter *transporter) : Receiver(transporter), thrown(false) {
+        }
+
+        void processMessage(const Signal, const Variant &message) override {
+            if (!thrown) {
+                thrown = true;
+                throw std::runtime_error("handler failed");
+            }
+            received.push_back(message.toInt());
+        }
+
+        bool thrown;
+        std::vector<int> received;
+    };
+
+    TEST(TestTransporter, ReadyList) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver1(&transporter);
+        StubSmartObject receiver2(&transporter);
+        emitter.connect(1, &receiver1);
+        emitter.connect(2, &receiver2);
+
+        // Receivers are only listed once, however many messages they get
+        emitter.notify(1, "a");
+        emitter.notify(1, "b");
+        ASSERT_EQ(1u, transporter.getReadyCount());
+        transporter.processMessages();
+        ASSERT_EQ("b", receiver1.data[1].toString());
+        ASSERT_EQ(0u, transporter.getReadyCount());
+
+        // And listed again once they've been drained
+        emitter.notify(2, "x");
+        emitter.notify(1, "c");
+        ASSERT_EQ(2u, transporter.getReadyCount());
+        transporter.processMessages();
+        ASSERT_EQ("c", receiver1.data[1].toString());
+        ASSERT_EQ("x", receiver2.data[2].toString());
+        ASSERT_FALSE(transporter.hasPendingMessages());
+    }
+
+    TEST(TestTransporter, ReadyReceiverDestroyed) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        auto receiver1 = new StubSmartObject(&transporter);
+        StubSmartObject receiver2(&transporter);
+        emitter.connect(1, receiver1);
+        emitter.connect(1, &receiver2);
+        emitter.notify(1, "a");
+
+        // Its entry on the ready list is skipped
+        delete receiver1;
+        transporter.processMessages();
+        ASSERT_EQ("a", receiver2.data[1].toString());
+        ASSERT_EQ(0u, transporter.getReadyCount());
+        ASSERT_FALSE(transporter.hasPendingMessages());
+    }
+
+    TEST(TestTransporter, HandlerThrows) {
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        ThrowingReceiver receiver(&transporter);
+        signaler.connect(1, &receiver);
+        for (int i = 0; i < 3; i++) {
+            signaler.notify(1, Variant(i));
+        }
+
+        // The receiver stays on the ready list, so the messages after the one that threw still get processed
+        EXPECT_THROW(transporter.processMessages(), std::runtime_error);
+        EXPECT_EQ(1u, transporter.getReadyCount());
+        transporter.processMessages();
+        EXPECT_EQ(std::vector<int>({1, 2}), receiver.received);
+
+        signaler.notify(1, Variant(3));
+        transporter.processMessages();
+        EXPECT_EQ(std::vector<int>({1, 2, 3}), receiver.received);
+    }
+
+#ifdef THREAD_SAFE
+    /**
+     * Receiver that counts its messages
+     */
+    class TallyReceiver : public Receiver {
+    public:
+        TallyReceiver(Transporter *transporter) : Receiver(transporter), count(0) {
+        }
+
+        void processMessage(const Signal, const Variant &) override {
+            count++;
+        }
+
+        std::atomic<size_t> count;
+    };
+
+    TEST(TestTransporter, ReadyListConcurrentSender) {
+        // Messages sent while their receiver is being processed must not be stranded off the ready list
+        const size_t messages = 100000;
+        Transporter transporter;
+        Signaler signaler(&transporter);
+        TallyReceiver receiver(&transporter);
+        signaler.connect(1, &receiver);
+
+        std::thread sender([&signaler, messages]() {
+            for (size_t i = 0; i < messages; ++i) {
+                signaler.notify(1, static_cast<int>(i));
+            }
+        });
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        while (receiver.count < messages && std::chrono::steady_clock::now() < deadline) {
+            transporter.processMessages(16);
+        }
+        sender.join();
+
+        ASSERT_EQ(messages, receiver.count);
+    }
+
+    /**
+     * Receiver that waits until every thread has reached its handler, then deletes another object
+     */
+    class RendezvousDeleter : public Receiver {
+    public:
+        RendezvousDeleter(Transporter *transporter, StubSmartObject *victim, std::atomic<int> &arrived, int threads) :
+                Receiver(transporter), victim(victim), arrived(arrived), threads(threads) {
+        }
+
+        void processMessage(const Signal, const Variant &) override {
+            arrived++;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (arrived < threads && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+            delete victim;
+            victim = nullptr;
+        }
+
+        StubSmartObject *victim;
+        std::atomic<int> &arrived;
+        int threads;
+    };
+
+    TEST(TestTransporter, HandlersDeleteReceiversOnTwoThreads) {
+        // Each thread destroys a receiver from a handler while the other is inside one. Neither may wait for the
+        // other's handler to finish.
+        const int threads = 2;
+        auto arrived = std::make_shared<std::atomic<int>>(0);
+        auto finished = std::make_shared<std::atomic<int>>(0);
+
+        for (int i = 0; i < threads; ++i) {
+            // Detached, so a deadlock fails the test instead of hanging it
+            std::thread([arrived, finished, threads]() {
+                Transporter transporter;
+                StubSmartObject emitter(&transporter);
+                RendezvousDeleter deleter(&transporter, new StubSmartObject(&transporter), *arrived, threads);
+                emitter.connect(1, &deleter);
+                emitter.notify(1, "go");
+                transporter.processMessages();
+                if (deleter.victim == nullptr) {
+                    (*finished)++;
+                }
+            }).detach();
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        while (*finished < threads && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_EQ(threads, finished->load());
+    }
+#endif
+
+#ifndef _WIN32
+    // Returns true if descriptor is readable without blocking
+    static bool isReadable(int descriptor) {
+        pollfd entry = {descriptor, POLLIN, 0};
+        return poll(&entry, 1, 0) == 1 && (entry.revents & POLLIN) != 0;
+    }
+
+    TEST(TestTransporter, EventDescriptor) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        emitter.connect(1, &receiver);
+        emitter.notify(1, "a");
+
+        // Messages queued before the descriptor is opened still make it readable
+        int descriptor = transporter.openEventDescriptor();
+        ASSERT_NE(-1, descriptor);
+        ASSERT_EQ(descriptor, transporter.openEventDescriptor());
+        ASSERT_TRUE(isReadable(descriptor));
+
+        transporter.processMessages();
+        ASSERT_FALSE(isReadable(descriptor));
+
+        emitter.notify(1, "b");
+        emitter.notify(1, "c");
+        ASSERT_TRUE(isReadable(descriptor));
+
+        // Stays readable until everything has been processed
+        ASSERT_TRUE(transporter.processMessages(1));
+        ASSERT_TRUE(isReadable(descriptor));
+        ASSERT_FALSE(transporter.processMessages(1));
+        ASSERT_FALSE(isReadable(descriptor));
+    }
+#endif
+
+#ifdef THREAD_SAFE
+    TEST(TestTransporter, WaitForMessagesWakesOnReceive) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        emitter.connect(1, &receiver);
+
+        std::thread producer([&emitter]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            emitter.notify(1, "test");
+        });
+
+        ASSERT_TRUE(transporter.waitForMessages(std::chrono::seconds(10)));
+        producer.join();
+        transporter.processMessages();
+        ASSERT_EQ("test", receiver.data[1].toString());
+    }
+
+    TEST(TestTransporter, WaitForMessagesTimesOut) {
+        Transporter transporter;
+        StubSmartObject receiver(&transporter);
+
+        auto start = std::chrono::steady_clock::now();
+        ASSERT_FALSE(transporter.waitForMessages(std::chrono::milliseconds(20)));
+        ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+    }
+
+    TEST(TestTransporter, WakeUpInterruptsWait) {
+        Transporter transporter;
+
+        std::thread waker([&transporter]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            transporter.wakeUp();
+        });
+
+        ASSERT_FALSE(transporter.waitForMessages());
+        waker.join();
+    }
+
+    TEST(TestTransporter, WakeUpBeforeWaitIsNotLost) {
+        Transporter transporter;
+
+        transporter.wakeUp();
+        auto start = std::chrono::steady_clock::now();
+        ASSERT_FALSE(transporter.waitForMessages(std::chrono::seconds(10)));
+        ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+
+        // Consumed by the first wait
+        ASSERT_FALSE(transporter.waitForMessages(std::chrono::milliseconds(20)));
+    }
+#else
+    TEST(TestTransporter, WaitForMessagesDoesNotBlock) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        emitter.connect(1, &receiver);
+
+        ASSERT_FALSE(transporter.waitForMessages());
+        emitter.notify(1, "test");
+        ASSERT_TRUE(transporter.waitForMessages());
+    }
+#endif
+
+    TEST(TestTransporter, DelayedNotify) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        emitter.connect(1, &receiver);
+        emitter.connect(2, &receiver);
+
+        emitter.notifyAfter(1, "later", std::chrono::milliseconds(20));
+        emitter.notifyAt(2, "now", std::chrono::steady_clock::now() - std::chrono::milliseconds(1));
+        TimerId cancelled = emitter.notifyAfter(1, "never", std::chrono::milliseconds(10));
+        ASSERT_TRUE(emitter.cancelTimer(cancelled));
+
+        // Already due, so the first pass delivers it
+        transporter.processMessages();
+        ASSERT_EQ("now", receiver.data[2].toString());
+        ASSERT_EQ(receiver.data.end(), receiver.data.find(1));
+
+        // Wakes up for the timer and delivers it
+        ASSERT_TRUE(transporter.waitForMessages(std::chrono::seconds(10)));
+        transporter.processMessages();
+        ASSERT_EQ("later", receiver.data[1].toString());
+        ASSERT_EQ(std::chrono::steady_clock::time_point::max(), transporter.getNextTimerExpiry());
+    }
+
+    TEST(TestTransporter, TimerCancelledByEarlierTimerInBatch) {
+        Transporter transporter;
+        StubSmartObject emitter(&transporter);
+        StubSmartObject receiver(&transporter);
+        auto victim = new StubSmartObject(&transporter);
+        DeletingReceiver deleter(&transporter, victim);
+        emitter.connect(1, &deleter, ConnectionOptions(C_DIRECT));
+        victim->connect(2, &receiver);
+
+        // Both due in the same pass. Expiring the first deletes the second's signaler, which must cancel it.
+        auto due = std::chrono::steady_clock::now() - std::chrono::milliseconds(1);
+        emitter.notifyAt(1, "first", due);
+        victim->notifyAt(2, "second", due);
+
+        transporter.processMessages();
+        ASSERT_EQ(nullptr, deleter.victim);
+        transporter.processMessages();
+        ASSERT_EQ(receiver.data.end(), receiver.data.find(2));
+        ASSERT_EQ(std::chrono::steady_clock::time_point::max(), transporter.getNextTimerExpiry());
+    }
+
+    TEST(TestTransporter, PeriodicNotify) {
+        Transporter transporter;
+        StubSmartObject receiver(&transporter);
+        auto emitter = new StubSmartObject(&transporter);
+        emitter->connect(1, &receiver);
+
+        int count = 0;
+        emitter->notifyEvery(1, "tick", std::chrono::milliseconds(1));
+        while (count < 3) {
+            transporter.waitForMessages(std::chrono::seconds(10));
+            transporter.processMessages();
+            if (receiver.data.find(1) != receiver.data.end()) {
+                receiver.data.clear();
+                count++;
+            }
+        }
+
+        // Destroying the signaler cancels its timers
+        delete emitter;
+        ASSERT_EQ(std::chrono::steady_clock::time_point::max(), transporter.getNextTimerExpiry());
+    }
+
+#ifdef THREAD_SAFE
+    /**
+     * Receiver that takes a while over each message
+     */
+    class LingeringReceiver : public Receiver {
+    public:
+        explicit LingeringReceiver(Transporter *transporter) : Receiver(transporter), entered(false), finished(false) {
+        }
+
+        void processMessage(const Signal, const Variant &) override {
+            entered = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            finished = true;
+        }
+
+        std::atomic_bool entered;
+        std::atomic_bool finished;
+    };
+
+    TEST(TestTransporter, SignalerDestroyedWhileTimerExpires) {
+        Transporter transporter;
+        LingeringReceiver receiver(&transporter);
+        auto emitter = new StubSmartObject(&transporter);
+
+        // The timer expires on the other thread and delivers inline there, so it is still notifying when the
+        // emitter is destroyed here
+        std::thread thread([&]() {
+            emitter->connect(1, &receiver, ConnectionOptions(C_DIRECT));
+            emitter->notifyAfter(1, "tick", std::chrono::milliseconds(1));
+            while (!receiver.entered) {
+                transporter.waitForMessages(std::chrono::milliseconds(10));
+                transporter.processMessages();
+            }
+        });
+        while (!receiver.entered) {
+            std::this_thread::yield();
+        }
+
+        delete emitter;
+        EXPECT_TRUE(receiver.finished);
+        thread.join();
+    }
+#endif
 }
@@ -360,4 +360,23 @@ namespace BeamMeUp {
         }
         ASSERT_EQ(0, StubTrackedPointer::count);
     }
-}
\ No newline at end of file
+
+    // Tests that swap exchanges contents and ownership without copying
+    TEST_F(TestVariant, Swap) {
+        MockTransporter mockTransporter;
+        EXPECT_CALL(mockTransporter, registerObject(_)).Times(1);
+        EXPECT_CALL(mockTransporter, unregisterObject(_)).Times(1);
+
+        StubTrackedPointer *p1 = new StubTrackedPointer(&mockTransporter);
+        {
+            Variant v1(p1, true);
+            Variant v2("test");
+            v1.swap(v2);
+            ASSERT_EQ(D_STRING, v1.getType());
+            ASSERT_EQ("test", v1.toString());
+            ASSERT_EQ(p1, v2.toPointer());
+            ASSERT_EQ(1, StubTrackedPointer::count);
+        }
+        ASSERT_EQ(0, StubTrackedPointer::count);
+    }
+}
@@ -0,0 +1,106 @@
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "include/beammeup/Variant.h"
+#include "include/beammeup/VariantCodec.h"
+#include "include/beammeup/VariantMap.h"
+#include "include/beammeup/VariantVector.h"
+
+#include "gtest/gtest.h"
+
+namespace BeamMeUp {
+    /**
+     * Encodes and decodes a variant, checking the size and that all of the data was used
+     * @param value The variant
+     * @return The decoded copy
+     */
+    static Variant roundTrip(const Variant &value) {
+        std::string encoded;
+        VariantCodec::encode(value, encoded);
+        EXPECT_EQ(VariantCodec::size(value), encoded.size());
+
+        const char *data = encoded.data();
+        Variant decoded;
+        EXPECT_TRUE(VariantCodec::decode(data, encoded.data() + encoded.size(), decoded));
+        EXPECT_EQ(encoded.data() + encoded.size(), data);
+        return decoded;
+    }
+
+    TEST(TestVariantCodec, Scalars) {
+        std::vector<Variant> values = {
+                Variant(), Variant("text"), Variant(std::string()), Variant(true), Variant(false), Variant(1.5),
+                Variant(2.25f), Variant(-7), Variant(std::numeric_limits<int>::min()), Variant(42u),
+                Variant(static_cast<short>(-3)), Variant(static_cast<unsigned short>(65535)), Variant(-5L),
+                Variant(std::numeric_limits<long long>::min()), Variant(std::numeric_limits<unsigned long long>::max()),
+                Variant(9UL)
+        };
+        for (auto &value : values) {
+            Variant decoded = roundTrip(value);
+            ASSERT_EQ(value.getType(), decoded.getType());
+            ASSERT_TRUE(value == decoded) << value.toString();
+        }
+    }
+
+    TEST(TestVariantCodec, Containers) {
+        VariantMap inner;
+        inner["bid"] = 101.5;
+        inner["venues"] = std::vector<std::string>({"X", "Y"});
+        VariantVector vector;
+        vector << 1 << "two" << Variant(inner) << Variant();
+        VariantMap map;
+        map["list"] = vector;
+        map["name"] = "quote";
+
+        Variant decoded = roundTrip(map);
+        ASSERT_EQ(D_VARIANTMAP, decoded.getType());
+        ASSERT_EQ("quote", decoded.find("name")->toString());
+        const Variant *list = decoded.find("list");
+        ASSERT_NE(nullptr, list);
+        VariantVector elements = list->toVariantVector();
+        ASSERT_EQ(4u, elements.size());
+        ASSERT_EQ(1, elements[0].toInt());
+        ASSERT_EQ("two", elements[1].toString());
+        ASSERT_EQ(101.5, elements[2].find("bid")->toDouble());
+        ASSERT_EQ(std::vector<std::string>({"X", "Y"}), elements[2].find("venues")->toStringVector());
+        ASSERT_TRUE(elements[3].isNull());
+    }
+
+    TEST(TestVariantCodec, Compact) {
+        // Small integers take a byte after the type, whatever their declared width
+        ASSERT_EQ(2u, VariantCodec::size(Variant(5ULL)));
+        ASSERT_EQ(2u, VariantCodec::size(Variant(-1)));
+        ASSERT_EQ(3u, VariantCodec::size(Variant(300)));
+    }
+
+    TEST(TestVariantCodec, Malformed) {
+        VariantMap map;
+        map["key"] = "value";
+        std::string encoded;
+        VariantCodec::encode(map, encoded);
+
+        // Every truncation is rejected rather than read past the end
+        for (size_t length = 0; length < encoded.size(); ++length) {
+            const char *data = encoded.data();
+            Variant decoded;
+            ASSERT_FALSE(VariantCodec::decode(data, encoded.data() + length, decoded));
+            ASSERT_EQ(encoded.data(), data);
+        }
+
+        // Unknown types, and counts larger than the data, too
+        std::string unknown(1, static_cast<char>(200));
+        const char *data = unknown.data();
+        Variant decoded;
+        ASSERT_FALSE(VariantCodec::decode(data, data + unknown.size(), decoded));
+        std::string huge = std::string(1, static_cast<char>(D_VARIANTVECTOR)) + "\xff\xff\xff\x0f";
+        data = huge.data();
+        ASSERT_FALSE(VariantCodec::decode(data, data + huge.size(), decoded));
+    }
+
+    TEST(TestVariantCodec, Pointer) {
+        // Pointers can't leave the process
+        int target = 0;
+        Variant pointer(reinterpret_cast<ArbitraryPointer *>(&target), false);
+        ASSERT_TRUE(roundTrip(pointer).isNull());
+    }
+}
@@ -9,8 +9,21 @@
 #include "gmock/gmock.h"
 
 namespace BeamMeUp {
+    /**
+     * Registration is passed through to Transporter unless a test says otherwise, so that receivers get handles and
+     * can be delivered to
+     */
     class MockTransporter : public Transporter {
     public:
+        MockTransporter() {
+            ON_CALL(*this, registerObject(::testing::_)).WillByDefault(::testing::Invoke([this](Receiver *object) {
+                Transporter::registerObject(object);
+            }));
+            ON_CALL(*this, unregisterObject(::testing::_)).WillByDefault(::testing::Invoke([this](Receiver *object) {
+                Transporter::unregisterObject(object);
+            }));
+        }
+
         MOCK_METHOD2(postMessage, void(int, Variant));
 
         MOCK_METHOD0(processMessages, void());
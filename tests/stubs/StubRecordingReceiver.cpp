@@ -0,0 +1,20 @@
+#include "StubRecordingReceiver.h"
+
+namespace BeamMeUp {
+    StubRecordingReceiver::StubRecordingReceiver(Transporter *transporter) : Receiver(transporter) {
+    }
+
+    void StubRecordingReceiver::processMessage(const Signal signal, const Variant &message) {
+        signals.push_back(signal);
+        messages.push_back(message);
+    }
+
+    std::vector<int> StubRecordingReceiver::getInts() const {
+        std::vector<int> ints;
+        ints.reserve(messages.size());
+        for (auto &message : messages) {
+            ints.push_back(message.toInt());
+        }
+        return ints;
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef BEAMMEUP_STUBRECORDINGRECEIVER_H
+#define BEAMMEUP_STUBRECORDINGRECEIVER_H
+
+#include <vector>
+
+#include "include/beammeup/Receiver.h"
+#include "include/beammeup/Types.h"
+#include "include/beammeup/Variant.h"
+
+namespace BeamMeUp {
+    /**
+     * Receiver that records the messages it processes, in order
+     */
+    class StubRecordingReceiver : public Receiver {
+    public:
+        /**
+         * Initializes the receiver
+         * @param transporter The transporter to register with
+         */
+        StubRecordingReceiver(Transporter *transporter);
+
+        /**
+         * Records the message and its signal
+         * @param signal The signal
+         * @param message The message
+         */
+        void processMessage(const Signal signal, const Variant &message) override;
+
+        /**
+         * @return The messages recorded so far, as integers
+         */
+        std::vector<int> getInts() const;
+
+        std::vector<Signal> signals;
+        std::vector<Variant> messages;
+    };
+}
+
+#endif //BEAMMEUP_STUBRECORDINGRECEIVER_H
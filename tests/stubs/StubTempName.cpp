@@ -0,0 +1,9 @@
+#include <unistd.h>
+
+#include "StubTempName.h"
+
+namespace BeamMeUp {
+    std::string stubTempName(const std::string &kind, const std::string &test) {
+        return "beammeup-" + kind + "-" + std::to_string(getpid()) + "-" + test;
+    }
+}
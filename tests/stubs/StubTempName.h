@@ -0,0 +1,16 @@
+#ifndef BEAMMEUP_STUBTEMPNAME_H
+#define BEAMMEUP_STUBTEMPNAME_H
+
+#include <string>
+
+namespace BeamMeUp {
+    /**
+     * Makes a name for a file, socket or shared memory segment that no other test run will use
+     * @param kind What the name is for
+     * @param test A name for the test
+     * @return The name, without a directory or leading slash
+     */
+    std::string stubTempName(const std::string &kind, const std::string &test);
+}
+
+#endif //BEAMMEUP_STUBTEMPNAME_H